@@ -199,6 +199,7 @@ struct tegra_se_dev {
 	struct workqueue_struct *se_work_q;
 	struct scatterlist sg;
 	bool dynamic_mem;
+	bool direct_map;	/* current batch is DMA'd from its scatterlists */
 	u32 *total_aes_buf;
 	dma_addr_t total_aes_buf_addr;
 	void *aes_buf;
@@ -208,6 +209,7 @@ struct tegra_se_dev {
 	atomic_t aes_buf_stat[SE_MAX_AESBUF_ALLOC];
 	dma_addr_t aes_addr;
 	dma_addr_t aes_cur_addr;
+	dma_addr_t aes_cur_dst_addr;
 	unsigned int cmdbuf_cnt;
 	unsigned int src_bytes_mapped;
 	unsigned int dst_bytes_mapped;
@@ -251,6 +253,7 @@ struct tegra_se_priv_data {
 	struct scatterlist sg;
 	void *buf;
 	bool dynmem;
+	bool direct;
 	bool sha_last;
 	bool sha_src_mapped;
 	bool sha_dst_mapped;
@@ -1031,6 +1034,53 @@ static unsigned int tegra_se_count_sgs(struct scatterlist *sl, u32 nbytes)
 	return sg_nents;
 }
 
+/*
+ * A request whose source and destination each fit in one block aligned
+ * segment is handed to the engine from its own pages rather than copied
+ * through a gather buffer on submit and again on completion.
+ */
+static bool tegra_se_req_direct_ok(struct skcipher_request *req)
+{
+	if (!req->cryptlen || !req->src || !req->dst)
+		return false;
+
+	if (tegra_se_count_sgs(req->src, req->cryptlen) != 1 ||
+	    tegra_se_count_sgs(req->dst, req->cryptlen) != 1)
+		return false;
+
+	return IS_ALIGNED(req->src->offset, TEGRA_SE_AES_BLOCK_SIZE) &&
+	       IS_ALIGNED(req->dst->offset, TEGRA_SE_AES_BLOCK_SIZE);
+}
+
+static int tegra_se_map_direct_req(struct tegra_se_dev *se_dev,
+				   struct skcipher_request *req)
+{
+	if (req->src == req->dst)
+		return dma_map_sg(se_dev->dev, req->src, 1,
+				  DMA_BIDIRECTIONAL) ? 0 : -ENOMEM;
+
+	if (!dma_map_sg(se_dev->dev, req->src, 1, DMA_TO_DEVICE))
+		return -ENOMEM;
+
+	if (!dma_map_sg(se_dev->dev, req->dst, 1, DMA_FROM_DEVICE)) {
+		dma_unmap_sg(se_dev->dev, req->src, 1, DMA_TO_DEVICE);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void tegra_se_unmap_direct_req(struct tegra_se_dev *se_dev,
+				      struct skcipher_request *req)
+{
+	if (req->src == req->dst) {
+		dma_unmap_sg(se_dev->dev, req->src, 1, DMA_BIDIRECTIONAL);
+	} else {
+		dma_unmap_sg(se_dev->dev, req->src, 1, DMA_TO_DEVICE);
+		dma_unmap_sg(se_dev->dev, req->dst, 1, DMA_FROM_DEVICE);
+	}
+}
+
 static int tegra_se_get_free_cmdbuf(struct tegra_se_dev *se_dev)
 {
 	int i = 0;
@@ -1123,6 +1173,16 @@ static void tegra_se_aes_complete_callback(void *priv, int nr_completed)
 		return;
 	}
 
+	if (priv_data->direct) {
+		for (i = 0; i < priv_data->req_cnt; i++) {
+			req = priv_data->reqs[i];
+			tegra_se_unmap_direct_req(se_dev, req);
+			req->base.complete(&req->base, 0);
+		}
+		devm_kfree(se_dev->dev, priv_data);
+		return;
+	}
+
 	if (!se_dev->ioc)
 		dma_sync_single_for_cpu(se_dev->dev, priv_data->buf_addr,
 				priv_data->gather_buf_sz, DMA_BIDIRECTIONAL);
@@ -1261,15 +1321,20 @@ static int tegra_se_channel_submit_gather(struct tegra_se_dev *se_dev,
 		for (i = 0; i < se_dev->req_cnt; i++)
 			priv->reqs[i] = se_dev->reqs[i];
 
-		if (!se_dev->ioc)
-			priv->sg = se_dev->sg;
-
-		if (unlikely(se_dev->dynamic_mem)) {
-			priv->buf = se_dev->aes_buf;
-			priv->dynmem = se_dev->dynamic_mem;
+		if (se_dev->direct_map) {
+			priv->direct = true;
 		} else {
-			priv->buf = se_dev->aes_bufs[se_dev->aesbuf_entry];
-			priv->aesbuf_entry = se_dev->aesbuf_entry;
+			if (!se_dev->ioc)
+				priv->sg = se_dev->sg;
+
+			if (unlikely(se_dev->dynamic_mem)) {
+				priv->buf = se_dev->aes_buf;
+				priv->dynmem = se_dev->dynamic_mem;
+			} else {
+				priv->buf =
+					se_dev->aes_bufs[se_dev->aesbuf_entry];
+				priv->aesbuf_entry = se_dev->aesbuf_entry;
+			}
 		}
 
 		priv->buf_addr = se_dev->aes_addr;
@@ -2020,7 +2085,7 @@ static void tegra_se_send_data(struct tegra_se_dev *se_dev,
 		src_ll = se_dev->aes_src_ll;
 		dst_ll = se_dev->aes_dst_ll;
 		src_ll->addr = se_dev->aes_cur_addr;
-		dst_ll->addr = se_dev->aes_cur_addr;
+		dst_ll->addr = se_dev->aes_cur_dst_addr;
 		src_ll->data_len = req->cryptlen;
 		dst_ll->data_len = req->cryptlen;
 	} else {
@@ -2112,8 +2177,10 @@ static void tegra_se_send_data(struct tegra_se_dev *se_dev,
 
 	cmdbuf_num_words = i;
 	se_dev->cmdbuf_cnt = i;
-	if (req)
+	if (req) {
 		se_dev->aes_cur_addr += req->cryptlen;
+		se_dev->aes_cur_dst_addr += req->cryptlen;
+	}
 }
 
 static void tegra_se_send_gcm_data(struct tegra_se_dev *se_dev,
@@ -2317,10 +2384,55 @@ static int tegra_se_setup_ablk_req(struct tegra_se_dev *se_dev)
 	}
 
 	se_dev->aes_cur_addr = se_dev->aes_addr;
+	se_dev->aes_cur_dst_addr = se_dev->aes_addr;
 
 	return 0;
 }
 
+static int tegra_se_setup_ablk_req_direct(struct tegra_se_dev *se_dev)
+{
+	int i, err;
+
+	for (i = 0; i < se_dev->req_cnt; i++) {
+		err = tegra_se_map_direct_req(se_dev, se_dev->reqs[i]);
+		if (err) {
+			dev_err(se_dev->dev, "dma_map_sg  error\n");
+			while (i--)
+				tegra_se_unmap_direct_req(se_dev,
+							  se_dev->reqs[i]);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/* Undo tegra_se_setup_ablk_req{,_direct}() for a batch that was not run */
+static void tegra_se_release_ablk_req(struct tegra_se_dev *se_dev)
+{
+	int i;
+
+	if (se_dev->direct_map) {
+		for (i = 0; i < se_dev->req_cnt; i++)
+			tegra_se_unmap_direct_req(se_dev, se_dev->reqs[i]);
+		return;
+	}
+
+	if (!se_dev->ioc)
+		dma_unmap_sg(se_dev->dev, &se_dev->sg, 1, DMA_BIDIRECTIONAL);
+
+	if (unlikely(se_dev->dynamic_mem)) {
+		if (se_dev->ioc)
+			dma_free_coherent(se_dev->dev, se_dev->gather_buf_sz,
+					  se_dev->aes_buf,
+					  se_dev->aes_buf_addr);
+		else
+			kfree(se_dev->aes_buf);
+	} else {
+		atomic_set(&se_dev->aes_buf_stat[se_dev->aesbuf_entry], 1);
+	}
+}
+
 static int tegra_se_prepare_cmdbuf(struct tegra_se_dev *se_dev,
 				   u32 *cpuvaddr, dma_addr_t iova)
 {
@@ -2380,6 +2492,11 @@ static int tegra_se_prepare_cmdbuf(struct tegra_se_dev *se_dev,
 
 		req_ctx = skcipher_request_ctx(req);
 
+		if (se_dev->direct_map) {
+			se_dev->aes_cur_addr = sg_dma_address(req->src);
+			se_dev->aes_cur_dst_addr = sg_dma_address(req->dst);
+		}
+
 		if (req->iv) {
 			if (req_ctx->op_mode == SE_AES_OP_MODE_CTR ||
 			    req_ctx->op_mode == SE_AES_OP_MODE_XTS) {
@@ -2439,15 +2556,22 @@ static void tegra_se_process_new_req(struct tegra_se_dev *se_dev)
 
 	tegra_se_boost_cpu_freq(se_dev);
 
+	se_dev->direct_map = true;
 	for (i = 0; i < se_dev->req_cnt; i++) {
-		req = se_dev->reqs[i];
-		if (req->cryptlen != SE_STATIC_MEM_ALLOC_BUFSZ) {
-			se_dev->dynamic_mem = true;
+		if (!tegra_se_req_direct_ok(se_dev->reqs[i])) {
+			se_dev->direct_map = false;
 			break;
 		}
 	}
 
-	err = tegra_se_setup_ablk_req(se_dev);
+	if (se_dev->direct_map) {
+		err = tegra_se_setup_ablk_req_direct(se_dev);
+	} else {
+		/* the static buffers take any batch of up to their size */
+		if (se_dev->gather_buf_sz > SE_MAX_GATHER_BUF_SZ)
+			se_dev->dynamic_mem = true;
+		err = tegra_se_setup_ablk_req(se_dev);
+	}
 	if (err)
 		goto mem_out;
 
@@ -2472,6 +2596,7 @@ static void tegra_se_process_new_req(struct tegra_se_dev *se_dev)
 	if (err)
 		goto cmdbuf_out;
 	se_dev->dynamic_mem = false;
+	se_dev->direct_map = false;
 
 	pr_debug("%s:%d complete\n", __func__, __LINE__);
 
@@ -2479,8 +2604,7 @@ static void tegra_se_process_new_req(struct tegra_se_dev *se_dev)
 cmdbuf_out:
 	atomic_set(&se_dev->cmdbuf_addr_list[index].free, 1);
 index_out:
-	dma_unmap_sg(se_dev->dev, &se_dev->sg, 1, DMA_BIDIRECTIONAL);
-	kfree(se_dev->aes_buf);
+	tegra_se_release_ablk_req(se_dev);
 mem_out:
 	for (i = 0; i < se_dev->req_cnt; i++) {
 		req = se_dev->reqs[i];
@@ -2490,6 +2614,19 @@ mem_out:
 	se_dev->gather_buf_sz = 0;
 	se_dev->cmdbuf_cnt = 0;
 	se_dev->dynamic_mem = false;
+	se_dev->direct_map = false;
+}
+
+/* Whether the request at the head of the queue still fits a gather buffer */
+static bool tegra_se_next_req_fits(struct tegra_se_dev *se_dev)
+{
+	struct crypto_async_request *next;
+
+	next = list_first_entry(&se_dev->queue.list,
+				struct crypto_async_request, list);
+
+	return se_dev->gather_buf_sz + skcipher_request_cast(next)->cryptlen <=
+	       SE_MAX_GATHER_BUF_SZ;
 }
 
 static void tegra_se_work_handler(struct work_struct *work)
@@ -2526,7 +2663,8 @@ static void tegra_se_work_handler(struct work_struct *work)
 				break;
 			}
 		} while (se_dev->queue.qlen &&
-			 (se_dev->req_cnt < SE_MAX_TASKS_PER_SUBMIT));
+			 (se_dev->req_cnt < SE_MAX_TASKS_PER_SUBMIT) &&
+			 tegra_se_next_req_fits(se_dev));
 		mutex_unlock(&se_dev->lock);
 
 		if (process_requests)
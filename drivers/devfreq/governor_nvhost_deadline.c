@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Deadline and queue depth aware clock scaling for nvhost devices
+ *
+ * nvhost reports, next to the busy time of the sampling window, the number of
+ * jobs still pending on the engine, a moving average of the engine cycles a
+ * job costs and the earliest pending job deadline (struct
+ * nvhost_workload_stat). The governor computes the clock rate that drains the
+ * pending work before that deadline, or within a latency target when no
+ * deadline is known, and selects the lowest table frequency that satisfies
+ * both this rate and the throughput observed over the window.
+ *
+ */
+
+#include <linux/devfreq.h>
+#include <linux/debugfs.h>
+#include <linux/types.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/nvhost.h>
+#include <linux/platform_device.h>
+
+#ifndef GOVERNOR_POD_SCALING_V2_MODULE
+#include "governor.h"
+#else
+#include "governor_v2.h"
+#endif // GOVERNOR_POD_SCALING_V2_MODULE
+
+struct dlgov_info_rec {
+	int			suspended;
+
+	/* tunables */
+	unsigned int		p_load_target;
+	unsigned int		p_latency_target;
+	unsigned int		p_min_budget;
+	unsigned int		p_headroom;
+	unsigned int		p_miss_boost;
+	unsigned int		p_down_delay;
+
+	/* state */
+	u64			last_misses;
+	ktime_t			last_raise;
+
+	/* statistics */
+	u64			deadline_misses;
+	u64			freq_changes;
+
+	unsigned long		*freqlist;
+	int			freq_count;
+
+	struct dentry		*debugdir;
+};
+
+/*******************************************************************************
+ * freqlist_lowest(dlgov, target)
+ *
+ * Return the lowest table frequency that is not lower than target, or the
+ * highest table frequency if none is.
+ ******************************************************************************/
+
+static unsigned long freqlist_lowest(struct dlgov_info_rec *dlgov,
+				     unsigned long target)
+{
+	int i;
+
+	for (i = 0; i < dlgov->freq_count; i++)
+		if (dlgov->freqlist[i] >= target)
+			break;
+
+	return dlgov->freqlist[min(dlgov->freq_count - 1, i)];
+}
+
+/*******************************************************************************
+ * freqlist_up(dlgov, target, steps)
+ *
+ * Return the frequency "steps" table entries above target.
+ ******************************************************************************/
+
+static unsigned long freqlist_up(struct dlgov_info_rec *dlgov,
+				 unsigned long target, int steps)
+{
+	int i;
+
+	for (i = 0; i < dlgov->freq_count; i++)
+		if (dlgov->freqlist[i] >= target)
+			break;
+
+	return dlgov->freqlist[min(dlgov->freq_count - 1, i + steps)];
+}
+
+/*******************************************************************************
+ * nvhost_dl_workload(df)
+ *
+ * Return the nvhost workload summary of the device, or NULL if the device
+ * is not an nvhost engine and private_data is something else.
+ ******************************************************************************/
+
+static struct nvhost_workload_stat *nvhost_dl_workload(struct devfreq *df)
+{
+	struct nvhost_workload_stat *wl = df->last_status.private_data;
+
+	if (!wl || !df->dev.parent || !dev_is_platform(df->dev.parent))
+		return NULL;
+
+	if (wl->magic != NVHOST_WORKLOAD_STAT_MAGIC)
+		return NULL;
+
+	return wl;
+}
+
+/*******************************************************************************
+ * nvhost_dl_estimate_freq(df, freq)
+ *
+ * Called periodically by devfreq and on nvhost busy/idle notifications.
+ ******************************************************************************/
+
+static int nvhost_dl_estimate_freq(struct devfreq *df, unsigned long *freq)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+	struct nvhost_workload_stat *wl;
+	struct devfreq_dev_status *ds;
+	unsigned long cur, target = 0;
+	u64 budget_us, backlog, rem;
+	u64 load;
+	ktime_t now;
+	int err;
+
+	if (dlgov->suspended) {
+		*freq = DEVFREQ_MIN_FREQ;
+		return 0;
+	}
+
+	err = devfreq_update_stats(df);
+	if (err)
+		return err;
+
+	ds = &df->last_status;
+	wl = nvhost_dl_workload(df);
+	cur = ds->current_frequency;
+	now = ktime_get();
+
+	/* throughput: cycles used over the window, held at the target load */
+	if (ds->total_time) {
+		load = div64_u64((u64)ds->busy_time * 1000, ds->total_time);
+		target = mult_frac(cur, (unsigned long)min_t(u64, load, 1000),
+				   (unsigned long)dlgov->p_load_target);
+	}
+
+	if (wl && wl->queue_depth) {
+		/* latency: drain the backlog before the nearest deadline */
+		budget_us = dlgov->p_latency_target;
+		if (wl->next_deadline) {
+			s64 left = ktime_us_delta(wl->next_deadline, now);
+
+			budget_us = max_t(s64, left, dlgov->p_min_budget);
+		}
+
+		backlog = (u64)wl->queue_depth * wl->job_cycles_avg;
+		backlog = div64_u64_rem(backlog, budget_us, &rem) *
+			  USEC_PER_SEC +
+			  div64_u64(rem * USEC_PER_SEC, budget_us);
+		target = max_t(u64, target, backlog);
+	}
+
+	target += target / 100 * dlgov->p_headroom;
+	*freq = freqlist_lowest(dlgov, target);
+
+	/* jobs were late since the last sample, step above the current rate */
+	if (wl && wl->deadline_misses != dlgov->last_misses) {
+		dlgov->deadline_misses += wl->deadline_misses -
+					  dlgov->last_misses;
+		dlgov->last_misses = wl->deadline_misses;
+		*freq = max(*freq, freqlist_up(dlgov, cur, dlgov->p_miss_boost));
+	}
+
+	/* hold a raised clock for a while to avoid oscillating on bursts */
+	if (*freq > cur)
+		dlgov->last_raise = now;
+	else if (*freq < cur &&
+		 ktime_us_delta(now, dlgov->last_raise) < dlgov->p_down_delay)
+		*freq = cur;
+
+	if (*freq != cur)
+		dlgov->freq_changes++;
+
+	return 0;
+}
+
+/*******************************************************************************
+ * debugfs interface for tuning the governor on the fly
+ ******************************************************************************/
+
+#ifdef CONFIG_DEBUG_FS
+
+static int nvhost_dl_nonzero_get(void *data, u64 *val)
+{
+	*val = *(unsigned int *)data;
+	return 0;
+}
+
+static int nvhost_dl_nonzero_set(void *data, u64 val)
+{
+	if (!val || val > UINT_MAX)
+		return -EINVAL;
+
+	*(unsigned int *)data = val;
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(nvhost_dl_nonzero_fops, nvhost_dl_nonzero_get,
+			nvhost_dl_nonzero_set, "%llu\n");
+
+static void nvhost_dl_debug_init(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+	char dirname[128];
+
+	snprintf(dirname, sizeof(dirname), "%s_dl_scaling",
+		to_platform_device(df->dev.parent)->name);
+
+	dlgov->debugdir = debugfs_create_dir(dirname, NULL);
+	if (!dlgov->debugdir) {
+		pr_err("dlgov: can\'t create debugfs directory\n");
+		return;
+	}
+
+#define CREATE_DLGOV_FILE(fname) \
+	do {\
+		debugfs_create_u32(#fname, S_IRUGO | S_IWUSR, \
+			dlgov->debugdir, &dlgov->p_##fname); \
+	} while (0)
+
+	/* divisors of the frequency estimate, 0 is rejected */
+#define CREATE_DLGOV_NZ_FILE(fname) \
+	do {\
+		debugfs_create_file(#fname, S_IRUGO | S_IWUSR, \
+			dlgov->debugdir, &dlgov->p_##fname, \
+			&nvhost_dl_nonzero_fops); \
+	} while (0)
+
+	CREATE_DLGOV_NZ_FILE(load_target);
+	CREATE_DLGOV_NZ_FILE(latency_target);
+	CREATE_DLGOV_NZ_FILE(min_budget);
+	CREATE_DLGOV_FILE(headroom);
+	CREATE_DLGOV_FILE(miss_boost);
+	CREATE_DLGOV_FILE(down_delay);
+#undef CREATE_DLGOV_NZ_FILE
+#undef CREATE_DLGOV_FILE
+
+	debugfs_create_u64("deadline_misses", S_IRUGO, dlgov->debugdir,
+			   &dlgov->deadline_misses);
+	debugfs_create_u64("freq_changes", S_IRUGO, dlgov->debugdir,
+			   &dlgov->freq_changes);
+}
+
+static void nvhost_dl_debug_deinit(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+
+	debugfs_remove_recursive(dlgov->debugdir);
+}
+
+#else
+static void nvhost_dl_debug_init(struct devfreq *df)
+{
+	(void)df;
+}
+
+static void nvhost_dl_debug_deinit(struct devfreq *df)
+{
+	(void)df;
+}
+#endif
+
+static int nvhost_dl_init(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov;
+
+	if (!df->profile->freq_table || !df->profile->max_state)
+		return -EINVAL;
+
+	dlgov = kzalloc(sizeof(*dlgov), GFP_KERNEL);
+	if (!dlgov)
+		return -ENOMEM;
+
+	dlgov->freqlist = df->profile->freq_table;
+	dlgov->freq_count = df->profile->max_state;
+
+	/* Set scaling parameter defaults */
+	dlgov->p_load_target = 700;
+	dlgov->p_latency_target = 16000;
+	dlgov->p_min_budget = 500;
+	dlgov->p_headroom = 10;
+	dlgov->p_miss_boost = 2;
+	dlgov->p_down_delay = 50000;
+	dlgov->last_raise = ktime_get();
+
+	df->data = dlgov;
+
+	nvhost_dl_debug_init(df);
+	devfreq_monitor_start(df);
+
+	return 0;
+}
+
+static void nvhost_dl_exit(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+
+	devfreq_monitor_stop(df);
+	nvhost_dl_debug_deinit(df);
+	kfree(dlgov);
+}
+
+static void nvhost_dl_suspend(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+
+	dlgov->suspended = 1;
+
+	mutex_lock(&df->lock);
+	update_devfreq(df);
+	mutex_unlock(&df->lock);
+
+	devfreq_monitor_suspend(df);
+}
+
+static void nvhost_dl_resume(struct devfreq *df)
+{
+	struct dlgov_info_rec *dlgov = df->data;
+
+	dlgov->suspended = 0;
+	devfreq_monitor_resume(df);
+}
+
+static int nvhost_dl_event_handler(struct devfreq *df,
+			unsigned int event, void *data)
+{
+	int ret = 0;
+
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		ret = nvhost_dl_init(df);
+		break;
+	case DEVFREQ_GOV_STOP:
+		nvhost_dl_exit(df);
+		break;
+	case DEVFREQ_GOV_UPDATE_INTERVAL:
+		devfreq_update_interval(df, (unsigned int *)data);
+		break;
+	case DEVFREQ_GOV_SUSPEND:
+		nvhost_dl_suspend(df);
+		break;
+	case DEVFREQ_GOV_RESUME:
+		nvhost_dl_resume(df);
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+static struct devfreq_governor nvhost_dlgov = {
+	.name = "nvhost_deadline",
+	.get_target_freq = nvhost_dl_estimate_freq,
+	.event_handler = nvhost_dl_event_handler,
+};
+
+static int __init dlgov_init(void)
+{
+	return devfreq_add_governor(&nvhost_dlgov);
+}
+
+static void __exit dlgov_exit(void)
+{
+	devfreq_remove_governor(&nvhost_dlgov);
+}
+
+/* governor must be registered before initialising client devices */
+rootfs_initcall(dlgov_init);
+module_exit(dlgov_exit);
+MODULE_LICENSE("GPL");
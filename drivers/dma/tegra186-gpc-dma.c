@@ -167,6 +167,13 @@
 /* Channel base address offset from GPCDMA base address */
 #define TEGRA_GPCDMA_CHANNEL_BASE_ADD_OFFSET	0x10000
 
+/*
+ * Descriptors and sg requests a channel keeps in its pools once requested,
+ * so that the prep callbacks don't allocate from atomic context.
+ */
+#define TEGRA_GPCDMA_MIN_DESC			4
+#define TEGRA_GPCDMA_MIN_SG_REQ			32
+
 struct tegra_dma;
 
 /*
@@ -258,6 +265,8 @@ struct tegra_dma_channel {
 	struct list_head	pending_sg_req;
 	struct list_head	free_dma_desc;
 	struct list_head	cb_desc;
+	int			nr_desc;	/* descriptors owned */
+	int			nr_sg_req;	/* sg requests owned */
 
 	/* ISR handler and tasklet for bottom half of isr handling */
 	dma_isr_handler		isr_handler;
@@ -352,13 +361,14 @@ static void tegra_dma_desc_put(struct tegra_dma_channel *tdc,
 }
 
 static struct tegra_dma_desc *tegra_dma_desc_alloc(
-		struct tegra_dma_channel *tdc, bool prealloc)
+		struct tegra_dma_channel *tdc, bool prealloc, gfp_t gfp)
 {
 	struct tegra_dma_desc *dma_desc;
+	unsigned long flags;
 
 	BUG_ON(tdc2dev(tdc) == NULL);
 
-	dma_desc = devm_kzalloc(tdc2dev(tdc), sizeof(*dma_desc), GFP_ATOMIC);
+	dma_desc = devm_kzalloc(tdc2dev(tdc), sizeof(*dma_desc), gfp);
 	if (!dma_desc) {
 		dev_err(tdc2dev(tdc), "dma_desc alloc failed\n");
 		return NULL;
@@ -369,6 +379,10 @@ static struct tegra_dma_desc *tegra_dma_desc_alloc(
 
 	INIT_LIST_HEAD(&dma_desc->tx_list);
 
+	raw_spin_lock_irqsave(&tdc->lock, flags);
+	tdc->nr_desc++;
+	raw_spin_unlock_irqrestore(&tdc->lock, flags);
+
 	if (prealloc)
 		tegra_dma_desc_put(tdc, dma_desc);
 
@@ -396,7 +410,7 @@ static struct tegra_dma_desc *tegra_dma_desc_get(
 
 	raw_spin_unlock_irqrestore(&tdc->lock, flags);
 
-	return tegra_dma_desc_alloc(tdc, false);
+	return tegra_dma_desc_alloc(tdc, false, GFP_ATOMIC);
 }
 
 static void tegra_dma_sg_req_put(
@@ -421,14 +435,20 @@ static void tegra_dma_sg_req_put(
 
 static struct tegra_dma_sg_req *tegra_dma_sg_req_alloc(
 		struct tegra_dma_channel *tdc,
-		bool prealloc)
+		bool prealloc, gfp_t gfp)
 {
 	struct tegra_dma_sg_req *sg_req = NULL;
-	sg_req = devm_kzalloc(tdc2dev(tdc), sizeof(struct tegra_dma_sg_req), GFP_ATOMIC);
+	unsigned long flags;
+
+	sg_req = devm_kzalloc(tdc2dev(tdc), sizeof(struct tegra_dma_sg_req), gfp);
 	if (!sg_req) {
 		dev_err(tdc2dev(tdc), "sg_req alloc failed\n");
 		return NULL;
 	}
+
+	raw_spin_lock_irqsave(&tdc->lock, flags);
+	tdc->nr_sg_req++;
+	raw_spin_unlock_irqrestore(&tdc->lock, flags);
 	if (prealloc)
 		tegra_dma_sg_req_put(tdc, sg_req, true);
 	return sg_req;
@@ -450,7 +470,7 @@ static struct tegra_dma_sg_req *tegra_dma_sg_req_get(
 	}
 	raw_spin_unlock_irqrestore(&tdc->lock, flags);
 
-	return tegra_dma_sg_req_alloc(tdc, false);
+	return tegra_dma_sg_req_alloc(tdc, false, GFP_ATOMIC);
 }
 
 static int tegra_dma_slave_config(struct dma_chan *dc,
@@ -817,7 +837,13 @@ static irqreturn_t tegra_dma_isr(int irq, void *dev_id)
 				tdc->id, status);
 			tegra_dma_dump_chan_regs(tdc);
 		}
-		tasklet_schedule(&tdc->tasklet);
+		/*
+		 * Intermediate segments of a transfer only need the next one
+		 * programmed; run the bottom half only when there are
+		 * callbacks to deliver.
+		 */
+		if (!list_empty(&tdc->cb_desc))
+			tasklet_schedule(&tdc->tasklet);
 		raw_spin_unlock_irqrestore(&tdc->lock, flags);
 		return IRQ_HANDLED;
 	}
@@ -1683,27 +1709,38 @@ static int tegra_dma_alloc_chan_resources(struct dma_chan *dc)
 
 	dma_cookie_init(&tdc->dma_chan);
 	tdc->config_init = false;
+
+	/* Fill the pools here rather than in the prep callbacks */
+	while (tdc->nr_desc < TEGRA_GPCDMA_MIN_DESC)
+		if (!tegra_dma_desc_alloc(tdc, true, GFP_KERNEL))
+			break;
+
+	while (tdc->nr_sg_req < TEGRA_GPCDMA_MIN_SG_REQ)
+		if (!tegra_dma_sg_req_alloc(tdc, true, GFP_KERNEL))
+			break;
+
 	return 0;
 }
 
 static void tegra_dma_free_chan_resources(struct dma_chan *dc)
 {
 	struct tegra_dma_channel *tdc = to_tegra_dma_chan(dc);
-	struct list_head dma_desc_list;
-	struct list_head sg_req_list;
+	struct tegra_dma_desc *dma_desc;
 	unsigned long flags;
 
-	INIT_LIST_HEAD(&dma_desc_list);
-	INIT_LIST_HEAD(&sg_req_list);
-
 	dev_dbg(tdc2dev(tdc), "Freeing channel %d\n", tdc->id);
 
 	if (tdc->busy)
 		tegra_dma_terminate_all(dc);
 	raw_spin_lock_irqsave(&tdc->lock, flags);
-	list_splice_init(&tdc->pending_sg_req, &sg_req_list);
-	list_splice_init(&tdc->free_sg_req, &sg_req_list);
-	list_splice_init(&tdc->free_dma_desc, &dma_desc_list);
+	/*
+	 * Keep the descriptors pooled for the next user of the channel; they
+	 * are devm allocated and dropping them here only leaked them until
+	 * the controller was unbound.
+	 */
+	list_splice_init(&tdc->pending_sg_req, &tdc->free_sg_req);
+	list_for_each_entry(dma_desc, &tdc->free_dma_desc, node)
+		async_tx_ack(&dma_desc->txd);
 	INIT_LIST_HEAD(&tdc->cb_desc);
 	tdc->config_init = false;
 	tdc->isr_handler = NULL;
@@ -1943,11 +1980,11 @@ static int tegra_dma_probe(struct platform_device *pdev)
 		 * pre-allocate stuff
 		 */
 		for (p = 0; p < preallocated_desc; p++)
-			if (!tegra_dma_desc_alloc(tdc, true))
+			if (!tegra_dma_desc_alloc(tdc, true, GFP_KERNEL))
 				break;
 
 		for (p = 0; p < preallocated_sg; p++)
-			if (!tegra_dma_sg_req_alloc(tdc, true))
+			if (!tegra_dma_sg_req_alloc(tdc, true, GFP_KERNEL))
 				break;
 
 		/* program stream-id for this channel */
@@ -1942,12 +1942,23 @@ static int bmi_read_gyr(struct bmi_state *st)
 			if (ret)
 				break; /* do while (n) */
 
-			for (i = 0, buf_i = 0; i < buf_n; i++) {
-				st->ts[BMI_HW_GYR] += ts2;
-				st->nvs->handler(st->snsrs[snsr_id].nvs_st,
-						 &st->buf_gyr[buf_i],
-						 st->ts[BMI_HW_GYR]);
-				buf_i += BMI_REG_GYR_DATA_N;
+			if (st->nvs->handler_batch) {
+				st->nvs->handler_batch(
+						st->snsrs[snsr_id].nvs_st,
+						st->buf_gyr,
+						BMI_REG_GYR_DATA_N,
+						st->ts[BMI_HW_GYR] + ts2,
+						ts2, buf_n);
+				st->ts[BMI_HW_GYR] += ts2 * buf_n;
+			} else {
+				for (i = 0, buf_i = 0; i < buf_n; i++) {
+					st->ts[BMI_HW_GYR] += ts2;
+					st->nvs->handler(
+						st->snsrs[snsr_id].nvs_st,
+						&st->buf_gyr[buf_i],
+						st->ts[BMI_HW_GYR]);
+					buf_i += BMI_REG_GYR_DATA_N;
+				}
 			}
 
 			n -= buf_n;
@@ -47,6 +47,7 @@
 #include "vivid-vbi-out.h"
 #include "vivid-osd.h"
 #include "vivid-ctrls.h"
+#include "vivid-kthread-cap.h"
 
 #define VIVID_MODULE_NAME "tegra-vivid"
 
@@ -148,6 +149,19 @@ MODULE_PARM_DESC(output_types, " output types, default is 0x02. One bit per outp
 			      "\t\t    bit 0 == output 0, bit 15 == output 15.\n"
 			      "\t\t    Type 0 == S-Video, 1 == HDMI");
 
+/* Default: render video capture frames on the capture thread only */
+static unsigned vid_cap_slices[VIVID_MAX_DEVS] = { [0 ... (VIVID_MAX_DEVS - 1)] = 1 };
+module_param_array(vid_cap_slices, uint, NULL, 0444);
+MODULE_PARM_DESC(vid_cap_slices, " number of slices a capture frame is rendered in\n"
+				 "\t\t    in parallel on a worker pool, default is 1, max is 16");
+
+static unsigned frame_cache[VIVID_MAX_DEVS];
+module_param_array(frame_cache, uint, NULL, 0444);
+MODULE_PARM_DESC(frame_cache, " number of rendered capture frames that are replayed\n"
+			      "\t\t    with only the text overlay redrawn, default is 0 (off),\n"
+			      "\t\t    odd values are rounded up to keep field parity.\n"
+			      "\t\t    Control changes take effect on the next stream start");
+
 unsigned vivid_debug;
 module_param(vivid_debug, uint, 0644);
 MODULE_PARM_DESC(vivid_debug, " activates debug info");
@@ -405,8 +419,11 @@ static int vidioc_log_status(struct file *file, void *fh)
 	struct video_device *vdev = video_devdata(file);
 
 	v4l2_ctrl_log_status(file, fh);
-	if (vdev->vfl_dir == VFL_DIR_RX && vdev->vfl_type == VFL_TYPE_GRABBER)
+	if (vdev->vfl_dir == VFL_DIR_RX && vdev->vfl_type == VFL_TYPE_GRABBER) {
 		tpg_log_status(&dev->tpg);
+		v4l2_info(&dev->v4l2_dev, "achieved frame rate: %u.%02u fps\n",
+			  dev->vid_cap_fps / 100, dev->vid_cap_fps % 100);
+	}
 	return 0;
 }
 
@@ -643,6 +660,8 @@ static void vivid_dev_release(struct v4l2_device *v4l2_dev)
 
 	vivid_free_controls(dev);
 	v4l2_device_unregister(&dev->v4l2_dev);
+	if (dev->slice_wq)
+		destroy_workqueue(dev->slice_wq);
 	vfree(dev->scaled_line);
 	vfree(dev->blended_line);
 	vfree(dev->edid);
@@ -886,6 +905,26 @@ static int vivid_create_instance(struct platform_device *pdev, int inst)
 	if (!dev->blended_line)
 		goto free_dev;
 
+	/* set up the capture slice workers and the frame cache */
+	dev->vid_cap_slices = clamp(vid_cap_slices[inst], 1U, MAX_VID_CAP_SLICES);
+	if (dev->vid_cap_slices > 1) {
+		dev->slice_wq = alloc_workqueue("%s-slice",
+				WQ_UNBOUND | WQ_HIGHPRI, dev->vid_cap_slices,
+				dev->v4l2_dev.name);
+		if (!dev->slice_wq)
+			goto free_dev;
+		for (i = 0; i < dev->vid_cap_slices; i++) {
+			dev->slice_work[i].dev = dev;
+			INIT_WORK(&dev->slice_work[i].work, vivid_slice_work_fn);
+		}
+	}
+	/*
+	 * Keep the cache size even so that a cached frame is always replayed
+	 * for a sequence number of the same parity, i.e. the same field.
+	 */
+	dev->frame_cache_size = round_up(min(frame_cache[inst],
+					     (unsigned)MAX_FRAME_CACHE), 2);
+
 	/* load the edid */
 	dev->edid = vmalloc(256 * 128);
 	if (!dev->edid)
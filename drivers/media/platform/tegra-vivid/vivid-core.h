@@ -21,6 +21,7 @@
 #define _VIVID_CORE_H_
 
 #include <linux/fb.h>
+#include <linux/workqueue.h>
 #include <linux/version.h>
 #include <media/videobuf2-v4l2.h>
 #include <media/v4l2-device.h>
@@ -64,6 +65,10 @@
 /* Metadata height max/default */
 #define MAX_METADATA_HEIGHT 16
 #define DEF_METADATA_HEIGHT 1
+/* The maximum number of slices a capture frame is rendered in */
+#define MAX_VID_CAP_SLICES 16
+/* The maximum number of rendered frames replayed in frame cache mode */
+#define MAX_FRAME_CACHE 16
 /* The data_offset of plane 0 for the multiplanar formats */
 #define PLANE0_DATA_OFFSET 128
 
@@ -98,6 +103,19 @@ struct vivid_fmt {
 
 extern struct vivid_fmt vivid_formats[];
 
+struct vivid_dev;
+
+/* one slice of a capture frame rendered on the slice workqueue */
+struct vivid_slice_work {
+	struct work_struct	work;
+	struct vivid_dev	*dev;
+	v4l2_std_id		std;
+	unsigned		plane;
+	u8			*vbuf;
+	unsigned		first;
+	unsigned		last;
+};
+
 /* buffer for one video frame */
 struct vivid_buffer {
 	/* common v4l buffer stuff -- must be first */
@@ -411,6 +429,21 @@ struct vivid_dev {
 	u32				embedded_data_height;
 	u32				fmt_out_metadata_height;
 
+	/* parallel slice rendering of video capture frames */
+	unsigned			vid_cap_slices;
+	struct workqueue_struct		*slice_wq;
+	struct vivid_slice_work		slice_work[MAX_VID_CAP_SLICES];
+
+	/* replay of pre-rendered video capture frames */
+	unsigned			frame_cache_size;
+	void				*frame_cache[MAX_FRAME_CACHE][TPG_MAX_PLANES];
+	u32				frame_cache_valid[MAX_FRAME_CACHE];
+
+	/* achieved video capture frame rate, in 1/100 fps */
+	unsigned			vid_cap_fps;
+	unsigned			vid_cap_fps_frames;
+	unsigned long			jiffies_vid_cap_fps;
+
 	/* added for NV sensor emulation */
 	struct sensor_properties	sensor_props;
 
@@ -29,6 +29,8 @@
 #include <linux/kthread.h>
 #include <linux/freezer.h>
 #include <linux/random.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <linux/v4l2-dv-timings.h>
 #include <asm/div64.h>
 #include <media/videobuf2-vmalloc.h>
@@ -438,6 +440,115 @@ update_vid_out_y:
 	return 0;
 }
 
+void vivid_slice_work_fn(struct work_struct *work)
+{
+	struct vivid_slice_work *sw =
+		container_of(work, struct vivid_slice_work, work);
+
+	tpg_fill_plane_lines(&sw->dev->tpg, sw->std, sw->plane, sw->vbuf,
+			     sw->first, sw->last);
+}
+
+/*
+ * Render a plane as horizontal slices: all but the first slice are queued
+ * on the slice workqueue, the first one is rendered by the capture thread.
+ */
+static void vivid_fill_plane_sliced(struct vivid_dev *dev, unsigned p, u8 *vbuf)
+{
+	struct tpg_data *tpg = &dev->tpg;
+	v4l2_std_id std = vivid_get_std_cap(dev);
+	unsigned height = tpg->compose.height;
+	unsigned step;
+	unsigned i, n;
+
+	if (dev->vid_cap_slices <= 1) {
+		tpg_fill_plane_buffer(tpg, std, p, vbuf);
+		return;
+	}
+
+	tpg_fill_plane_prepare(tpg);
+
+	/* keep groups of 4 lines together for vertically downsampled planes */
+	step = round_up(DIV_ROUND_UP(height, dev->vid_cap_slices), 4);
+
+	for (n = 1; n < dev->vid_cap_slices && n * step < height; n++) {
+		struct vivid_slice_work *sw = &dev->slice_work[n];
+
+		sw->std = std;
+		sw->plane = p;
+		sw->vbuf = vbuf;
+		sw->first = n * step;
+		sw->last = min(height, (n + 1) * step);
+		queue_work(dev->slice_wq, &sw->work);
+	}
+
+	tpg_fill_plane_lines(tpg, std, p, vbuf, 0, min(height, step));
+
+	for (i = 1; i < n; i++)
+		flush_work(&dev->slice_work[i].work);
+}
+
+/*
+ * Render a plane, or copy it from the frame cache if this frame was rendered
+ * before. Frames are cached per sequence number modulo the cache size, so a
+ * stream replays the first frame_cache_size frames of the test pattern. The
+ * cache size is even, so the field parity of a replayed frame is preserved.
+ */
+static void vivid_fill_plane(struct vivid_dev *dev, struct vivid_buffer *buf,
+			     unsigned p, u8 *vbuf)
+{
+	unsigned size = tpg_calc_plane_size(&dev->tpg, p);
+	unsigned slot;
+
+	if (!dev->frame_cache_size || dev->must_blank[buf->vb.vb2_buf.index]) {
+		vivid_fill_plane_sliced(dev, p, vbuf);
+		return;
+	}
+
+	slot = dev->vid_cap_seq_count % dev->frame_cache_size;
+	if (dev->frame_cache_valid[slot] & BIT(p)) {
+		memcpy(vbuf, dev->frame_cache[slot][p], size);
+		return;
+	}
+
+	vivid_fill_plane_sliced(dev, p, vbuf);
+
+	if (!dev->frame_cache[slot][p])
+		dev->frame_cache[slot][p] = vmalloc(size);
+	if (dev->frame_cache[slot][p]) {
+		memcpy(dev->frame_cache[slot][p], vbuf, size);
+		dev->frame_cache_valid[slot] |= BIT(p);
+	}
+}
+
+static void vivid_free_frame_cache(struct vivid_dev *dev)
+{
+	unsigned i, p;
+
+	for (i = 0; i < MAX_FRAME_CACHE; i++) {
+		for (p = 0; p < TPG_MAX_PLANES; p++) {
+			vfree(dev->frame_cache[i][p]);
+			dev->frame_cache[i][p] = NULL;
+		}
+		dev->frame_cache_valid[i] = 0;
+	}
+}
+
+static void vivid_update_fps(struct vivid_dev *dev)
+{
+	unsigned long elapsed = jiffies - dev->jiffies_vid_cap_fps;
+
+	dev->vid_cap_fps_frames++;
+	if (elapsed < HZ)
+		return;
+
+	dev->vid_cap_fps = dev->vid_cap_fps_frames * HZ * 100 / elapsed;
+	dev->vid_cap_fps_frames = 0;
+	dev->jiffies_vid_cap_fps = jiffies;
+	dprintk(dev, 1, "achieved %u.%02u fps\n",
+		dev->vid_cap_fps / 100, dev->vid_cap_fps % 100);
+}
+
 static void vivid_fillbuff(struct vivid_dev *dev, struct vivid_buffer *buf)
 {
 	struct tpg_data *tpg = &dev->tpg;
@@ -512,8 +623,7 @@ static void vivid_fillbuff(struct vivid_dev *dev, struct vivid_buffer *buf)
 		tpg_calc_text_basep(tpg, basep, p, vbuf);
 		if (!is_loop || vivid_copy_buffer(dev, p, vbuf, buf)) {
 			if (!dev->fmt_cap->is_metadata[p]) {
-				tpg_fill_plane_buffer(tpg, vivid_get_std_cap(dev),
-					p, vbuf);
+				vivid_fill_plane(dev, buf, p, vbuf);
 				vivid_trace_single_msg(dev->v4l2_dev.name,
 					"fillbuf-cap-noloop",
 					buf->vb.vb2_buf.index);
@@ -755,6 +865,7 @@ static void vivid_thread_vid_cap_tick(struct vivid_dev *dev, int dropped_bufs)
 				VB2_BUF_STATE_ERROR : VB2_BUF_STATE_DONE);
 		dprintk(dev, 2, "vid_cap buffer %d done\n",
 				vid_cap_buf->vb.vb2_buf.index);
+		vivid_update_fps(dev);
 	}
 
 	if (vbi_cap_buf) {
@@ -805,6 +916,9 @@ static int vivid_thread_vid_cap(void *data)
 	dev->cap_seq_count = 0;
 	dev->cap_seq_resync = false;
 	dev->next_jiffies_vid_cap = dev->jiffies_vid_cap;
+	dev->jiffies_vid_cap_fps = dev->jiffies_vid_cap;
+	dev->vid_cap_fps_frames = 0;
+	dev->vid_cap_fps = 0;
 	dev->cap_thread_active = true;
 	mutex_unlock(&dev->mutex);
 
@@ -982,5 +1096,6 @@ void vivid_stop_generating_vid_cap(struct vivid_dev *dev, bool *pstreaming)
 	kthread_stop(dev->kthread_vid_cap);
 	dev->kthread_vid_cap = NULL;
 	dev->cap_thread_active = false;
+	vivid_free_frame_cache(dev);
 	mutex_lock(&dev->mutex);
 }
@@ -209,6 +209,14 @@ void tpg_calc_text_basep(struct tpg_data *tpg,
 unsigned tpg_g_interleaved_plane(const struct tpg_data *tpg, unsigned buf_line);
 void tpg_fill_plane_buffer(struct tpg_data *tpg, v4l2_std_id std,
 			   unsigned p, u8 *vbuf);
+/*
+ * Render only compose lines [first, last) of a plane. tpg_fill_plane_prepare()
+ * must be called first; after that tpg is only read, so disjoint line ranges
+ * of the same plane may be rendered concurrently.
+ */
+void tpg_fill_plane_prepare(struct tpg_data *tpg);
+void tpg_fill_plane_lines(const struct tpg_data *tpg, v4l2_std_id std,
+			  unsigned p, u8 *vbuf, unsigned first, unsigned last);
 void tpg_fillbuffer(struct tpg_data *tpg, v4l2_std_id std,
 		    unsigned p, u8 *vbuf);
 bool tpg_s_fourcc(struct tpg_data *tpg, u32 fourcc, u32 metadata_height);
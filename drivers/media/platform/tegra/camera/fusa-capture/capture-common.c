@@ -21,10 +21,14 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/nospec.h>
+#include <linux/mm.h>
 #include <linux/nvhost.h>
 #include <linux/slab.h>
+#include <linux/uaccess.h>
 #include <linux/hashtable.h>
+#include <linux/rculist.h>
 #include <linux/atomic.h>
+#include <linux/mutex.h>
 #include <media/mc_common.h>
 
 #include <media/fusa-capture/capture-common.h>
@@ -36,8 +40,10 @@
 struct capture_buffer_table {
 	struct device *dev; /**< Originating device (VI or ISP) */
 	struct kmem_cache *cache; /**< SLAB allocator cache */
-	rwlock_t hlock; /**< Reader/writer lock on table contents */
-	DECLARE_HASHTABLE(hhead, 4U); /**< Buffer hashtable head */
+	struct mutex req_lock; /**< Serializes buffer add/remove requests */
+	spinlock_t hlock;
+		/**< Lock on table updates, lookups are RCU protected */
+	DECLARE_HASHTABLE(hhead, 8U); /**< Buffer hashtable head */
 };
 
 /**
@@ -66,6 +72,8 @@ struct capture_mapping {
 		/**< dma_buf attachment (VI or ISP device) */
 	struct sg_table *sgt; /**< Scatterlist to dma_buf attachment */
 	unsigned int flag; /**< Bitmask access flag */
+	struct kmem_cache *cache; /**< SLAB cache the mapping belongs to */
+	struct rcu_head rcu; /**< Deferred free after RCU lookups drain */
 };
 
 /**
@@ -184,11 +192,27 @@ static inline void set_mapping_preservation(
 	}
 }
 
+/**
+ * @brief Free a capture mapping once no RCU reader can reference it anymore.
+ *
+ * @param[in]	head	The rcu_head of the capture_mapping
+ */
+static void free_mapping_rcu(
+	struct rcu_head *head)
+{
+	struct capture_mapping *pin =
+		container_of(head, struct capture_mapping, rcu);
+
+	kmem_cache_free(pin->cache, pin);
+}
+
 /**
  * @brief Iteratively search a capture buffer management table to find the entry
  * with @a buf, and @a flag bits set in the capture mapping.
  *
  * On success, the capture mapping is incremented by one if it is non-zero.
+ * The lookup is lockless; mappings are only freed after an RCU grace period
+ * and a mapping whose refcnt already dropped to zero is skipped.
  *
  * @param[in]	tab	The capture buffer management table
  * @param[in]	buf	The mapping dma_buf pointer to match
@@ -204,22 +228,22 @@ static struct capture_mapping *find_mapping(
 	struct capture_mapping *pin;
 	bool success;
 
-	read_lock(&tab->hlock);
+	rcu_read_lock();
 
-	hash_for_each_possible(tab->hhead, pin, hnode, (unsigned long)buf) {
+	hash_for_each_possible_rcu(tab->hhead, pin, hnode, (unsigned long)buf) {
 		if (
 			(pin->buf == buf) &&
-			flag_compatible(pin->flag, flag)
+			flag_compatible(READ_ONCE(pin->flag), flag)
 		) {
 			success =  atomic_inc_not_zero(&pin->refcnt);
 			if (success) {
-				read_unlock(&tab->hlock);
+				rcu_read_unlock();
 				return pin;
 			}
 		}
 	}
 
-	read_unlock(&tab->hlock);
+	rcu_read_unlock();
 
 	return NULL;
 }
@@ -281,12 +305,13 @@ static struct capture_mapping *get_mapping(
 
 	pin->flag = flag;
 	pin->buf = buf;
+	pin->cache = tab->cache;
 	atomic_set(&pin->refcnt, 1U);
 	INIT_HLIST_NODE(&pin->hnode);
 
-	write_lock(&tab->hlock);
-	hash_add(tab->hhead, &pin->hnode, (unsigned long)pin->buf);
-	write_unlock(&tab->hlock);
+	spin_lock(&tab->hlock);
+	hash_add_rcu(tab->hhead, &pin->hnode, (unsigned long)pin->buf);
+	spin_unlock(&tab->hlock);
 
 	return pin;
 err2:
@@ -313,7 +338,8 @@ struct capture_buffer_table *create_buffer_table(
 		if (likely(tab->cache != NULL)) {
 			tab->dev = dev;
 			hash_init(tab->hhead);
-			rwlock_init(&tab->hlock);
+			mutex_init(&tab->req_lock);
+			spin_lock_init(&tab->hlock);
 		} else {
 			kfree(tab);
 			tab = NULL;
@@ -333,26 +359,39 @@ void destroy_buffer_table(
 	if (unlikely(tab == NULL))
 		return;
 
-	write_lock(&tab->hlock);
+	mutex_lock(&tab->req_lock);
 
 	hash_for_each_safe(tab->hhead, bkt, next, pin, hnode) {
-		hash_del(&pin->hnode);
+		spin_lock(&tab->hlock);
+		hash_del_rcu(&pin->hnode);
+		spin_unlock(&tab->hlock);
+
 		dma_buf_unmap_attachment(
 			pin->atch, pin->sgt, flag_dma_direction(pin->flag));
 		dma_buf_detach(pin->buf, pin->atch);
 		dma_buf_put(pin->buf);
-		kmem_cache_free(tab->cache, pin);
+		call_rcu(&pin->rcu, free_mapping_rcu);
 	}
 
-	write_unlock(&tab->hlock);
+	mutex_unlock(&tab->req_lock);
 
+	/* wait for the deferred frees before the cache goes away */
+	rcu_barrier();
 	kmem_cache_destroy(tab->cache);
 	kfree(tab);
 }
 
-static DEFINE_MUTEX(req_lock);
-
-int capture_buffer_request(
+/**
+ * @brief Perform a buffer management operation, with the table's request lock
+ * held.
+ *
+ * @param[in,out]	tab	Surface buffer management table
+ * @param[in]		memfd	FD or NvRm handle to buffer
+ * @param[in]		flag	Surface BUFFER_* op bitmask
+ *
+ * @returns		0 (success), neg. errno (failure)
+ */
+static int capture_buffer_request_locked(
 	struct capture_buffer_table *tab,
 	uint32_t memfd,
 	uint32_t flag)
@@ -362,12 +401,7 @@ int capture_buffer_request(
 	bool add = (bool)(flag & BUFFER_ADD);
 	int err = 0;
 
-	if (unlikely(tab == NULL)) {
-		pr_err("%s: invalid buffer table\n", __func__);
-		return -EINVAL;
-	}
-
-	mutex_lock(&req_lock);
+	lockdep_assert_held(&tab->req_lock);
 
 	if (add) {
 		pin = get_mapping(tab, memfd, flag_access_mode(flag));
@@ -409,7 +443,69 @@ int capture_buffer_request(
 	put_mapping(tab, pin);
 
 end:
-	mutex_unlock(&req_lock);
+	return err;
+}
+
+int capture_buffer_request(
+	struct capture_buffer_table *tab,
+	uint32_t memfd,
+	uint32_t flag)
+{
+	int err;
+
+	if (unlikely(tab == NULL)) {
+		pr_err("%s: invalid buffer table\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&tab->req_lock);
+	err = capture_buffer_request_locked(tab, memfd, flag);
+	mutex_unlock(&tab->req_lock);
+
+	return err;
+}
+
+int capture_buffer_request_vec(
+	struct capture_buffer_table *tab,
+	const struct capture_buffer_req __user *reqs,
+	uint32_t num_reqs,
+	uint32_t *num_done)
+{
+	struct capture_buffer_req *kreqs;
+	uint32_t i;
+	int err = 0;
+
+	*num_done = 0U;
+
+	if (unlikely(tab == NULL)) {
+		pr_err("%s: invalid buffer table\n", __func__);
+		return -EINVAL;
+	}
+
+	if (num_reqs == 0U || num_reqs > MAX_BUFFER_REQUESTS_PER_CALL)
+		return -EINVAL;
+
+	kreqs = kvmalloc_array(num_reqs, sizeof(*kreqs), GFP_KERNEL);
+	if (unlikely(kreqs == NULL))
+		return -ENOMEM;
+
+	if (copy_from_user(kreqs, reqs, num_reqs * sizeof(*kreqs)) != 0U) {
+		err = -EFAULT;
+		goto free;
+	}
+
+	mutex_lock(&tab->req_lock);
+	for (i = 0U; i < num_reqs; i++) {
+		err = capture_buffer_request_locked(
+			tab, kreqs[i].mem, kreqs[i].flag);
+		if (err < 0)
+			break;
+	}
+	mutex_unlock(&tab->req_lock);
+
+	*num_done = i;
+free:
+	kvfree(kreqs);
 	return err;
 }
 
@@ -435,15 +531,15 @@ void put_mapping(
 			return;
 		}
 
-		write_lock(&t->hlock);
-		hash_del(&pin->hnode);
-		write_unlock(&t->hlock);
+		spin_lock(&t->hlock);
+		hash_del_rcu(&pin->hnode);
+		spin_unlock(&t->hlock);
 
 		dma_buf_unmap_attachment(
 			pin->atch, pin->sgt, flag_dma_direction(pin->flag));
 		dma_buf_detach(pin->buf, pin->atch);
 		dma_buf_put(pin->buf);
-		kmem_cache_free(t->cache, pin);
+		call_rcu(&pin->rcu, free_mapping_rcu);
 	}
 }
 
@@ -208,6 +208,17 @@ struct isp_channel_drv {
 #define ISP_CAPTURE_BUFFER_REQUEST \
 	_IOW('I', 11, struct isp_buffer_req)
 
+/**
+ * @brief Perform a batch of ISP buffer operations with a single call. The
+ * operations are performed in order and processing stops at the first
+ * failure; @a num_done returns the number of operations completed.
+ *
+ * @param[in,out]	ptr	Pointer to a struct @ref isp_buffer_req_vec.
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define ISP_CAPTURE_BUFFER_REQUEST_VEC \
+	_IOWR('I', 12, struct isp_buffer_req_vec)
+
 /** @} */
 
 /**
@@ -527,6 +538,21 @@ static long isp_channel_ioctl(
 			dev_err(chan->isp_dev, "isp buffer req failed\n");
 		break;
 	}
+	case _IOC_NR(ISP_CAPTURE_BUFFER_REQUEST_VEC): {
+		struct isp_buffer_req_vec req;
+
+		if (copy_from_user(&req, ptr, sizeof(req)) != 0U)
+			break;
+
+		err = isp_capture_buffer_request_vec(chan, &req);
+		if (err < 0)
+			dev_err(chan->isp_dev,
+				"isp buffer req failed at %u of %u\n",
+				req.num_done, req.num_reqs);
+		if (copy_to_user(ptr, &req, sizeof(req)) != 0U)
+			err = -EFAULT;
+		break;
+	}
 	default: {
 		dev_err(chan->isp_dev, "%s:Unknown ioctl\n", __func__);
 		return -ENOIOCTLCMD;
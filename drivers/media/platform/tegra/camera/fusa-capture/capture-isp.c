@@ -2078,3 +2078,17 @@ int isp_capture_buffer_request(
 		capture->buffer_ctx, req->mem, req->flag);
 	return err;
 }
+
+int isp_capture_buffer_request_vec(
+	struct tegra_isp_channel *chan,
+	struct isp_buffer_req_vec *req)
+{
+	struct isp_capture *capture = chan->capture_data;
+	int err;
+
+	err = capture_buffer_request_vec(capture->buffer_ctx,
+		(const struct capture_buffer_req __user *)
+			(uintptr_t)req->reqs,
+		req->num_reqs, &req->num_done);
+	return err;
+}
@@ -178,6 +178,18 @@
 #define VI_CAPTURE_BUFFER_REQUEST \
 	_IOW('I', 10, struct vi_buffer_req)
 
+/**
+ * @brief Perform a batch of surface buffer operations, e.g. register all the
+ * surfaces of a stream, with a single call. The operations are performed in
+ * order and processing stops at the first failure; @a num_done returns the
+ * number of operations completed.
+ *
+ * @param[in,out]	ptr	Pointer to a struct @ref vi_buffer_req_vec
+ * @returns	0 (success), neg. errno (failure)
+ */
+#define VI_CAPTURE_BUFFER_REQUEST_VEC \
+	_IOWR('I', 11, struct vi_buffer_req_vec)
+
 /** @} */
 
 void vi_capture_request_unpin(
@@ -649,6 +661,25 @@ static long vi_channel_ioctl(
 		break;
 	}
 
+	case _IOC_NR(VI_CAPTURE_BUFFER_REQUEST_VEC): {
+		struct vi_buffer_req_vec req;
+
+		if (copy_from_user(&req, ptr, sizeof(req)) != 0U)
+			break;
+
+		err = capture_buffer_request_vec(capture->buf_ctx,
+			(const struct capture_buffer_req __user *)
+				(uintptr_t)req.reqs,
+			req.num_reqs, &req.num_done);
+		if (err < 0)
+			dev_err(chan->dev,
+				"vi buffer request failed at %u of %u\n",
+				req.num_done, req.num_reqs);
+		if (copy_to_user(ptr, &req, sizeof(req)) != 0U)
+			err = -EFAULT;
+		break;
+	}
+
 	default: {
 		dev_err(chan->dev, "%s:Unknown ioctl\n", __func__);
 		return -ENOIOCTLCMD;
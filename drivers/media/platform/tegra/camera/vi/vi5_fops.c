@@ -14,10 +14,15 @@
 #include <linux/fs.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/nvhost.h>
+#include <linux/sched.h>
 #include <linux/errno.h>
 #include <linux/semaphore.h>
 #include <linux/version.h>
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#include <uapi/linux/sched/types.h>
+#endif
 #include <media/tegra_camera_platform.h>
 #include <media/mc_common.h>
 #include <media/tegra-v4l2-camera.h>
@@ -41,6 +46,20 @@
 
 #define CAPTURE_TIMEOUT_MS	2500
 
+/*
+ * Scheduling of the per-channel enqueue and dequeue kthreads. With several
+ * ganged ports at high frame rates, running them SCHED_FIFO and on a CPU of
+ * choice keeps frame completion jitter down.
+ */
+static int kthread_rt_prio;
+module_param(kthread_rt_prio, int, 0644);
+MODULE_PARM_DESC(kthread_rt_prio,
+	"SCHED_FIFO priority of the capture kthreads, 0 for SCHED_NORMAL");
+
+static int kthread_cpu = -1;
+module_param(kthread_cpu, int, 0644);
+MODULE_PARM_DESC(kthread_cpu, "CPU to run the capture kthreads on, -1 for any");
+
 static const struct vi_capture_setup default_setup = {
 	.channel_flags = 0
 	| CAPTURE_CHANNEL_FLAG_VIDEO
@@ -447,34 +466,38 @@ static void vi5_capture_enqueue(struct tegra_channel *chan,
 		.buffer_index = 0,
 	}};
 
+	/* prepare the descriptors of all ports before submitting any */
 	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 		vi5_setup_surface(chan, buf, chan->capture_descr_index, vi_port);
 		request[vi_port].buffer_index = chan->capture_descr_index;
+		buf->capture_descr_index[vi_port] = chan->capture_descr_index;
+	}
 
+	/* then issue the ganged requests back to back */
+	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 		err = vi_capture_request(chan->tegra_vi_channel[vi_port], &request[vi_port]);
 
 		if (err) {
 			dev_err(vi->dev, "uncorr_err: request dispatch err %d\n", err);
 			goto uncorr_err;
 		}
+	}
 
-		spin_lock_irqsave(&chan->capture_state_lock, flags);
-		if (chan->capture_state != CAPTURE_ERROR) {
-			chan->capture_state = CAPTURE_GOOD;
-			chan->capture_reqs_enqueued += 1;
-		}
-		spin_unlock_irqrestore(&chan->capture_state_lock, flags);
-		buf->capture_descr_index[vi_port] = chan->capture_descr_index;
+	spin_lock_irqsave(&chan->capture_state_lock, flags);
+	if (chan->capture_state != CAPTURE_ERROR) {
+		chan->capture_state = CAPTURE_GOOD;
+		chan->capture_reqs_enqueued += chan->valid_ports;
 	}
+	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+
 	chan->capture_descr_index = ((chan->capture_descr_index + 1)
 					% (chan->capture_queue_depth));
 
+	/* the enqueue kthread wakes the dequeue side once per batch */
 	spin_lock(&chan->dequeue_lock);
 	list_add_tail(&buf->queue, &chan->dequeue);
 	spin_unlock(&chan->dequeue_lock);
 
-	wake_up_interruptible(&chan->dequeue_wait);
-
 	return;
 
 uncorr_err:
@@ -483,6 +506,21 @@ uncorr_err:
 	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
 }
 
+static void vi5_capture_retire(struct tegra_channel *chan, int nr_reqs)
+{
+	unsigned long flags;
+
+	if (!nr_reqs)
+		return;
+
+	spin_lock_irqsave(&chan->capture_state_lock, flags);
+	if (chan->capture_state != CAPTURE_ERROR) {
+		chan->capture_reqs_enqueued -= nr_reqs;
+		chan->capture_state = CAPTURE_GOOD;
+	}
+	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+}
+
 static void vi5_capture_dequeue(struct tegra_channel *chan,
 	struct tegra_channel_buffer *buf)
 {
@@ -544,16 +582,10 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 					gang_prev_frame_id, descr->status.frame_id);
 			goto uncorr_err;
 		}
-
-		spin_lock_irqsave(&chan->capture_state_lock, flags);
-		if (chan->capture_state != CAPTURE_ERROR) {
-			chan->capture_reqs_enqueued -= 1;
-			chan->capture_state = CAPTURE_GOOD;
-		}
-		spin_unlock_irqrestore(&chan->capture_state_lock, flags);
 	}
 
-	wake_up_interruptible(&chan->start_wait);
+	vi5_capture_retire(chan, chan->valid_ports);
+
 	/* Read SOF from capture descriptor */
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 4, 0)
 	ts = ns_to_timespec((s64)descr->status.sof_timestamp);
@@ -579,8 +611,11 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 #else
 	trace_tegra_channel_capture_frame("eof", &ts);
 #endif
+	goto rel_buf;
 
 done:
+	/* requests of the ports ahead of the discarded one have completed */
+	vi5_capture_retire(chan, vi_port);
 	goto rel_buf;
 
 uncorr_err:
@@ -671,11 +706,35 @@ done:
 	return err;
 }
 
+static void vi5_kthread_set_sched(struct tegra_channel *chan,
+	struct task_struct *task)
+{
+#if KERNEL_VERSION(5, 9, 0) > LINUX_VERSION_CODE
+	struct sched_param param = { .sched_priority = kthread_rt_prio };
+
+	if (kthread_rt_prio > 0)
+		sched_setscheduler_nocheck(task, SCHED_FIFO, &param);
+#else
+	/* the priority can't be chosen by modules anymore */
+	if (kthread_rt_prio > 0)
+		sched_set_fifo(task);
+#endif
+
+	if (kthread_cpu >= 0) {
+		if (kthread_cpu < nr_cpu_ids && cpu_online(kthread_cpu))
+			set_cpus_allowed_ptr(task, cpumask_of(kthread_cpu));
+		else
+			dev_warn(chan->vi->dev, "invalid kthread_cpu %d\n",
+				kthread_cpu);
+	}
+}
+
 static int tegra_channel_kthread_capture_enqueue(void *data)
 {
 	struct tegra_channel *chan = data;
 	struct tegra_channel_buffer *buf;
 	unsigned long flags;
+	int queued;
 	set_freezable();
 
 	while (1) {
@@ -684,6 +743,8 @@ static int tegra_channel_kthread_capture_enqueue(void *data)
 		wait_event_interruptible(chan->start_wait,
 			(kthread_should_stop() || !list_empty(&chan->capture)));
 
+		/* fill every free request slot, then wake the dequeue side */
+		queued = 0;
 		while (!(kthread_should_stop() || list_empty(&chan->capture))) {
 			spin_lock_irqsave(&chan->capture_state_lock, flags);
 			if ((chan->capture_state == CAPTURE_ERROR)
@@ -703,8 +764,12 @@ static int tegra_channel_kthread_capture_enqueue(void *data)
 			buf->vb2_state = VB2_BUF_STATE_ACTIVE;
 
 			vi5_capture_enqueue(chan, buf);
+			queued++;
 		}
 
+		if (queued)
+			wake_up_interruptible(&chan->dequeue_wait);
+
 		if (kthread_should_stop())
 			break;
 	}
@@ -729,6 +794,12 @@ static int tegra_channel_kthread_capture_dequeue(void *data)
 				|| !list_empty(&chan->dequeue)
 				|| (chan->capture_state == CAPTURE_ERROR)));
 
+		/*
+		 * Retire every frame queued so far before sleeping again.
+		 * Statuses of frames already captured are consumed without
+		 * blocking. The enqueue side is only woken per frame when it
+		 * has buffers waiting for the freed request slot.
+		 */
 		while (!(kthread_should_stop() || list_empty(&chan->dequeue)
 				|| (chan->capture_state == CAPTURE_ERROR))) {
 
@@ -737,6 +808,9 @@ static int tegra_channel_kthread_capture_dequeue(void *data)
 				break;
 
 			vi5_capture_dequeue(chan, buf);
+
+			if (!list_empty(&chan->capture))
+				wake_up_interruptible(&chan->start_wait);
 		}
 
 		spin_lock_irqsave(&chan->capture_state_lock, flags);
@@ -777,6 +851,7 @@ static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 		err = PTR_ERR(chan->kthread_capture_start);
 		goto done;
 	}
+	vi5_kthread_set_sched(chan, chan->kthread_capture_start);
 
 	/* Start the kthread for capture dequeue */
 	if (chan->kthread_capture_dequeue) {
@@ -792,6 +867,7 @@ static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 		err = PTR_ERR(chan->kthread_capture_dequeue);
 		goto done;
 	}
+	vi5_kthread_set_sched(chan, chan->kthread_capture_dequeue);
 
 done:
 	return err;
@@ -175,12 +175,23 @@ struct nvs_iio_channel {
 	int i;
 };
 
+/* contiguous run of enabled channels: copied with a single memcpy */
+struct nvs_iio_copy {
+	unsigned int dst;
+	unsigned int src;
+	unsigned int n;
+};
+
 struct nvs_state {
 	void *client;
 	struct device *dev;
 	struct nvs_fn_dev *fn_dev;
 	struct sensor_cfg *cfg;
 	struct nvs_iio_channel *ch;
+	struct nvs_iio_copy *copy;
+	unsigned int copy_n;
+	unsigned int src_n;
+	bool copy_direct;
 	struct iio_trigger *trig;
 	struct iio_chan_spec *chs;
 	struct attribute *attrs[ARRAY_SIZE(nvs_attrs)];
@@ -620,11 +631,88 @@ static int nvs_buf_i(struct iio_dev *indio_dev, unsigned int ch)
 	return buf_i;
 }
 
+/* Precompute the copy runs from the packed sensor data to the scan buffer.
+ * Adjacent enabled channels whose source and scan offsets are both
+ * contiguous are merged into one run.
+ */
+static void nvs_buf_layout(struct iio_dev *indio_dev)
+{
+	struct nvs_state *st = iio_priv(indio_dev);
+	struct nvs_iio_copy *cp = NULL;
+	unsigned int src_i = 0;
+	unsigned int i;
+
+	st->copy_n = 0;
+	for (i = 0; i + 1 < indio_dev->num_channels; i++) {
+		if (st->ch[i].i < 0)
+			continue;
+
+		if (cp && (cp->src + cp->n == src_i) &&
+					   (cp->dst + cp->n == st->ch[i].i)) {
+			cp->n += st->ch[i].n;
+		} else {
+			cp = &st->copy[st->copy_n++];
+			cp->dst = st->ch[i].i;
+			cp->src = src_i;
+			cp->n = st->ch[i].n;
+		}
+		src_i += st->ch[i].n;
+	}
+	st->src_n = src_i;
+	/* sample data is already laid out as the scan buffer expects */
+	st->copy_direct = (st->copy_n == 1 && !st->copy[0].dst &&
+			   !st->copy[0].src);
+}
+
+/* slow path: per channel copy that honors the debug data lock */
+static bool nvs_buf_copy_dbg(struct nvs_state *st, unsigned int data_chan_n,
+			     unsigned char *data)
+{
+	bool changed = false;
+	unsigned int src_i = 0;
+	unsigned int i;
+
+	for (i = 0; i < data_chan_n; i++) {
+		if (st->ch[i].i < 0)
+			continue;
+
+		if (st->on_change && memcmp(&st->buf[st->ch[i].i],
+					    &data[src_i], st->ch[i].n))
+			changed = true;
+		if (!(st->dbg_data_lock & (1 << i)))
+			memcpy(&st->buf[st->ch[i].i],
+			       &data[src_i], st->ch[i].n);
+		src_i += st->ch[i].n;
+	}
+	return changed;
+}
+
+static bool nvs_buf_copy(struct nvs_state *st, unsigned char *data)
+{
+	struct nvs_iio_copy *cp;
+	bool changed = false;
+	unsigned int i;
+
+	for (i = 0; i < st->copy_n; i++) {
+		cp = &st->copy[i];
+		/* wasted cycles when st->first_push
+		 * but saved cycles in the long run.
+		 */
+		if (st->on_change && !changed &&
+		    memcmp(&st->buf[cp->dst], &data[cp->src], cp->n))
+			/* data changed */
+			changed = true;
+		memcpy(&st->buf[cp->dst], &data[cp->src], cp->n);
+	}
+	return changed;
+}
+
 static int nvs_buf_push(struct iio_dev *indio_dev, unsigned char *data, s64 ts)
 {
 	struct nvs_state *st = iio_priv(indio_dev);
 	bool push = true;
 	bool buf_data = false;
+	bool changed;
 	char char_buf[128];
 	unsigned int n;
 	unsigned int i;
@@ -640,31 +728,17 @@ static int nvs_buf_push(struct iio_dev *indio_dev, unsigned char *data, s64 ts)
 		if (st->on_change)
 			/* on-change needs data change for push */
 			push = false;
-		for (i = 0; i < data_chan_n; i++) {
-			if (st->ch[i].i >= 0) {
-				if (!data) {
-					/* buffer calculations only */
-					src_i += st->ch[i].n;
-					continue;
-				}
-
-				buf_data = true;
-				if (st->on_change) {
-					/* wasted cycles when st->first_push
-					 * but saved cycles in the long run.
-					 */
-					ret = memcmp(&st->buf[st->ch[i].i],
-						     &data[src_i],
-						     st->ch[i].n);
-					if (ret)
-						/* data changed */
-						push = true;
-				}
-				if (!(st->dbg_data_lock & (1 << i)))
-					memcpy(&st->buf[st->ch[i].i],
-					       &data[src_i], st->ch[i].n);
-				src_i += st->ch[i].n;
-			}
+		/* without data: buffer calculations only */
+		src_i = st->src_n;
+		if (data && st->copy_n) {
+			buf_data = true;
+			if (st->dbg_data_lock)
+				changed = nvs_buf_copy_dbg(st, data_chan_n,
+							   data);
+			else
+				changed = nvs_buf_copy(st, data);
+			if (changed)
+				push = true;
 		}
 	}
 
@@ -735,6 +809,87 @@ static int nvs_handler(void *handle, void *buffer, s64 ts)
 	return ret;
 }
 
+/* Push a block of n samples drained from a FIFO. Sample i starts at
+ * buffer + i * stride and is timestamped ts + i * ts_step. Anything that
+ * needs per sample decisions (on-change, one-shot, debug) goes through
+ * nvs_buf_push(); otherwise the scan layout precomputed at enable is
+ * applied directly, and when the sample data already matches the scan
+ * buffer it is handed to the IIO core without an intermediate copy.
+ */
+static int nvs_handler_batch(void *handle, void *buffer, unsigned int stride,
+			     s64 ts, s64 ts_step, unsigned int n)
+{
+	struct iio_dev *indio_dev = (struct iio_dev *)handle;
+	struct nvs_state *st;
+	unsigned char *data = buffer;
+	unsigned int data_chan_n;
+	unsigned int ts_i;
+	unsigned int i;
+	bool direct;
+	int ret = 0;
+
+	if (!indio_dev || !n)
+		return 0;
+
+	st = iio_priv(indio_dev);
+	if (!stride)
+		stride = st->src_n;
+	data_chan_n = indio_dev->num_channels - 1;
+	if (!data || !ts || !data_chan_n || !st->copy_n || st->first_push ||
+	    st->on_change || st->one_shot || st->dbg_data_lock ||
+	    !iio_buffer_enabled(indio_dev) ||
+	    (*st->fn_dev->sts & (NVS_STS_SPEW_MSG | NVS_STS_SPEW_DATA |
+				 NVS_STS_SPEW_BUF))) {
+		for (i = 0; i < n; i++) {
+			ret = nvs_buf_push(indio_dev, data, ts);
+			if (ret < 0)
+				return ret;
+
+			data += stride;
+			ts += ts_step;
+		}
+		return n * stride;
+	}
+
+	if (ts < st->ts || ts_step < 0)
+		dev_err(st->dev, "%s %s ts_diff=%lld\n",
+			__func__, st->cfg->name, ts - st->ts);
+
+	direct = st->copy_direct && !indio_dev->buffer->scan_timestamp &&
+		 indio_dev->scan_bytes <= stride;
+	ts_i = st->ch[data_chan_n].i;
+	for (i = 0; i < n; i++) {
+		if (direct) {
+			ret = iio_push_to_buffers(indio_dev, data);
+		} else {
+			nvs_buf_copy(st, data);
+			if (indio_dev->buffer->scan_timestamp)
+				memcpy(&st->buf[ts_i], &ts,
+				       st->ch[data_chan_n].n);
+			ret = iio_push_to_buffers(indio_dev, st->buf);
+		}
+		if (ret)
+			break;
+
+		data += stride;
+		ts += ts_step;
+	}
+
+	if (!i)
+		return ret;
+
+	/* the scan buffer holds the last sample for raw reads */
+	if (direct)
+		nvs_buf_copy(st, data - stride);
+	ts -= ts_step;
+	st->ts_diff = i > 1 ? ts_step : ts - st->ts;
+	st->ts = ts; /* log ts push */
+	if (ret)
+		return ret;
+
+	return n * stride;
+}
+
 static int nvs_enable(struct iio_dev *indio_dev, bool en)
 {
 	struct nvs_state *st = iio_priv(indio_dev);
@@ -762,6 +917,7 @@ static int nvs_enable(struct iio_dev *indio_dev, bool en)
 			enable = 1;
 		}
 		st->ch[i].i = nvs_buf_index(st->ch[i].n, &n);
+		nvs_buf_layout(indio_dev);
 		st->first_push = true;
 		ret = st->fn_dev->enable(st->client, st->cfg->snsr_id, enable);
 		if (!ret)
@@ -1627,6 +1783,11 @@ static int nvs_ch_init(struct nvs_state *st, struct iio_dev *indio_dev)
 		st->ch[i].i = -1;
 	}
 
+	n = indio_dev->num_channels * sizeof(struct nvs_iio_copy);
+	st->copy = devm_kzalloc(st->dev, n, GFP_KERNEL);
+	if (st->copy == NULL)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -1994,6 +2155,8 @@ static int nvs_probe(void **handle, void *dev_client, struct device *dev,
 			devm_kfree(st->dev, st->chs);
 		if (st->ch)
 			devm_kfree(st->dev, st->ch);
+		if (st->copy)
+			devm_kfree(st->dev, st->copy);
 		if (st->buf)
 			devm_kfree(st->dev, st->buf);
 		nvs_remove(indio_dev);
@@ -2017,6 +2180,7 @@ static struct nvs_fn_if nvs_fn_if_iio = {
 	.suspend			= nvs_suspend,
 	.resume				= nvs_resume,
 	.handler			= nvs_handler,
+	.handler_batch			= nvs_handler_batch,
 };
 
 struct nvs_fn_if *nvs_iio(void)
@@ -24,6 +24,8 @@
 #include <linux/cdev.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/jhash.h>
 #include <linux/file.h>
 #include <linux/mod_devicetable.h>
 #include <linux/mutex.h>
@@ -63,6 +65,11 @@ DEFINE_MUTEX(nvsciipc_mutex);
 
 static struct platform_device *nvsciipc_pdev;
 static struct nvsciipc *ctx;
+/*
+ * Kept outside of ctx so that lockless lookups never dereference ctx, which
+ * goes away with the device. Written under nvsciipc_mutex.
+ */
+static struct nvsciipc_db_index __rcu *nvsciipc_index;
 
 NvSciError NvSciIpcEndpointGetAuthToken(NvSciIpcEndpoint handle,
 		NvSciIpcEndpointAuthToken *authToken)
@@ -84,8 +91,11 @@ NvSciError NvSciIpcEndpointValidateAuthTokenLinuxCurrent(
 {
 	struct fd f;
 	struct file *filp;
-	int i, ret;
-	char node[NVSCIIPC_MAX_EP_NAME+11];
+	struct nvsciipc_db_index *index;
+	struct nvsciipc_db_node *ep;
+	const struct qstr *name;
+	u32 hash;
+	NvSciError err = NvSciError_BadParameter;
 
 	f = fdget((int)authToken);
 	if (!f.file) {
@@ -94,68 +104,69 @@ NvSciError NvSciIpcEndpointValidateAuthTokenLinuxCurrent(
 	}
 	filp = f.file;
 
-	mutex_lock(&nvsciipc_mutex);
-	if (ctx == NULL) {
-		mutex_unlock(&nvsciipc_mutex);
+	if (READ_ONCE(ctx) == NULL) {
 		fdput(f);
 		ERR("not initialized\n");
 		return NvSciError_NotInitialized;
 	}
 
-	for (i = 0; i < ctx->num_eps; i++) {
-		ret = snprintf(node, sizeof(node), "%s%d",
-			ctx->db[i]->dev_name, ctx->db[i]->id);
-
-		if ((ret < 0) || (ret >= sizeof(node)))
-			continue;
+	name = &filp->f_path.dentry->d_name;
+	hash = jhash(name->name, name->len, 0);
 
-		if (!strncmp(filp->f_path.dentry->d_name.name, node,
-			sizeof(node))) {
-			*localUserVuid = ctx->db[i]->vuid;
-			break;
+	rcu_read_lock();
+	index = rcu_dereference(nvsciipc_index);
+	if (index != NULL) {
+		hash_for_each_possible_rcu(index->by_node, ep, node_link,
+					   hash) {
+			if (ep->node_hash == hash &&
+			    !strncmp(name->name, ep->node, sizeof(ep->node))) {
+				*localUserVuid = ep->vuid;
+				err = NvSciError_Success;
+				break;
+			}
 		}
 	}
-
-	if (i == ctx->num_eps) {
-		mutex_unlock(&nvsciipc_mutex);
-		fdput(f);
-		ERR("wrong auth token passed\n");
-		return NvSciError_BadParameter;
-	}
-	mutex_unlock(&nvsciipc_mutex);
+	rcu_read_unlock();
 
 	fdput(f);
 
-	return NvSciError_Success;
+	if (err != NvSciError_Success)
+		ERR("wrong auth token passed\n");
+
+	return err;
 }
 EXPORT_SYMBOL(NvSciIpcEndpointValidateAuthTokenLinuxCurrent);
 
 NvSciError NvSciIpcEndpointMapVuid(NvSciIpcEndpointVuid localUserVuid,
 		NvSciIpcTopoId *peerTopoId, NvSciIpcEndpointVuid *peerUserVuid)
 {
-	int i;
+	struct nvsciipc_db_index *index;
+	struct nvsciipc_db_node *ep;
+	bool found = false;
 
-	mutex_lock(&nvsciipc_mutex);
-	if (ctx == NULL) {
-		mutex_unlock(&nvsciipc_mutex);
+	if (READ_ONCE(ctx) == NULL) {
 		ERR("not initialized\n");
 		return NvSciError_NotInitialized;
 	}
 
-
-	for (i = 0; i < ctx->num_eps; i++) {
-		if (ctx->db[i]->vuid == localUserVuid)
-			break;
+	rcu_read_lock();
+	index = rcu_dereference(nvsciipc_index);
+	if (index != NULL) {
+		hash_for_each_possible_rcu(index->by_vuid, ep, vuid_link,
+					   localUserVuid) {
+			if (ep->vuid == localUserVuid) {
+				found = true;
+				break;
+			}
+		}
 	}
+	rcu_read_unlock();
 
-	if (i == ctx->num_eps) {
-		mutex_unlock(&nvsciipc_mutex);
+	if (!found) {
 		ERR("wrong localUserVuid passed\n");
 		return NvSciError_BadParameter;
 	}
 
-	mutex_unlock(&nvsciipc_mutex);
-
 	*peerUserVuid = (localUserVuid ^ 1);
 	peerTopoId->VmId = ((localUserVuid >> NVSCIIPC_VUID_VMID_SHIFT)
 			   & NVSCIIPC_VUID_VMID_MASK);
@@ -166,6 +177,61 @@ NvSciError NvSciIpcEndpointMapVuid(NvSciIpcEndpointVuid localUserVuid,
 }
 EXPORT_SYMBOL(NvSciIpcEndpointMapVuid);
 
+/*
+ * Index the endpoint database by device node name and by VUID. Entries are
+ * added last to first so that a lookup still finds the first matching
+ * endpoint of the database, as the linear scan did.
+ */
+static int nvsciipc_build_index(struct nvsciipc *ctx)
+{
+	struct nvsciipc_db_index *index;
+	struct nvsciipc_db_node *ep;
+	int i, ret;
+
+	index = vzalloc(sizeof(*index) +
+			ctx->num_eps * sizeof(struct nvsciipc_db_node));
+	if (index == NULL) {
+		ERR("memory allocation for db index failed\n");
+		return -ENOMEM;
+	}
+
+	hash_init(index->by_node);
+	hash_init(index->by_vuid);
+	index->num_eps = ctx->num_eps;
+
+	for (i = ctx->num_eps - 1; i >= 0; i--) {
+		ep = &index->eps[i];
+		ep->vuid = ctx->db[i]->vuid;
+		hash_add(index->by_vuid, &ep->vuid_link, ep->vuid);
+
+		ret = snprintf(ep->node, sizeof(ep->node), "%s%d",
+			ctx->db[i]->dev_name, ctx->db[i]->id);
+		if ((ret < 0) || (ret >= sizeof(ep->node)))
+			continue;
+
+		ep->node_hash = jhash(ep->node, ret, 0);
+		hash_add(index->by_node, &ep->node_link, ep->node_hash);
+	}
+
+	rcu_assign_pointer(nvsciipc_index, index);
+
+	return 0;
+}
+
+static void nvsciipc_free_index(void)
+{
+	struct nvsciipc_db_index *index;
+
+	index = rcu_dereference_protected(nvsciipc_index,
+			lockdep_is_held(&nvsciipc_mutex));
+	if (index == NULL)
+		return;
+
+	RCU_INIT_POINTER(nvsciipc_index, NULL);
+	synchronize_rcu();
+	vfree(index);
+}
+
 static int nvsciipc_dev_open(struct inode *inode, struct file *filp)
 {
 	struct nvsciipc *ctx = container_of(inode->i_cdev,
@@ -180,6 +246,8 @@ static void nvsciipc_free_db(struct nvsciipc *ctx)
 {
 	int i;
 
+	nvsciipc_free_index();
+
 	if (ctx->num_eps != 0) {
 		for (i = 0; i < ctx->num_eps; i++)
 			kfree(ctx->db[i]);
@@ -366,6 +434,10 @@ static int nvsciipc_ioctl_set_db(struct nvsciipc *ctx, unsigned int cmd,
 				    << NVSCIIPC_VUID_VMID_SHIFT);
 	}
 
+	ret = nvsciipc_build_index(ctx);
+	if (ret != 0)
+		goto ptr_error;
+
 	kfree(entry_ptr);
 	return ret;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2021, NVIDIA CORPORATION. All rights reserved.
+ * Copyright (c) 2019-2022, NVIDIA CORPORATION. All rights reserved.
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms and conditions of the GNU General Public License,
@@ -14,6 +14,8 @@
 #ifndef __NVSCIIPC_KERNEL_H__
 #define __NVSCIIPC_KERNEL_H__
 
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
 #include <linux/nvscierror.h>
 #include <linux/nvsciipc_interface.h>
 #include <uapi/linux/nvsciipc_ioctl.h>
@@ -25,6 +27,30 @@
 #define MODULE_NAME             "nvsciipc"
 #define MAX_NAME_SIZE           64
 
+#define NVSCIIPC_DB_HASH_BITS   10
+#define NVSCIIPC_NODE_NAME_SIZE (NVSCIIPC_MAX_EP_NAME + 11)
+
+/* endpoint as seen by the lookups, "<dev_name><id>" is its device node */
+struct nvsciipc_db_node {
+	struct hlist_node node_link;
+	struct hlist_node vuid_link;
+	u32 node_hash;
+	uint64_t vuid;
+	char node[NVSCIIPC_NODE_NAME_SIZE];
+};
+
+/*
+ * Read-only lookup index over the endpoint database. Built once the
+ * database is set and published with RCU, so lookups do not take
+ * nvsciipc_mutex.
+ */
+struct nvsciipc_db_index {
+	DECLARE_HASHTABLE(by_node, NVSCIIPC_DB_HASH_BITS);
+	DECLARE_HASHTABLE(by_vuid, NVSCIIPC_DB_HASH_BITS);
+	int num_eps;
+	struct nvsciipc_db_node eps[];
+};
+
 struct nvsciipc {
 	struct device *dev;
 
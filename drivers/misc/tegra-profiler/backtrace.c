@@ -549,6 +549,7 @@ get_user_callchain_mixed(struct quadd_event_context *event_ctx,
 {
 	int nr_prev, nr_added, is_stack_ok;
 	unsigned long pc, prev_sp, align_mask;
+	u64 t;
 	struct quadd_unw_methods *um = &cc->um;
 
 	if (!event_ctx->user_mode) {
@@ -565,13 +566,22 @@ get_user_callchain_mixed(struct quadd_event_context *event_ctx,
 		nr_prev = cc->nr;
 		prev_sp = cc->curr_sp;
 
-		if (um->dwarf)
+		if (um->dwarf) {
+			t = quadd_get_time();
 			quadd_get_user_cc_dwarf(event_ctx, cc);
-		if (um->ut)
+			cc->time_dwarf += quadd_get_time() - t;
+		}
+		if (um->ut) {
+			t = quadd_get_time();
 			quadd_get_user_cc_arm32_ehabi(event_ctx, cc);
+			cc->time_ut += quadd_get_time() - t;
+		}
 
-		if (um->fp && nr_prev == cc->nr)
+		if (um->fp && nr_prev == cc->nr) {
+			t = quadd_get_time();
 			__get_user_callchain_fp(event_ctx, cc);
+			cc->time_fp += quadd_get_time() - t;
+		}
 
 		is_stack_ok = cc->nr <= 1 ?
 			cc->curr_sp >= prev_sp : cc->curr_sp > prev_sp;
@@ -596,6 +606,10 @@ quadd_get_user_callchain(struct quadd_event_context *event_ctx,
 	cc->curr_pc = 0;
 	cc->curr_lr = 0;
 
+	cc->time_fp = 0;
+	cc->time_ut = 0;
+	cc->time_dwarf = 0;
+
 	if (!regs) {
 		cc->urc_fp = QUADD_URC_FAILURE;
 		cc->urc_ut = QUADD_URC_FAILURE;
@@ -63,6 +63,11 @@ struct quadd_callchain {
 	unsigned long curr_pc;
 	unsigned long curr_lr;
 
+	/* time spent in each unwinder for the current sample, ns */
+	u64 time_fp;
+	u64 time_ut;
+	u64 time_dwarf;
+
 	struct quadd_hrt_ctx *hrt;
 };
 
@@ -27,6 +27,9 @@
 #include <linux/circ_buf.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/irq_work.h>
 
 #include <linux/tegra_profiler.h>
 
@@ -34,6 +37,13 @@
 #include "quadd.h"
 #include "version.h"
 
+/*
+ * Readers sleeping in poll() are woken up once a ring buffer is filled up to
+ * this percentage, so that they consume the samples in batches instead of
+ * being woken up for every sample.
+ */
+#define QUADD_RB_WAKEUP_WATERMARK	50
+
 struct quadd_ring_buffer {
 	struct quadd_ring_buffer_hdr *rb_hdr;
 	char *buf;
@@ -41,6 +51,9 @@ struct quadd_ring_buffer {
 	size_t max_fill_count;
 	size_t nr_skipped_samples;
 
+	size_t wakeup_mark;
+	struct irq_work wakeup_work;
+
 	struct quadd_mmap_area *mmap;
 
 	raw_spinlock_t lock;
@@ -58,6 +71,8 @@ struct quadd_comm_ctx {
 	int params_ok;
 
 	struct miscdevice *misc_dev;
+
+	wait_queue_head_t read_wait;
 };
 
 struct comm_cpu_context {
@@ -94,10 +109,14 @@ rb_write(struct quadd_ring_buffer_hdr *rb_hdr,
 	rb_hdr->pos_write = head;
 }
 
+/* Returns the length of the record, or a negative error code. *wakeup is set
+ * if the ring buffer has just reached the reader wakeup watermark.
+ */
 static ssize_t
 write_sample(struct quadd_ring_buffer *rb,
 	     struct quadd_record_data *sample,
-	     const struct quadd_iovec *vec, int vec_count)
+	     const struct quadd_iovec *vec, int vec_count,
+	     bool *wakeup)
 {
 	int i;
 	size_t len = 0, c;
@@ -137,6 +156,8 @@ write_sample(struct quadd_ring_buffer *rb,
 		rb_hdr->max_fill_count = c;
 	}
 
+	*wakeup = c >= rb->wakeup_mark && c - len < rb->wakeup_mark;
+
 	/* Use smp_store_release() to update circle buffer write pointers to
 	 * ensure the data is stored before we update write pointer.
 	 */
@@ -181,6 +202,7 @@ put_sample(struct quadd_record_data *data,
 {
 	ssize_t err = 0;
 	unsigned long flags;
+	bool wakeup = false;
 	struct comm_cpu_context *cc;
 	struct quadd_ring_buffer *rb;
 	struct quadd_ring_buffer_hdr *rb_hdr;
@@ -195,7 +217,7 @@ put_sample(struct quadd_record_data *data,
 
 	raw_spin_lock_irqsave(&rb->lock, flags);
 
-	err = write_sample(rb, data, vec, vec_count);
+	err = write_sample(rb, data, vec, vec_count, &wakeup);
 	if (err < 0) {
 		rb->nr_skipped_samples++;
 
@@ -206,9 +228,52 @@ put_sample(struct quadd_record_data *data,
 
 	raw_spin_unlock_irqrestore(&rb->lock, flags);
 
+	/* we may be in the hrtimer handler, defer the wakeup */
+	if (wakeup)
+		irq_work_queue(&rb->wakeup_work);
+
 	return err;
 }
 
+static void rb_wakeup_work(struct irq_work *work)
+{
+	wake_up_interruptible(&comm_ctx.read_wait);
+}
+
+static bool rb_is_readable(void)
+{
+	int cpu_id;
+	bool ready = false;
+	unsigned long flags;
+	size_t cnt;
+	struct quadd_ring_buffer *rb;
+	struct quadd_ring_buffer_hdr *rb_hdr;
+	int active = atomic_read(&comm_ctx.active);
+
+	for_each_possible_cpu(cpu_id) {
+		rb = &per_cpu(cpu_ctx, cpu_id).rb;
+
+		raw_spin_lock_irqsave(&rb->lock, flags);
+
+		rb_hdr = rb->rb_hdr;
+		if (rb_hdr) {
+			cnt = CIRC_CNT(rb_hdr->pos_write,
+				       READ_ONCE(rb_hdr->pos_read),
+				       rb_hdr->size);
+			/* drain everything once profiling is stopped */
+			if (cnt > 0 && (!active || cnt >= rb->wakeup_mark))
+				ready = true;
+		}
+
+		raw_spin_unlock_irqrestore(&rb->lock, flags);
+
+		if (ready)
+			break;
+	}
+
+	return ready;
+}
+
 static void comm_reset(void)
 {
 	pr_debug("Comm reset\n");
@@ -339,6 +404,9 @@ init_mmap_hdr(struct quadd_mmap_rb_info *mmap_rb,
 	rb_hdr->pos_read = 0;
 	rb_hdr->pos_write = 0;
 
+	rb->wakeup_mark = max_t(size_t, 1,
+				size / 100 * QUADD_RB_WAKEUP_WATERMARK);
+
 	rb_hdr->max_fill_count = 0;
 	rb_hdr->skipped_samples = 0;
 
@@ -375,6 +443,8 @@ static void rb_stop(void)
 
 		rb_hdr->state = QUADD_RB_STATE_STOPPED;
 	}
+
+	wake_up_interruptible(&comm_ctx.read_wait);
 }
 
 static void rb_reset(struct quadd_ring_buffer *rb)
@@ -773,6 +843,17 @@ error_out:
 	return err;
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 16, 0)
+static __poll_t device_poll(struct file *file, poll_table *wait)
+#else
+static unsigned int device_poll(struct file *file, poll_table *wait)
+#endif
+{
+	poll_wait(file, &comm_ctx.read_wait, wait);
+
+	return rb_is_readable() ? POLLIN | POLLRDNORM : 0;
+}
+
 static void
 remove_mmap_entry(struct quadd_mmap_area *mmap)
 {
@@ -936,6 +1017,7 @@ static const struct file_operations qm_fops = {
 	.unlocked_ioctl	= device_ioctl,
 	.compat_ioctl	= device_ioctl,
 	.mmap		= device_mmap,
+	.poll		= device_poll,
 };
 
 static int comm_init(void)
@@ -961,6 +1043,7 @@ static int comm_init(void)
 
 	mutex_init(&comm_ctx.io_mutex);
 	atomic_set(&comm_ctx.active, 0);
+	init_waitqueue_head(&comm_ctx.read_wait);
 
 	comm_ctx.nr_users = 0;
 
@@ -978,6 +1061,7 @@ static int comm_init(void)
 		rb->max_fill_count = 0;
 		rb->nr_skipped_samples = 0;
 
+		init_irq_work(&rb->wakeup_work, rb_wakeup_work);
 		raw_spin_lock_init(&rb->lock);
 	}
 
@@ -1004,7 +1088,12 @@ quadd_comm_init(struct quadd_ctx *ctx,
 
 void quadd_comm_exit(void)
 {
+	int cpu_id;
+
 	mutex_lock(&comm_ctx.io_mutex);
 	unregister();
 	mutex_unlock(&comm_ctx.io_mutex);
+
+	for_each_possible_cpu(cpu_id)
+		irq_work_sync(&per_cpu(cpu_ctx, cpu_id).rb.wakeup_work);
 }
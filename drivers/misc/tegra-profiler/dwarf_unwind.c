@@ -21,6 +21,7 @@
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/err.h>
+#include <linux/hash.h>
 
 #include <asm/unaligned.h>
 
@@ -132,8 +133,49 @@ struct dwarf_cpu_context {
 	int dw_ptr_size;
 };
 
+/*
+ * Evaluated unwind rows, so that frames at the same pc of the same process
+ * are unwound without decoding the CIE/FDE and executing the CFA program
+ * again. Only the rules unwind_frame() is able to apply are cached.
+ */
+#define DW_RULE_CACHE_BITS	6
+#define DW_RULE_CACHE_SIZE	(1 << DW_RULE_CACHE_BITS)
+
+struct dw_cached_rule {
+	s32 offset;
+	u8 regnum;
+};
+
+struct dw_rule_cache_entry {
+	unsigned long pc;
+	unsigned long vm_start;
+	pid_t pid;
+	u32 gen;
+
+	u8 is_eh;
+	u8 mode;
+	u8 nr_rules;
+
+	int cfa_register;
+	long cfa_offset;
+
+	struct dw_cached_rule rules[QUADD_NUM_REGS];
+};
+
+struct dw_rule_cache {
+	struct dw_rule_cache_entry entries[DW_RULE_CACHE_SIZE];
+
+	u64 nr_hits;
+	u64 nr_misses;
+};
+
 struct quadd_dwarf_context {
 	struct dwarf_cpu_context __percpu *cpu_ctx;
+	struct dw_rule_cache __percpu *rule_cache;
+
+	/* bumped whenever the unwind tables of any process change */
+	atomic_t cache_gen;
+
 	atomic_t started;
 };
 
@@ -1817,40 +1859,123 @@ dwarf_decode(struct ex_region_info *ri,
 	return 0;
 }
 
-static long def_cfa(struct stackframe *sf, struct regs_state *rs)
+static inline struct dw_rule_cache_entry *
+rule_cache_slot(struct dw_rule_cache *rc, pid_t pid, unsigned long pc)
 {
-	int reg = rs->cfa_register;
-
-	if (reg >= 0) {
-		if (reg >= QUADD_NUM_REGS)
-			return -QUADD_URC_TBL_IS_CORRUPT;
+	return &rc->entries[hash_long(pc ^ pid, DW_RULE_CACHE_BITS)];
+}
 
-		pr_debug("r%d --> cfa (%#lx)\n", reg, sf->cfa);
-		sf->cfa = sf->vregs[reg];
+static int
+rule_cache_lookup(struct ex_region_info *ri,
+		  struct stackframe *sf,
+		  unsigned long pc,
+		  int is_eh,
+		  struct task_struct *task)
+{
+	int i;
+	struct regs_state *rs = &sf->rs;
+	struct dw_rule_cache_entry *e;
+	struct dw_rule_cache *rc = this_cpu_ptr(ctx.rule_cache);
+	pid_t pid = task_tgid_nr(task);
+
+	e = rule_cache_slot(rc, pid, pc);
+
+	if (e->gen != (u32)atomic_read(&ctx.cache_gen) ||
+	    e->pc != pc || e->pid != pid ||
+	    e->vm_start != ri->vm_start ||
+	    e->is_eh != is_eh || e->mode != sf->mode) {
+		rc->nr_misses++;
+		return 0;
 	}
 
-	sf->cfa += rs->cfa_offset;
-	pr_debug("cfa += %#lx (%#lx)\n", rs->cfa_offset, sf->cfa);
+	rules_cleanup(rs, sf->mode);
 
-	return 0;
+	for (i = 0; i < e->nr_rules; i++)
+		set_rule_offset(rs, e->rules[i].regnum, DW_WHERE_CFAREL,
+				e->rules[i].offset);
+
+	rs->cfa_register = e->cfa_register;
+	rs->cfa_offset = e->cfa_offset;
+	rs->cfa_how = DW_CFA_REG_OFFSET;
+
+	sf->pc = pc;
+	rc->nr_hits++;
+
+	return 1;
+}
+
+static void
+rule_cache_store(struct ex_region_info *ri,
+		 struct stackframe *sf,
+		 unsigned long pc,
+		 int is_eh,
+		 struct task_struct *task,
+		 u32 gen)
+{
+	int i, num_regs, nr_rules = 0;
+	struct regs_state *rs = &sf->rs;
+	struct dw_rule_cache_entry *e;
+	struct dw_rule_cache *rc = this_cpu_ptr(ctx.rule_cache);
+	pid_t pid = task_tgid_nr(task);
+
+	if (rs->cfa_how == DW_CFA_EXP)
+		return;
+
+	e = rule_cache_slot(rc, pid, pc);
+
+	/* generation 0 is never current, the slot stays invalid on bail out */
+	e->gen = 0;
+
+	num_regs = (sf->mode == DW_MODE_ARM32) ?
+		QUADD_AARCH32_REGISTERS :
+		QUADD_AARCH64_REGISTERS;
+
+	for (i = 0; i < num_regs; i++) {
+		struct reg_info *r = &rs->reg[i];
+
+		switch (r->where) {
+		case DW_WHERE_UNDEF:
+		case DW_WHERE_SAME:
+			break;
+
+		case DW_WHERE_CFAREL:
+			if (r->loc.offset != (s32)r->loc.offset)
+				return;
+
+			e->rules[nr_rules].regnum = i;
+			e->rules[nr_rules].offset = r->loc.offset;
+			nr_rules++;
+			break;
+
+		default:
+			/* let unwind_frame() report the unsupported rule */
+			return;
+		}
+	}
+
+	e->pc = pc;
+	e->vm_start = ri->vm_start;
+	e->pid = pid;
+	e->is_eh = is_eh;
+	e->mode = sf->mode;
+	e->nr_rules = nr_rules;
+	e->cfa_register = rs->cfa_register;
+	e->cfa_offset = rs->cfa_offset;
+	e->gen = gen;
 }
 
 static long
-unwind_frame(struct ex_region_info *ri,
-	     struct stackframe *sf,
-	     struct vm_area_struct *vma_sp,
-	     int is_eh,
-	     struct task_struct *task)
+eval_unwind_rules(struct ex_region_info *ri,
+		  struct stackframe *sf,
+		  int is_eh,
+		  struct task_struct *task)
 {
-	int i, num_regs;
 	long err;
 	unsigned char *insn_end;
-	unsigned long addr, return_addr, val, user_reg_size;
 	struct dw_fde fde;
 	struct dw_cie cie;
 	unsigned long pc = sf->pc;
 	struct regs_state *rs, *rs_initial;
-	int mode = sf->mode;
 
 	err = dwarf_decode(ri, sf, &cie, &fde, pc, is_eh, task);
 	if (err < 0)
@@ -1864,7 +1989,7 @@ unwind_frame(struct ex_region_info *ri,
 	rs->cfa_register = -1;
 	rs_initial->cfa_register = -1;
 
-	rules_cleanup(rs, mode);
+	rules_cleanup(rs, sf->mode);
 
 	if (cie.initial_insn) {
 		insn_end = cie.initial_insn + cie.initial_insn_len;
@@ -1884,6 +2009,56 @@ unwind_frame(struct ex_region_info *ri,
 			return err;
 	}
 
+	return 0;
+}
+
+static long def_cfa(struct stackframe *sf, struct regs_state *rs)
+{
+	int reg = rs->cfa_register;
+
+	if (reg >= 0) {
+		if (reg >= QUADD_NUM_REGS)
+			return -QUADD_URC_TBL_IS_CORRUPT;
+
+		pr_debug("r%d --> cfa (%#lx)\n", reg, sf->cfa);
+		sf->cfa = sf->vregs[reg];
+	}
+
+	sf->cfa += rs->cfa_offset;
+	pr_debug("cfa += %#lx (%#lx)\n", rs->cfa_offset, sf->cfa);
+
+	return 0;
+}
+
+static long
+unwind_frame(struct ex_region_info *ri,
+	     struct stackframe *sf,
+	     struct vm_area_struct *vma_sp,
+	     int is_eh,
+	     struct task_struct *task)
+{
+	int i, num_regs;
+	long err;
+	unsigned long addr, return_addr, val, user_reg_size;
+	unsigned long pc = sf->pc;
+	struct regs_state *rs = &sf->rs;
+	int mode = sf->mode;
+	u32 gen;
+
+	if (!rule_cache_lookup(ri, sf, pc, is_eh, task)) {
+		/*
+		 * Sample the generation before evaluating, so the rows are
+		 * not tagged current if the mappings change meanwhile.
+		 */
+		gen = atomic_read(&ctx.cache_gen);
+
+		err = eval_unwind_rules(ri, sf, is_eh, task);
+		if (err < 0)
+			return err;
+
+		rule_cache_store(ri, sf, pc, is_eh, task, gen);
+	}
+
 	pr_debug("mode: %s\n", (mode == DW_MODE_ARM32) ? "arm32" : "arm64");
 	pr_debug("initial cfa: %#lx\n", sf->cfa);
 
@@ -2235,6 +2410,13 @@ quadd_get_user_cc_dwarf(struct quadd_event_context *event_ctx,
 	return cc->nr;
 }
 
+void quadd_dwarf_unwind_invalidate(void)
+{
+	/* zero never matches, the cache entries start zeroed */
+	if (atomic_inc_return(&ctx.cache_gen) == 0)
+		atomic_inc(&ctx.cache_gen);
+}
+
 int quadd_dwarf_unwind_start(void)
 {
 	if (!atomic_cmpxchg(&ctx.started, 0, 1)) {
@@ -2243,6 +2425,13 @@ int quadd_dwarf_unwind_start(void)
 			atomic_set(&ctx.started, 0);
 			return -ENOMEM;
 		}
+
+		ctx.rule_cache = alloc_percpu(struct dw_rule_cache);
+		if (!ctx.rule_cache) {
+			free_percpu(ctx.cpu_ctx);
+			atomic_set(&ctx.started, 0);
+			return -ENOMEM;
+		}
 	}
 
 	return 0;
@@ -2250,12 +2439,29 @@ int quadd_dwarf_unwind_start(void)
 
 void quadd_dwarf_unwind_stop(void)
 {
-	if (atomic_cmpxchg(&ctx.started, 1, 0))
+	int cpu_id;
+	u64 nr_hits = 0, nr_misses = 0;
+	struct dw_rule_cache *rc;
+
+	if (atomic_cmpxchg(&ctx.started, 1, 0)) {
+		for_each_possible_cpu(cpu_id) {
+			rc = per_cpu_ptr(ctx.rule_cache, cpu_id);
+
+			nr_hits += rc->nr_hits;
+			nr_misses += rc->nr_misses;
+		}
+
+		pr_info("dwarf rule cache hits/misses: %llu/%llu\n",
+			nr_hits, nr_misses);
+
+		free_percpu(ctx.rule_cache);
 		free_percpu(ctx.cpu_ctx);
+	}
 }
 
 int quadd_dwarf_unwind_init(void)
 {
 	atomic_set(&ctx.started, 0);
+	atomic_set(&ctx.cache_gen, 1);
 	return 0;
 }
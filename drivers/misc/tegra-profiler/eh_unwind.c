@@ -585,6 +585,9 @@ mm_ex_list_add(struct ex_region_info *ri, pid_t pid)
 	}
 
 	raw_spin_unlock(&ctx.mm_ex_list_lock);
+
+	/* overlapped regions might have been replaced */
+	quadd_dwarf_unwind_invalidate();
 	return 0;
 
 out_free:
@@ -648,6 +651,8 @@ mm_ex_list_del(unsigned long vm_start, pid_t pid)
 out_unlock:
 	raw_spin_unlock(&ctx.mm_ex_list_lock);
 
+	quadd_dwarf_unwind_invalidate();
+
 	return err;
 }
 
@@ -25,6 +25,7 @@
 #include <linux/err.h>
 #include <linux/rculist.h>
 #include <linux/random.h>
+#include <linux/math64.h>
 #include <linux/version.h>
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 10, 0))
 #include <linux/sched/task_stack.h>
@@ -62,6 +63,12 @@ struct quadd_cpu_context {
 	bool is_tracing_enabled;
 
 	struct quadd_event_data events[QUADD_MAX_COUNTERS];
+
+	/* per-CPU to keep the sampling path free of shared cache lines */
+	u64 nr_samples;
+	u64 nr_skipped_samples;
+
+	struct quadd_hrt_overhead overhead;
 };
 
 struct hrt_pid_node {
@@ -192,9 +199,9 @@ __put_sample(struct quadd_record_data *data,
 
 	err = comm->put_sample(data, vec, vec_count, cpu_id);
 	if (err < 0)
-		atomic64_inc(&hrt.skipped_samples);
+		this_cpu_inc(hrt.cpu_ctx->nr_skipped_samples);
 
-	atomic64_inc(&hrt.counter_samples);
+	this_cpu_inc(hrt.cpu_ctx->nr_samples);
 }
 
 void
@@ -583,10 +590,16 @@ read_all_sources(struct pt_regs *regs, struct task_struct *task, u64 ts)
 	event_ctx.user_mode = user_mode(regs);
 	event_ctx.is_sched = !in_interrupt();
 
-	if (ctx->param.backtrace)
+	if (ctx->param.backtrace) {
 		get_backtrace_data(s, &event_ctx, cc, vec, &vec_idx);
-	else
+
+		this_cpu_add(hrt.cpu_ctx->overhead.unw_time_fp, cc->time_fp);
+		this_cpu_add(hrt.cpu_ctx->overhead.unw_time_ut, cc->time_ut);
+		this_cpu_add(hrt.cpu_ctx->overhead.unw_time_dwarf,
+			     cc->time_dwarf);
+	} else {
 		s->callchain_nr = 0;
+	}
 
 	if (hrt.get_stack_offset) {
 		long offset = get_stack_offset(task, user_regs, cc);
@@ -649,6 +662,10 @@ read_all_sources(struct pt_regs *regs, struct task_struct *task, u64 ts)
 	}
 
 	quadd_put_sample_this_cpu(&record_data, vec, vec_idx);
+
+	this_cpu_inc(hrt.cpu_ctx->overhead.nr_samples);
+	this_cpu_add(hrt.cpu_ctx->overhead.sample_time,
+		     quadd_get_time() - ts_start);
 }
 
 static enum hrtimer_restart hrtimer_handler(struct hrtimer *hrtimer)
@@ -974,6 +991,10 @@ static void reset_cpu_ctx(void)
 		cpu_ctx->is_sampling_enabled = false;
 		cpu_ctx->is_tracing_enabled = false;
 
+		cpu_ctx->nr_samples = 0;
+		cpu_ctx->nr_skipped_samples = 0;
+		memset(&cpu_ctx->overhead, 0, sizeof(cpu_ctx->overhead));
+
 		t_data->pid = -1;
 		t_data->tgid = -1;
 	}
@@ -1044,8 +1065,6 @@ int quadd_hrt_start(void)
 	else
 		hrt.ma_period = 0;
 
-	atomic64_set(&hrt.counter_samples, 0);
-	atomic64_set(&hrt.skipped_samples, 0);
 	atomic_set(&hrt.seqid, 0);
 
 	reset_cpu_ctx();
@@ -1103,9 +1122,22 @@ int quadd_hrt_start(void)
 
 void quadd_hrt_stop(void)
 {
-	pr_info("Stop hrt, samples all/skipped: %lld/%lld\n",
-		(long long)atomic64_read(&hrt.counter_samples),
-		(long long)atomic64_read(&hrt.skipped_samples));
+	struct quadd_module_state state;
+	struct quadd_hrt_overhead ovh;
+
+	quadd_hrt_get_state(&state);
+	quadd_hrt_get_overhead(&ovh);
+
+	pr_info("Stop hrt, samples all/skipped: %llu/%llu\n",
+		(unsigned long long)state.nr_all_samples,
+		(unsigned long long)state.nr_skipped_samples);
+
+	if (ovh.nr_samples > 0)
+		pr_info("sample cost: %llu ns, unw fp/ut/dwarf: %llu/%llu/%llu ns\n",
+			div64_u64(ovh.sample_time, ovh.nr_samples),
+			div64_u64(ovh.unw_time_fp, ovh.nr_samples),
+			div64_u64(ovh.unw_time_ut, ovh.nr_samples),
+			div64_u64(ovh.unw_time_dwarf, ovh.nr_samples));
 
 	quadd_ma_stop(&hrt);
 
@@ -1123,12 +1155,48 @@ void quadd_hrt_deinit(void)
 		quadd_hrt_stop();
 
 	free_percpu(hrt.cpu_ctx);
+	hrt.cpu_ctx = NULL;
 }
 
 void quadd_hrt_get_state(struct quadd_module_state *state)
 {
-	state->nr_all_samples = atomic64_read(&hrt.counter_samples);
-	state->nr_skipped_samples = atomic64_read(&hrt.skipped_samples);
+	int cpu_id;
+	struct quadd_cpu_context *cpu_ctx;
+
+	state->nr_all_samples = 0;
+	state->nr_skipped_samples = 0;
+
+	if (!hrt.cpu_ctx)
+		return;
+
+	for_each_possible_cpu(cpu_id) {
+		cpu_ctx = per_cpu_ptr(hrt.cpu_ctx, cpu_id);
+
+		state->nr_all_samples += READ_ONCE(cpu_ctx->nr_samples);
+		state->nr_skipped_samples +=
+			READ_ONCE(cpu_ctx->nr_skipped_samples);
+	}
+}
+
+void quadd_hrt_get_overhead(struct quadd_hrt_overhead *ovh)
+{
+	int cpu_id;
+	struct quadd_hrt_overhead *c;
+
+	memset(ovh, 0, sizeof(*ovh));
+
+	if (!hrt.cpu_ctx)
+		return;
+
+	for_each_possible_cpu(cpu_id) {
+		c = &per_cpu_ptr(hrt.cpu_ctx, cpu_id)->overhead;
+
+		ovh->nr_samples += READ_ONCE(c->nr_samples);
+		ovh->sample_time += READ_ONCE(c->sample_time);
+		ovh->unw_time_fp += READ_ONCE(c->unw_time_fp);
+		ovh->unw_time_ut += READ_ONCE(c->unw_time_ut);
+		ovh->unw_time_dwarf += READ_ONCE(c->unw_time_dwarf);
+	}
 }
 
 static void init_arch_timer(void)
@@ -1170,8 +1238,6 @@ struct quadd_hrt_ctx *quadd_hrt_init(struct quadd_ctx *ctx)
 	else
 		hrt.ma_period = 0;
 
-	atomic64_set(&hrt.counter_samples, 0);
-	atomic64_set(&hrt.skipped_samples, 0);
 	atomic_set(&hrt.seqid, 0);
 
 	init_arch_timer();
@@ -43,8 +43,6 @@ struct quadd_hrt_ctx {
 	atomic_t active;
 	atomic_t mmap_active;
 
-	atomic64_t counter_samples;
-	atomic64_t skipped_samples;
 	atomic_t seqid;
 
 	struct timer_list ma_timer;
@@ -78,6 +76,15 @@ struct quadd_event_context {
 
 #define QUADD_HRT_MIN_FREQ	100
 
+/* profiler self-overhead, summed over all CPUs */
+struct quadd_hrt_overhead {
+	u64 nr_samples;
+	u64 sample_time;	/* ns spent in the sampling handlers */
+	u64 unw_time_fp;	/* ns spent in each unwinder */
+	u64 unw_time_ut;
+	u64 unw_time_dwarf;
+};
+
 struct quadd_record_data;
 struct quadd_module_state;
 struct quadd_iovec;
@@ -96,6 +103,7 @@ quadd_put_sample(struct quadd_record_data *data,
 		 struct quadd_iovec *vec, int vec_count);
 
 void quadd_hrt_get_state(struct quadd_module_state *state);
+void quadd_hrt_get_overhead(struct quadd_hrt_overhead *ovh);
 u64 quadd_get_time(void);
 bool quadd_is_inherited(struct task_struct *task);
 
@@ -19,12 +19,14 @@
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <linux/version.h>
+#include <linux/math64.h>
 
 #include <linux/tegra_profiler.h>
 
 #include "quadd.h"
 #include "version.h"
 #include "quadd_proc.h"
+#include "hrt.h"
 #include "arm_pmu.h"
 
 #define YES_NO(x) ((x) ? "yes" : "no")
@@ -207,8 +209,12 @@ static int show_status(struct seq_file *f, void *offset)
 	unsigned int status;
 	unsigned int is_auth_open, active;
 	struct quadd_module_state s;
+	struct quadd_hrt_overhead ovh;
+	u64 nr;
 
 	quadd_get_state(&s);
+	quadd_hrt_get_overhead(&ovh);
+	nr = max_t(u64, ovh.nr_samples, 1);
 	status = s.reserved[QUADD_MOD_STATE_IDX_STATUS];
 
 	active = status & QUADD_MOD_STATE_STATUS_IS_ACTIVE;
@@ -218,6 +224,12 @@ static int show_status(struct seq_file *f, void *offset)
 	seq_printf(f, "auth:            %s\n", YES_NO(is_auth_open));
 	seq_printf(f, "all samples:     %llu\n", s.nr_all_samples);
 	seq_printf(f, "skipped samples: %llu\n", s.nr_skipped_samples);
+	seq_printf(f, "sample cost:     %llu ns\n",
+		   div64_u64(ovh.sample_time, nr));
+	seq_printf(f, "unwind cost:     fp/ut/dwarf: %llu/%llu/%llu ns\n",
+		   div64_u64(ovh.unw_time_fp, nr),
+		   div64_u64(ovh.unw_time_ut, nr),
+		   div64_u64(ovh.unw_time_dwarf, nr));
 
 	return 0;
 }
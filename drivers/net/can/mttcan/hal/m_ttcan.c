@@ -456,6 +456,12 @@ void ttcan_tx_trigger_msg_transmit(struct ttcan_controller *ttcan, u8 index)
 	ttcan_write32(ttcan, ADR_MTTCAN_TXBAR, (1 << index));
 }
 
+/* Add transmission requests for all buffers in mask with one write */
+void ttcan_tx_trigger_msgs_transmit(struct ttcan_controller *ttcan, u32 mask)
+{
+	ttcan_write32(ttcan, ADR_MTTCAN_TXBAR, mask);
+}
+
 int ttcan_tx_msg_buffer_write(struct ttcan_controller *ttcan,
 			      struct ttcanfd_frame *ttcanfd)
 {
@@ -566,9 +572,15 @@ int ttcan_tx_fifo_full(struct ttcan_controller *ttcan)
 
 static int process_rx_mesg(struct ttcan_controller *ttcan, u32 addr)
 {
-	struct ttcanfd_frame ttcanfd = {0};
-	ttcan_read_rx_msg_ram(ttcan, addr, &ttcanfd);
-	return add_msg_controller_list(ttcan, &ttcanfd, &ttcan->rx_b, BUFFER);
+	struct ttcanfd_frame *ttcanfd = ttcan_rx_ring_get_slot(&ttcan->rx_b);
+
+	if (!ttcanfd) {
+		pr_debug("%s: rx buffer ring is full\n", __func__);
+		return -ENOMEM;
+	}
+	ttcan_read_rx_msg_ram(ttcan, addr, ttcanfd);
+	ttcan_rx_ring_commit(&ttcan->rx_b);
+	return 0;
 }
 
 int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
@@ -613,7 +625,7 @@ int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
 
 unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 {
-	struct mttcan_tx_evt_element txevt;
+	struct mttcan_tx_evt_element *txevt;
 	u32 txefs;
 	u32 read_addr;
 	int q_read = 0;
@@ -637,12 +649,14 @@ unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 		pr_debug("%s:txevt: read_addr %x EFGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_txevt_ram(ttcan, read_addr, &txevt);
-		if (add_event_controller_list(ttcan, &txevt,
-					      &ttcan->tx_evt) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		/* leave the event in the FIFO until there is room for it */
+		txevt = ttcan_txevt_ring_get_slot(&ttcan->tx_evt);
+		if (!txevt) {
+			pr_debug("%s: tx event ring is full\n", __func__);
 			return msgs_read;
 		}
+		ttcan_read_txevt_ram(ttcan, read_addr, txevt);
+		ttcan_txevt_ring_commit(&ttcan->tx_evt);
 		ttcan_write32(ttcan, ADR_MTTCAN_TXEFA, get_idx);
 		txefs = ttcan_read32(ttcan, ADR_MTTCAN_TXEFS);
 		msgs_read++;
@@ -655,7 +669,7 @@ unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 {
 	u32 rxf0s_reg;
-	struct ttcanfd_frame ttcanfd = {0};
+	struct ttcanfd_frame *ttcanfd;
 	u32 read_addr;
 	int q_read = 0;
 	unsigned int msgs_read = 0;
@@ -686,12 +700,14 @@ unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 		pr_debug("%s:fifo0: read_addr %x FOGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q0, FIFO_0) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		/* leave the frame in the FIFO until there is room for it */
+		ttcanfd = ttcan_rx_ring_get_slot(&ttcan->rx_q0);
+		if (!ttcanfd) {
+			pr_debug("%s: rx fifo0 ring is full\n", __func__);
 			return msgs_read;
 		}
+		ttcan_read_rx_msg_ram(ttcan, read_addr, ttcanfd);
+		ttcan_rx_ring_commit(&ttcan->rx_q0);
 		ttcan_write32(ttcan, ADR_MTTCAN_RXF0A, get_idx);
 		rxf0s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF0S);
 		msgs_read++;
@@ -702,7 +718,7 @@ unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
 {
 	u32 rxf1s_reg;
-	struct ttcanfd_frame ttcanfd = {0};
+	struct ttcanfd_frame *ttcanfd;
 	u32 read_addr;
 	int q_read = 0;
 	int msgs_read = 0;
@@ -732,12 +748,14 @@ unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
 		pr_debug("%s:fifo1: read_addr %x FOGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q1, FIFO_1) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		/* leave the frame in the FIFO until there is room for it */
+		ttcanfd = ttcan_rx_ring_get_slot(&ttcan->rx_q1);
+		if (!ttcanfd) {
+			pr_debug("%s: rx fifo1 ring is full\n", __func__);
 			return msgs_read;
 		}
+		ttcan_read_rx_msg_ram(ttcan, read_addr, ttcanfd);
+		ttcan_rx_ring_commit(&ttcan->rx_q1);
 		ttcan_write32(ttcan, ADR_MTTCAN_RXF1A, get_idx);
 		rxf1s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF1S);
 		msgs_read++;
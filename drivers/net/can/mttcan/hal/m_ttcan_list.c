@@ -16,98 +16,82 @@
 
 #include "m_ttcan.h"
 
-#define TTCAN_MAX_LIST_MEMBERS 128
+/*
+ * The producer only writes head and the consumer only writes tail. Slots are
+ * handed over by the release of the index that follows the slot access, and
+ * picked up by the acquire of that index on the other side.
+ */
+
+#define TTCAN_RING_IDX(idx, size)	((idx) & ((size) - 1))
 
-inline int is_msg_list_full(struct ttcan_controller *ttcan,
-		enum ttcan_rx_type rxtype)
+void ttcan_reset_rings(struct ttcan_controller *ttcan)
 {
-	return ttcan->list_status & rxtype & 0xFF;
+	ttcan->rx_q0.head = ttcan->rx_q0.tail = 0;
+	ttcan->rx_q1.head = ttcan->rx_q1.tail = 0;
+	ttcan->rx_b.head = ttcan->rx_b.tail = 0;
+	ttcan->tx_evt.head = ttcan->tx_evt.tail = 0;
 }
 
-int add_msg_controller_list(struct ttcan_controller *ttcan,
-			    struct ttcanfd_frame *ttcanfd,
-			    struct list_head *rx_q,
-			    enum ttcan_rx_type rxtype)
+/* Returns the slot to fill in place or NULL when the ring is full */
+struct ttcanfd_frame *ttcan_rx_ring_get_slot(struct ttcan_rx_ring *ring)
 {
+	unsigned int tail = smp_load_acquire(&ring->tail);
 
-	struct ttcan_rx_msg_list *msg_list;
-
-	msg_list = (struct ttcan_rx_msg_list *)
-		kzalloc(sizeof(struct ttcan_rx_msg_list), GFP_ATOMIC);
-	if (msg_list == NULL) {
-		pr_err("%s: memory allocation failed\n", __func__);
-		return -ENOMEM;
-	}
-
-	INIT_LIST_HEAD(&msg_list->recv_list);
-
-	memcpy(&msg_list->msg, ttcanfd, sizeof(struct ttcanfd_frame));
-
-	spin_lock(&ttcan->lock);
-
-	if (is_msg_list_full(ttcan, rxtype)) {
-		pr_err("%s: mesg list is full\n", __func__);
-		kfree(msg_list);
-		spin_unlock(&ttcan->lock);
-		return -ENOMEM;
-	}
-
-	list_add_tail(&msg_list->recv_list, rx_q);
-
-	switch (rxtype) {
-	case BUFFER:
-		if (++ttcan->rxb_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= BUFFER;
-		break;
-	case FIFO_0:
-		if (++ttcan->rxq0_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= FIFO_0;
-		break;
-	case FIFO_1:
-		if (++ttcan->rxq1_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= FIFO_1;
-	default:
-		break;
-	}
-	spin_unlock(&ttcan->lock);
-
-	return 0;
+	if (ring->head - tail >= TTCAN_RX_RING_SIZE)
+		return NULL;
+
+	return &ring->msg[TTCAN_RING_IDX(ring->head, TTCAN_RX_RING_SIZE)];
 }
 
-int add_event_controller_list(struct ttcan_controller *ttcan,
-			    struct mttcan_tx_evt_element *txevt,
-			    struct list_head *evt_q)
+void ttcan_rx_ring_commit(struct ttcan_rx_ring *ring)
 {
+	smp_store_release(&ring->head, ring->head + 1);
+}
 
-	struct ttcan_txevt_msg_list *evt_list;
+/* Returns the oldest frame or NULL when the ring is empty */
+struct ttcanfd_frame *ttcan_rx_ring_peek(struct ttcan_rx_ring *ring)
+{
+	unsigned int head = smp_load_acquire(&ring->head);
+
+	if (head == ring->tail)
+		return NULL;
+
+	return &ring->msg[TTCAN_RING_IDX(ring->tail, TTCAN_RX_RING_SIZE)];
+}
 
-	evt_list =
-	    (struct ttcan_txevt_msg_list *)
-	    kzalloc(sizeof(struct ttcan_txevt_msg_list), GFP_ATOMIC);
-	if (evt_list == NULL) {
-		pr_err("%s: memory allocation failed\n", __func__);
-		return -ENOMEM;
-	}
+void ttcan_rx_ring_consume(struct ttcan_rx_ring *ring)
+{
+	smp_store_release(&ring->tail, ring->tail + 1);
+}
 
-	INIT_LIST_HEAD(&evt_list->txevt_list);
+struct mttcan_tx_evt_element *
+ttcan_txevt_ring_get_slot(struct ttcan_txevt_ring *ring)
+{
+	unsigned int tail = smp_load_acquire(&ring->tail);
 
-	memcpy(&evt_list->txevt, txevt, sizeof(struct mttcan_tx_evt_element));
+	if (ring->head - tail >= TTCAN_TXEVT_RING_SIZE)
+		return NULL;
 
-	spin_lock(&ttcan->lock);
+	return &ring->txevt[TTCAN_RING_IDX(ring->head, TTCAN_TXEVT_RING_SIZE)];
+}
 
-	if (is_msg_list_full(ttcan, TX_EVT)) {
-		pr_err("%s: mesg list is full\n", __func__);
-		kfree(evt_list);
-		spin_unlock(&ttcan->lock);
-		return -1;
-	}
+void ttcan_txevt_ring_commit(struct ttcan_txevt_ring *ring)
+{
+	smp_store_release(&ring->head, ring->head + 1);
+}
 
-	list_add_tail(&evt_list->txevt_list, evt_q);
+struct mttcan_tx_evt_element *
+ttcan_txevt_ring_peek(struct ttcan_txevt_ring *ring)
+{
+	unsigned int head = smp_load_acquire(&ring->head);
 
-	if (++ttcan->evt_mem >= TTCAN_MAX_LIST_MEMBERS)
-		ttcan->list_status |= TX_EVT;
+	if (head == ring->tail)
+		return NULL;
 
-	spin_unlock(&ttcan->lock);
+	return &ring->txevt[TTCAN_RING_IDX(ring->tail, TTCAN_TXEVT_RING_SIZE)];
+}
 
-	return 0;
+void ttcan_txevt_ring_consume(struct ttcan_txevt_ring *ring)
+{
+	smp_store_release(&ring->tail, ring->tail + 1);
 }
@@ -276,14 +276,25 @@ struct ttcan_filter_config {
 	u32 xtd_fltr_size;
 };
 
-struct ttcan_rx_msg_list {
-	struct ttcanfd_frame msg;
-	struct list_head recv_list;
+/*
+ * Rx and Tx event rings are filled by the message RAM readers and drained
+ * by NAPI. There is exactly one producer and one consumer per ring, so the
+ * indices are free running and handed over with acquire/release ordering.
+ * Sizes must be a power of 2.
+ */
+#define TTCAN_RX_RING_SIZE	128
+#define TTCAN_TXEVT_RING_SIZE	32
+
+struct ttcan_rx_ring {
+	unsigned int head;
+	unsigned int tail;
+	struct ttcanfd_frame msg[TTCAN_RX_RING_SIZE];
 };
 
-struct ttcan_txevt_msg_list {
-	struct mttcan_tx_evt_element txevt;
-	struct list_head txevt_list;
+struct ttcan_txevt_ring {
+	unsigned int head;
+	unsigned int tail;
+	struct mttcan_tx_evt_element txevt[TTCAN_TXEVT_RING_SIZE];
 };
 
 struct ttcan_controller {
@@ -294,10 +305,10 @@ struct ttcan_controller {
 	struct ttcan_rxbuff_config rx_config;
 	struct ttcan_filter_config fltr_config;
 	struct ttcan_mram_elem mram_cfg[MRAM_ELEMS];
-	struct list_head rx_q0;
-	struct list_head rx_q1;
-	struct list_head rx_b;
-	struct list_head tx_evt;
+	struct ttcan_rx_ring rx_q0;
+	struct ttcan_rx_ring rx_q1;
+	struct ttcan_rx_ring rx_b;
+	struct ttcan_txevt_ring tx_evt;
 	void __iomem *base;	/* controller regs space should be remapped. */
 	void __iomem *xbase;    /* extra registers are mapped */
 	void __iomem *mram_vbase;
@@ -314,11 +325,6 @@ struct ttcan_controller {
 	u32 tdc_offset;
 	unsigned long tx_object;
 	unsigned long tx_obj_cancelled;
-	int rxq0_mem;
-	int rxq1_mem;
-	int rxb_mem;
-	int evt_mem;
-	u16 list_status;	/* bit 0: 1=Full; */
 	u16 resv0;
 };
 
@@ -462,6 +468,7 @@ void ttcan_tx_ded_msg_write(struct ttcan_controller *ttcan,
 			    struct ttcanfd_frame *ttcanfd,
 			    u8 index);
 void ttcan_tx_trigger_msg_transmit(struct ttcan_controller *ttcan, u8 index);
+void ttcan_tx_trigger_msgs_transmit(struct ttcan_controller *ttcan, u32 mask);
 int ttcan_tx_msg_buffer_write(struct ttcan_controller *ttcan,
 				struct ttcanfd_frame *ttcanfd);
 
@@ -555,14 +562,20 @@ int ttcan_set_tur_config(struct ttcan_controller *ttcan, u16 denominator,
 
 void ttcan_prog_trigger_mem(struct ttcan_controller *ttcan, void *tmc_shadow);
 
-/* list APIs */
-int add_msg_controller_list(struct ttcan_controller *ttcan,
-	struct ttcanfd_frame *ttcanfd, struct list_head *rx_q,
-	enum ttcan_rx_type rxtype);
+/* ring APIs */
+void ttcan_reset_rings(struct ttcan_controller *ttcan);
+
+struct ttcanfd_frame *ttcan_rx_ring_get_slot(struct ttcan_rx_ring *ring);
+void ttcan_rx_ring_commit(struct ttcan_rx_ring *ring);
+struct ttcanfd_frame *ttcan_rx_ring_peek(struct ttcan_rx_ring *ring);
+void ttcan_rx_ring_consume(struct ttcan_rx_ring *ring);
 
-int add_event_controller_list(struct ttcan_controller *ttcan,
-				struct mttcan_tx_evt_element *txevt,
-				struct list_head *evt_q);
+struct mttcan_tx_evt_element *
+ttcan_txevt_ring_get_slot(struct ttcan_txevt_ring *ring);
+void ttcan_txevt_ring_commit(struct ttcan_txevt_ring *ring);
+struct mttcan_tx_evt_element *
+ttcan_txevt_ring_peek(struct ttcan_txevt_ring *ring);
+void ttcan_txevt_ring_consume(struct ttcan_txevt_ring *ring);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 u64 ttcan_read_ts_cntr(const struct cyclecounter *ccnt);
 #else
@@ -120,6 +120,7 @@ struct mttcan_priv {
 	u32 irq_ttflags;
 	u32 irqstatus;
 	u32 tt_irqstatus;
+	u32 tx_pending; /* TXBAR bits not yet requested, under tx_lock */
 	u32 instance;
 	int tt_intrs;
 	int tt_param[2];
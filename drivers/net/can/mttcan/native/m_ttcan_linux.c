@@ -354,80 +354,73 @@ static int mttcan_hpm_do_receive(struct net_device *dev,
 	return 1;
 }
 
+/* Drain up to quota frames from an Rx ring and hand them up as one batch */
 static int mttcan_read_rcv_list(struct net_device *dev,
-				struct list_head *rcv,
-				enum ttcan_rx_type rx_type,
-				int rec_msgs, int quota)
+				struct ttcan_rx_ring *rcv, int quota)
 {
-	unsigned int pushed;
-	unsigned long flags;
+	int rec_msgs = 0;
 	struct mttcan_priv *priv = netdev_priv(dev);
-	struct ttcan_rx_msg_list *rx;
 	struct net_device_stats *stats = &dev->stats;
-	struct list_head *cur, *next, rx_q;
-
-	if (list_empty(rcv))
-		return 0;
-
-	INIT_LIST_HEAD(&rx_q);
-
-	spin_lock_irqsave(&priv->ttcan->lock, flags);
-	switch (rx_type) {
-	case BUFFER:
-		priv->ttcan->rxb_mem = 0;
-		priv->ttcan->list_status &= ~(BUFFER & 0xFF);
-		break;
-	case FIFO_0:
-		priv->ttcan->rxq0_mem = 0;
-		priv->ttcan->list_status &= ~(FIFO_0 & 0xFF);
-		break;
-	case FIFO_1:
-		priv->ttcan->rxq1_mem = 0;
-		priv->ttcan->list_status &= ~(FIFO_1 & 0xFF);
-	default:
-		break;
-	}
-	list_splice_init(rcv, &rx_q);
-	spin_unlock_irqrestore(&priv->ttcan->lock, flags);
+	struct ttcanfd_frame *msg;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	LIST_HEAD(rx_list);
+#endif
 
-	pushed = rec_msgs;
-	list_for_each_safe(cur, next, &rx_q) {
+	while (rec_msgs < quota) {
 		struct sk_buff *skb;
 		struct canfd_frame *fd_frame;
 		struct can_frame *frame;
-		if (!quota--)
+
+		msg = ttcan_rx_ring_peek(rcv);
+		if (!msg)
 			break;
-		list_del_init(cur);
 
-		rx = list_entry(cur, struct ttcan_rx_msg_list, recv_list);
-		if (rx->msg.flags & CAN_FD_FLAG) {
+		if (msg->flags & CAN_FD_FLAG) {
 			skb = alloc_canfd_skb(dev, &fd_frame);
-			if (!skb) {
-				stats->rx_dropped += pushed;
-				return 0;
+			if (skb) {
+				memcpy(fd_frame, msg,
+				       sizeof(struct canfd_frame));
+				stats->rx_bytes += fd_frame->len;
 			}
-			memcpy(fd_frame, &rx->msg, sizeof(struct canfd_frame));
-			stats->rx_bytes += fd_frame->len;
 		} else {
 			skb = alloc_can_skb(dev, &frame);
-			if (!skb) {
-				stats->rx_dropped += pushed;
-				return 0;
+			if (skb) {
+				frame->can_id =  msg->can_id;
+				frame->can_dlc = msg->d_len;
+				memcpy(frame->data, &msg->data,
+				       frame->can_dlc);
+				stats->rx_bytes += frame->can_dlc;
 			}
-			frame->can_id =  rx->msg.can_id;
-			frame->can_dlc = rx->msg.d_len;
-			memcpy(frame->data, &rx->msg.data, frame->can_dlc);
-			stats->rx_bytes += frame->can_dlc;
 		}
 
-		if (priv->hwts_rx_en)
-			mttcan_rx_hwtstamp(priv, skb, &rx->msg);
-		kfree(rx);
-		netif_receive_skb(skb);
-		stats->rx_packets++;
-		pushed--;
+		if (skb) {
+			if (priv->hwts_rx_en)
+				mttcan_rx_hwtstamp(priv, skb, msg);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+			list_add_tail(&skb->list, &rx_list);
+#else
+			netif_receive_skb(skb);
+#endif
+			stats->rx_packets++;
+		} else {
+			stats->rx_dropped++;
+		}
+
+		ttcan_rx_ring_consume(rcv);
+		rec_msgs++;
 	}
-	return rec_msgs - pushed;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	netif_receive_skb_list(&rx_list);
+#endif
+	return rec_msgs;
+}
+
+static bool mttcan_rx_pending(struct ttcan_controller *ttcan)
+{
+	return ttcan_rx_ring_peek(&ttcan->rx_b) ||
+		ttcan_rx_ring_peek(&ttcan->rx_q0) ||
+		ttcan_rx_ring_peek(&ttcan->rx_q1);
 }
 
 static int mttcan_state_change(struct net_device *dev,
@@ -564,33 +557,13 @@ static int mttcan_handle_bus_err(struct net_device *dev,
 static void mttcan_tx_event(struct net_device *dev)
 {
 	struct mttcan_priv *priv = netdev_priv(dev);
-	struct ttcan_txevt_msg_list *evt;
-	struct list_head *cur, *next, evt_q;
+	struct mttcan_tx_evt_element *evt;
 	struct mttcan_tx_evt_element txevt;
 	u32 xtd, id;
-	unsigned long flags;
-
-	INIT_LIST_HEAD(&evt_q);
-
-	spin_lock_irqsave(&priv->ttcan->lock, flags);
 
-	if (list_empty(&priv->ttcan->tx_evt)) {
-		spin_unlock_irqrestore(&priv->ttcan->lock, flags);
-		return;
-	}
-
-	priv->ttcan->evt_mem = 0;
-	priv->ttcan->list_status &= ~(TX_EVT & 0xFF);
-	list_splice_init(&priv->ttcan->tx_evt, &evt_q);
-	spin_unlock_irqrestore(&priv->ttcan->lock, flags);
-
-	list_for_each_safe(cur, next, &evt_q) {
-		list_del_init(cur);
-
-		evt = list_entry(cur, struct ttcan_txevt_msg_list, txevt_list);
-		memcpy(&txevt, &evt->txevt,
-			sizeof(struct mttcan_tx_evt_element));
-		kfree(evt);
+	while ((evt = ttcan_txevt_ring_peek(&priv->ttcan->tx_evt))) {
+		txevt = *evt;
+		ttcan_txevt_ring_consume(&priv->ttcan->tx_evt);
 		xtd = (txevt.f0 & MTT_TXEVT_ELE_F0_XTD_MASK) >>
 			MTT_TXEVT_ELE_F0_XTD_SHIFT;
 		id = (txevt.f0 & MTT_TXEVT_ELE_F0_ID_MASK) >>
@@ -674,7 +647,6 @@ static void mttcan_tx_cancelled(struct net_device *dev)
 static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 {
 	int work_done = 0;
-	int rec_msgs = 0;
 	struct net_device *dev = napi->dev;
 	struct mttcan_priv *priv = netdev_priv(dev);
 	u32 ir, ack, ttir, ttack, psr;
@@ -779,10 +751,9 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 		if (ir & MTT_IR_DRX_MASK) {
 			ack = MTT_IR_DRX_MASK;
 			ttcan_ir_write(priv->ttcan, ack);
-			rec_msgs = ttcan_read_rx_buffer(priv->ttcan);
+			ttcan_read_rx_buffer(priv->ttcan);
 			work_done +=
 			    mttcan_read_rcv_list(dev, &priv->ttcan->rx_b,
-						 BUFFER, rec_msgs,
 						 quota - work_done);
 			pr_debug("%s: buffer mesg received\n", __func__);
 
@@ -814,11 +785,10 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 					MTT_IR_RF1N_MASK);
 				ttcan_ir_write(priv->ttcan, ack);
 
-				rec_msgs = ttcan_read_rx_fifo1(priv->ttcan);
+				ttcan_read_rx_fifo1(priv->ttcan);
 				work_done +=
 				    mttcan_read_rcv_list(dev,
 							 &priv->ttcan->rx_q1,
-							 FIFO_1, rec_msgs,
 							 quota - work_done);
 				pr_debug("%s: msg received in Q1\n", __func__);
 			}
@@ -828,11 +798,10 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 					MTT_IR_RF0W_MASK |
 					MTT_IR_RF0N_MASK);
 				ttcan_ir_write(priv->ttcan, ack);
-				rec_msgs = ttcan_read_rx_fifo0(priv->ttcan);
+				ttcan_read_rx_fifo0(priv->ttcan);
 				work_done +=
 				    mttcan_read_rcv_list(dev,
 							 &priv->ttcan->rx_q0,
-							 FIFO_0, rec_msgs,
 							 quota - work_done);
 				pr_debug("%s: msg received in Q0\n", __func__);
 			}
@@ -943,6 +912,26 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 		ttcan_ttir_write(priv->ttcan, ttack);
 	}
 end:
+	/* Frames left behind by an earlier poll that ran out of quota */
+	work_done += mttcan_read_rcv_list(dev, &priv->ttcan->rx_b,
+					  quota - work_done);
+	work_done += mttcan_read_rcv_list(dev, &priv->ttcan->rx_q0,
+					  quota - work_done);
+	work_done += mttcan_read_rcv_list(dev, &priv->ttcan->rx_q1,
+					  quota - work_done);
+
+	if (mttcan_rx_pending(priv->ttcan)) {
+		/*
+		 * Stay scheduled with interrupts off and refill the rings on
+		 * the next poll, frames may have been left in message RAM
+		 * while the rings were full.
+		 */
+		priv->irqstatus = MTT_IR_DRX_MASK | MTT_IR_RF0N_MASK |
+			MTT_IR_RF1N_MASK;
+		priv->tt_irqstatus = 0;
+		return quota;
+	}
+
 	if (work_done < quota) {
 		napi_complete(napi);
 
@@ -1310,6 +1299,8 @@ static int mttcan_open(struct net_device *dev)
 		goto fail;
 	}
 
+	ttcan_reset_rings(priv->ttcan);
+	priv->tx_pending = 0;
 	napi_enable(&priv->napi);
 	can_led_event(dev, CAN_LED_EVENT_OPEN);
 
@@ -1342,15 +1333,42 @@ static int mttcan_close(struct net_device *dev)
 	return 0;
 }
 
+static inline bool mttcan_xmit_more(struct sk_buff *skb)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+	return netdev_xmit_more();
+#else
+	return skb->xmit_more;
+#endif
+}
+
+/* Request transmission of all buffers written since the last flush */
+static void mttcan_tx_flush(struct mttcan_priv *priv)
+{
+	if (priv->tx_pending) {
+		ttcan_tx_trigger_msgs_transmit(priv->ttcan, priv->tx_pending);
+		priv->tx_pending = 0;
+	}
+}
+
 static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 				     struct net_device *dev)
 {
 	int msg_no = -1;
+	bool fifo = false;
+	bool more = mttcan_xmit_more(skb);
 	struct mttcan_priv *priv = netdev_priv(dev);
 	struct canfd_frame *frame = (struct canfd_frame *)skb->data;
 
-	if (can_dropped_invalid_skb(dev, skb))
+	if (can_dropped_invalid_skb(dev, skb)) {
+		/* the burst may end here, do not strand earlier requests */
+		if (!more) {
+			spin_lock_bh(&priv->tx_lock);
+			mttcan_tx_flush(priv);
+			spin_unlock_bh(&priv->tx_lock);
+		}
 		return NETDEV_TX_OK;
+	}
 
 	if (can_is_canfd_skb(skb))
 		frame->flags |= CAN_FD_FLAG;
@@ -1360,9 +1378,13 @@ static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 	/* Write Tx message to controller */
 	msg_no = ttcan_tx_msg_buffer_write(priv->ttcan,
 			(struct ttcanfd_frame *)frame);
-	if (msg_no < 0)
+	if (msg_no < 0) {
+		/* FIFO put index only moves once the pending requests land */
+		mttcan_tx_flush(priv);
 		msg_no = ttcan_tx_fifo_queue_msg(priv->ttcan,
 				(struct ttcanfd_frame *)frame);
+		fifo = true;
+	}
 
 	if (msg_no < 0) {
 		netif_stop_queue(dev);
@@ -1371,9 +1393,16 @@ static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 	}
 	can_put_echo_skb(skb, dev, msg_no);
 
-	/* Set go bit for non-TTCAN messages */
-	if (!priv->tt_param[0])
-		ttcan_tx_trigger_msg_transmit(priv->ttcan, msg_no);
+	/*
+	 * Set go bit for non-TTCAN messages. Dedicated buffers are reserved
+	 * in tx_object below, so requests for a burst from the stack are
+	 * collected and added with a single TXBAR write.
+	 */
+	if (!priv->tt_param[0]) {
+		priv->tx_pending |= 1U << msg_no;
+		if (fifo || !more)
+			mttcan_tx_flush(priv);
+	}
 
 	/* State management for Tx complete/cancel processing */
 	if (test_and_set_bit(msg_no, &priv->ttcan->tx_object) &&
@@ -1827,10 +1856,6 @@ static int mttcan_probe(struct platform_device *pdev)
 	priv->ttcan->mram_size = mesg_ram->end - mesg_ram->start + 1;
 	priv->ttcan->id = priv->instance;
 	priv->ttcan->mram_vbase = mram_addr;
-	INIT_LIST_HEAD(&priv->ttcan->rx_q0);
-	INIT_LIST_HEAD(&priv->ttcan->rx_q1);
-	INIT_LIST_HEAD(&priv->ttcan->rx_b);
-	INIT_LIST_HEAD(&priv->ttcan->tx_evt);
 
 	platform_set_drvdata(pdev, dev);
 	SET_NETDEV_DEV(dev, &pdev->dev);
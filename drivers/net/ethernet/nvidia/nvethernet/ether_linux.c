@@ -1675,6 +1675,25 @@ err_chan_irq:
 	return ret;
 }
 
+#ifdef ETHER_DIM
+/**
+ * @brief Restart adaptive moderation of a channel from the first profile.
+ *
+ * @param[in] dim: DIM state of the channel.
+ * @param[in] events: Poll counter of the channel.
+ */
+static void ether_dim_reset(struct dim *dim, u16 *events)
+{
+	dim->state = DIM_START_MEASURE;
+	dim->tune_state = DIM_PARKING_ON_TOP;
+	dim->profile_ix = 0;
+	dim->steps_left = 0;
+	dim->steps_right = 0;
+	dim->tired = 0;
+	*events = 0;
+}
+#endif
+
 /**
  * @brief Disable NAPI.
  *
@@ -1699,6 +1718,11 @@ static void ether_napi_disable(struct ether_priv_data *pdata)
 		napi_disable(&pdata->tx_napi[chan]->napi);
 		napi_synchronize(&pdata->rx_napi[chan]->napi);
 		napi_disable(&pdata->rx_napi[chan]->napi);
+#ifdef ETHER_DIM
+		hrtimer_cancel(&pdata->rx_napi[chan]->dim_timer);
+		cancel_work_sync(&pdata->rx_napi[chan]->dim.work);
+		cancel_work_sync(&pdata->tx_napi[chan]->dim.work);
+#endif
 	}
 }
 
@@ -1719,6 +1743,14 @@ static void ether_napi_enable(struct ether_priv_data *pdata)
 
 	for (i = 0; i < osi_dma->num_dma_chans; i++) {
 		chan = osi_dma->dma_chans[i];
+#ifdef ETHER_DIM
+		ether_dim_reset(&pdata->tx_napi[chan]->dim,
+				&pdata->tx_napi[chan]->events);
+		pdata->tx_napi[chan]->dim_usecs = osi_dma->tx_usecs;
+		ether_dim_reset(&pdata->rx_napi[chan]->dim,
+				&pdata->rx_napi[chan]->events);
+		pdata->rx_napi[chan]->dim_usecs = 0;
+#endif
 
 		napi_enable(&pdata->tx_napi[chan]->napi);
 		napi_enable(&pdata->rx_napi[chan]->napi);
@@ -2886,7 +2918,6 @@ static int ether_close(struct net_device *ndev)
 
 #ifdef ETHER_NVGRO
 	del_timer_sync(&pdata->nvgro_timer);
-	/* TODO: purge the queues */
 #endif
 
 	/* Unregister broadcasting MAC timestamp to clients */
@@ -2943,6 +2974,10 @@ static int ether_close(struct net_device *ndev)
 	osi_hw_dma_deinit(pdata->osi_dma);
 
 	ether_napi_disable(pdata);
+#ifdef ETHER_NVGRO
+	/* drop the packets held for reassembly */
+	ether_nvgro_flush(pdata);
+#endif
 
 	/* free DMA resources after DMA stop */
 	free_dma_resources(pdata);
@@ -3352,6 +3387,27 @@ static unsigned short ether_select_queue(struct net_device *dev,
 	return txqueue_select;
 }
 
+/**
+ * @brief Period of the Tx completion SW timer of a channel.
+ *
+ * Algorithm: Returns the period selected by adaptive moderation for the
+ * channel when adaptive-tx is enabled, or the static tx_usecs otherwise.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] tx_napi: Tx NAPI instance of the channel.
+ *
+ * @retval SW timer period in usecs.
+ */
+static inline unsigned int ether_tx_usecs(struct ether_priv_data *pdata,
+					  struct ether_tx_napi *tx_napi)
+{
+#ifdef ETHER_DIM
+	if (pdata->use_adaptive_tx == OSI_ENABLE)
+		return READ_ONCE(tx_napi->dim_usecs);
+#endif
+	return pdata->osi_dma->tx_usecs;
+}
+
 /**
  * @brief Network layer hook for data transmission.
  *
@@ -3413,8 +3469,8 @@ static int ether_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		atomic_set(&pdata->tx_napi[chan]->tx_usecs_timer_armed,
 			   OSI_ENABLE);
 		hrtimer_start(&pdata->tx_napi[chan]->tx_usecs_timer,
-			      osi_dma->tx_usecs * NSEC_PER_USEC,
-			      HRTIMER_MODE_REL);
+			      ether_tx_usecs(pdata, pdata->tx_napi[chan]) *
+			      NSEC_PER_USEC, HRTIMER_MODE_REL);
 	}
 	return NETDEV_TX_OK;
 }
@@ -4234,6 +4290,92 @@ static const struct net_device_ops ether_netdev_ops = {
 #endif
 };
 
+#ifdef ETHER_DIM
+/**
+ * @brief Feed the channel counters of a completed NAPI poll to net_dim.
+ *
+ * @param[in] dim: DIM state of the channel.
+ * @param[in] events: Poll counter of the channel.
+ * @param[in] packets: Packets processed on the channel so far.
+ * @param[in] bytes: Bytes processed on the channel so far.
+ */
+static inline void ether_dim_update(struct dim *dim, u16 *events,
+				    u64 packets, u64 bytes)
+{
+	struct dim_sample sample;
+
+	(*events)++;
+	dim_update_sample(*events, packets, bytes, &sample);
+	net_dim(dim, sample);
+}
+
+/**
+ * @brief Apply the Rx moderation profile selected by net_dim.
+ *
+ * Algorithm: The Rx watchdog timer is programmed by OSI at DMA init only,
+ * so the profile is applied in SW: the Rx interrupt of the channel stays
+ * masked for the profile delay after a poll that received packets. The
+ * lowest latency profile re-enables the interrupt straight away.
+ *
+ * @param[in] work: Work struct embedded in the channel DIM state.
+ */
+static void ether_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct ether_rx_napi *rx_napi = container_of(dim, struct ether_rx_napi,
+						     dim);
+	struct dim_cq_moder moder;
+	unsigned int usecs = 0;
+
+	if (dim->profile_ix != 0U) {
+		moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+		usecs = min_t(unsigned int, moder.usec,
+			      OSI_MAX_RX_COALESCE_USEC);
+	}
+
+	WRITE_ONCE(rx_napi->dim_usecs, usecs);
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * @brief Apply the Tx moderation profile selected by net_dim.
+ *
+ * Algorithm: The profile delay becomes the period of the Tx completion SW
+ * timer of the channel, within the range accepted for tx-usecs.
+ *
+ * @param[in] work: Work struct embedded in the channel DIM state.
+ */
+static void ether_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct ether_tx_napi *tx_napi = container_of(dim, struct ether_tx_napi,
+						     dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	WRITE_ONCE(tx_napi->dim_usecs,
+		   clamp_t(unsigned int, moder.usec, OSI_MIN_TX_COALESCE_USEC,
+			   OSI_MAX_TX_COALESCE_USEC));
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * @brief Rx moderation timer expiry, polls the channel again.
+ *
+ * @param[in] data: hrtimer embedded in the Rx NAPI instance.
+ */
+static enum hrtimer_restart ether_rx_dim_hrtimer(struct hrtimer *data)
+{
+	struct ether_rx_napi *rx_napi = container_of(data, struct ether_rx_napi,
+						     dim_timer);
+
+	if (likely(napi_schedule_prep(&rx_napi->napi)))
+		__napi_schedule_irqoff(&rx_napi->napi);
+
+	return HRTIMER_NORESTART;
+}
+#endif
+
 /**
  * @brief NAPI poll handler for receive.
  *
@@ -4261,6 +4403,21 @@ static int ether_napi_poll_rx(struct napi_struct *napi, int budget)
 	received = osi_process_rx_completions(osi_dma, chan, budget,
 					      &more_data_avail);
 	if (received < budget) {
+#ifdef ETHER_DIM
+		if (pdata->use_adaptive_rx == OSI_ENABLE) {
+			ether_dim_update(&rx_napi->dim, &rx_napi->events,
+					 rx_napi->packets, rx_napi->bytes);
+			/* keep Rx interrupt masked, poll again after the delay */
+			if (received > 0 && READ_ONCE(rx_napi->dim_usecs) != 0U) {
+				if (napi_complete_done(napi, received))
+					hrtimer_start(&rx_napi->dim_timer,
+						      rx_napi->dim_usecs *
+						      NSEC_PER_USEC,
+						      HRTIMER_MODE_REL);
+				return received;
+			}
+		}
+#endif
 		napi_complete(napi);
 		raw_spin_lock_irqsave(&pdata->rlock, flags);
 		osi_handle_dma_intr(osi_dma, chan,
@@ -4303,11 +4460,16 @@ static int ether_napi_poll_tx(struct napi_struct *napi, int budget)
 	    atomic_read(&tx_napi->tx_usecs_timer_armed) == OSI_DISABLE) {
 		atomic_set(&tx_napi->tx_usecs_timer_armed, OSI_ENABLE);
 		hrtimer_start(&tx_napi->tx_usecs_timer,
-			      osi_dma->tx_usecs * NSEC_PER_USEC,
+			      ether_tx_usecs(pdata, tx_napi) * NSEC_PER_USEC,
 			      HRTIMER_MODE_REL);
 	}
 
 	if (processed < budget) {
+#ifdef ETHER_DIM
+		if (pdata->use_adaptive_tx == OSI_ENABLE)
+			ether_dim_update(&tx_napi->dim, &tx_napi->events,
+					 tx_napi->packets, tx_napi->bytes);
+#endif
 		napi_complete(napi);
 		raw_spin_lock_irqsave(&pdata->rlock, flags);
 		osi_handle_dma_intr(osi_dma, chan,
@@ -4375,6 +4537,11 @@ static int ether_alloc_napi(struct ether_priv_data *pdata)
 		pdata->tx_napi[chan]->chan = chan;
 		netif_napi_add(ndev, &pdata->tx_napi[chan]->napi,
 			       ether_napi_poll_tx, 64);
+#ifdef ETHER_DIM
+		INIT_WORK(&pdata->tx_napi[chan]->dim.work, ether_tx_dim_work);
+		pdata->tx_napi[chan]->dim.mode =
+			DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+#endif
 
 		pdata->rx_napi[chan] = devm_kzalloc(dev,
 						sizeof(struct ether_rx_napi),
@@ -4388,6 +4555,15 @@ static int ether_alloc_napi(struct ether_priv_data *pdata)
 		pdata->rx_napi[chan]->chan = chan;
 		netif_napi_add(ndev, &pdata->rx_napi[chan]->napi,
 			       ether_napi_poll_rx, 64);
+#ifdef ETHER_DIM
+		INIT_WORK(&pdata->rx_napi[chan]->dim.work, ether_rx_dim_work);
+		pdata->rx_napi[chan]->dim.mode =
+			DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		hrtimer_init(&pdata->rx_napi[chan]->dim_timer,
+			     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		pdata->rx_napi[chan]->dim_timer.function =
+			ether_rx_dim_hrtimer;
+#endif
 	}
 
 	return 0;
@@ -6612,8 +6788,9 @@ static int ether_probe(struct platform_device *pdev)
 	pdata->rx_pcs_m_enabled = false;
 	atomic_set(&pdata->tx_ts_ref_cnt, -1);
 #ifdef ETHER_NVGRO
-	__skb_queue_head_init(&pdata->mq);
-	__skb_queue_head_init(&pdata->fq);
+	hash_init(pdata->nvgro_flows);
+	pdata->nvgro_nr_flows = 0;
+	spin_lock_init(&pdata->nvgro_lock);
 	pdata->pkt_age_msec = NVGRO_AGE_THRESHOLD;
 	pdata->nvgro_timer_intrvl = NVGRO_PURGE_TIMER_THRESHOLD;
 	pdata->nvgro_dropped = 0;
@@ -59,6 +59,12 @@
 #define ETHER_PAGE_POOL
 #endif
 #endif
+#if IS_ENABLED(CONFIG_DIMLIB)
+#if (KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE)
+#include <linux/dim.h>
+#define ETHER_DIM
+#endif
+#endif
 #include <osi_core.h>
 #include <osi_dma.h>
 #include <mmc.h>
@@ -71,6 +77,8 @@
 #include <net/inet_common.h>
 #include <uapi/linux/ip.h>
 #include <net/udp.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #endif /* ETHER_NVGRO */
 
 /**
@@ -236,6 +244,44 @@
 #define NVGRO_PURGE_TIMER_THRESHOLD	5000
 #define NVGRO_RX_RUNNING		OSI_BIT(0)
 #define NVGRO_PURGE_TIMER_RUNNING	OSI_BIT(1)
+/* NVGRO flow hash table size in bits */
+#define NVGRO_FLOW_HASH_BITS		6
+/* Maximum number of NVGRO flows tracked at a time */
+#define NVGRO_MAX_FLOWS			64
+/* Maximum number of out of order packets queued per flow */
+#define NVGRO_FLOW_MAX_PKTS		256
+/* Validity of a cached UDP socket lookup in msec */
+#define NVGRO_SK_CACHE_MSEC		1000
+
+/**
+ * @brief NVGRO reassembly state of an IPv4/UDP flow
+ */
+struct ether_nvgro_flow {
+	/** Node in ether_priv_data.nvgro_flows */
+	struct hlist_node node;
+	/** IPv4 source address */
+	__be32 saddr;
+	/** IPv4 destination address */
+	__be32 daddr;
+	/** UDP source port */
+	__be16 source;
+	/** UDP destination port */
+	__be16 dest;
+	/** Cached socket lookup result: destination socket has UDP GRO */
+	bool gro_enabled;
+	/** Socket lookup result is cached */
+	bool sk_cached;
+	/** Time of the cached socket lookup in jiffies */
+	unsigned long sk_lookup;
+	/** Time of the last packet of the flow in jiffies */
+	unsigned long last_used;
+	/** expected IP ID */
+	u16 expected_ip_id;
+	/** Master queue */
+	struct sk_buff_head mq;
+	/** Final queue */
+	struct sk_buff_head fq;
+};
 #endif
 
 /**
@@ -326,6 +372,18 @@ struct ether_tx_napi {
 	struct hrtimer tx_usecs_timer;
 	/** SW timer flag associated with transmit channel */
 	atomic_t tx_usecs_timer_armed;
+#ifdef ETHER_DIM
+	/** Adaptive moderation state of the transmit channel */
+	struct dim dim;
+	/** SW timer period selected by adaptive moderation in usecs */
+	unsigned int dim_usecs;
+	/** Number of NAPI polls run on the channel */
+	u16 events;
+	/** Number of packets completed on the channel */
+	u64 packets;
+	/** Number of bytes completed on the channel */
+	u64 bytes;
+#endif
 };
 
 /**
@@ -338,6 +396,20 @@ struct ether_rx_napi {
 	struct ether_priv_data *pdata;
 	/** NAPI instance associated with transmit channel */
 	struct napi_struct napi;
+#ifdef ETHER_DIM
+	/** Adaptive moderation state of the receive channel */
+	struct dim dim;
+	/** Interrupt re-enable delay selected by adaptive moderation */
+	unsigned int dim_usecs;
+	/** SW timer deferring the receive interrupt re-enable */
+	struct hrtimer dim_timer;
+	/** Number of NAPI polls run on the channel */
+	u16 events;
+	/** Number of packets received on the channel */
+	u64 packets;
+	/** Number of bytes received on the channel */
+	u64 bytes;
+#endif
 };
 
 /**
@@ -582,24 +654,26 @@ struct ether_priv_data {
 	/** PHY reset duration delay */
 	int phy_reset_duration;
 #ifdef ETHER_NVGRO
-	/** Master queue */
-	struct sk_buff_head mq;
-	/** Master queue */
-	struct sk_buff_head fq;
-	/** expected IP ID */
-	u16 expected_ip_id;
+	/** NVGRO flows hashed on IPv4/UDP source/destination */
+	DECLARE_HASHTABLE(nvgro_flows, NVGRO_FLOW_HASH_BITS);
+	/** Number of flows in nvgro_flows */
+	unsigned int nvgro_nr_flows;
+	/** Protects nvgro_flows and the flow queues */
+	spinlock_t nvgro_lock;
 	/** Timer for purginging the packets in FQ and MQ based on threshold */
 	struct timer_list nvgro_timer;
-	/** Rx processing state for NVGRO */
-	atomic_t rx_state;
-	/** Purge timer state for NVGRO */
-	atomic_t timer_state;
 	/** NVGRO packet age threshold in milseconds */
 	u32 pkt_age_msec;
 	/** NVGRO purge timer interval */
 	u32 nvgro_timer_intrvl;
 	/** NVGRO packet dropped count */
 	u64 nvgro_dropped;
+#endif
+#ifdef ETHER_DIM
+	/** Adaptive receive interrupt moderation enable/disable */
+	unsigned int use_adaptive_rx;
+	/** Adaptive transmit interrupt moderation enable/disable */
+	unsigned int use_adaptive_tx;
 #endif
 	/** Platform MDIO address */
 	unsigned int mdio_addr;
@@ -811,5 +885,6 @@ int ether_tc_setup_cbs(struct ether_priv_data *pdata,
 int ether_get_tx_ts(struct ether_priv_data *pdata);
 #ifdef ETHER_NVGRO
 void ether_nvgro_purge_timer(struct timer_list *t);
+void ether_nvgro_flush(struct ether_priv_data *pdata);
 #endif /* ETHER_NVGRO */
 #endif /* ETHER_LINUX_H */
@@ -956,7 +956,8 @@ static int ether_get_ts_info(struct net_device *ndev,
  * Algorithm: This function is invoked by kernel when user request to set
  * interrupt coalescing parameters. This driver maintains same coalescing
  * parameters for all the channels, hence same changes will be applied to
- * all the channels.
+ * all the channels. With adaptive-rx/adaptive-tx, net_dim selects the Rx
+ * interrupt delay and the Tx SW timer period per channel at runtime.
  *
  * @param[in] dev: Net device data.
  * @param[in] ec: pointer to ethtool_coalesce structure
@@ -981,7 +982,9 @@ static int ether_set_coalesce(struct net_device *dev,
 	/* Check for not supported parameters  */
 	if ((ec->rx_coalesce_usecs_irq) ||
 	    (ec->rx_max_coalesced_frames_irq) || (ec->tx_coalesce_usecs_irq) ||
+#ifndef ETHER_DIM
 	    (ec->use_adaptive_rx_coalesce) || (ec->use_adaptive_tx_coalesce) ||
+#endif
 	    (ec->pkt_rate_low) || (ec->rx_coalesce_usecs_low) ||
 	    (ec->rx_max_coalesced_frames_low) || (ec->tx_coalesce_usecs_high) ||
 	    (ec->tx_max_coalesced_frames_low) || (ec->pkt_rate_high) ||
@@ -1072,6 +1075,24 @@ static int ether_set_coalesce(struct net_device *dev,
 			   " along with rx-usecs\n");
 		return -EINVAL;
 	}
+#ifdef ETHER_DIM
+	if (osi_dma->use_tx_usecs == OSI_DISABLE &&
+	    ec->use_adaptive_tx_coalesce) {
+		netdev_err(dev, "invalid settings : tx-usecs must be enabled"
+			   " along with adaptive-tx\n");
+		return -EINVAL;
+	}
+	pdata->use_adaptive_rx = ec->use_adaptive_rx_coalesce ?
+				 OSI_ENABLE : OSI_DISABLE;
+	pdata->use_adaptive_tx = ec->use_adaptive_tx_coalesce ?
+				 OSI_ENABLE : OSI_DISABLE;
+
+	netdev_err(dev, "ADAPTIVE RX COALESCING is %s\n",
+		   pdata->use_adaptive_rx ? "ENABLED" : "DISABLED");
+
+	netdev_err(dev, "ADAPTIVE TX COALESCING is %s\n",
+		   pdata->use_adaptive_tx ? "ENABLED" : "DISABLED");
+#endif
 	netdev_err(dev, "RX COALESCING USECS is %s\n", osi_dma->use_riwt ?
 		   "ENABLED" : "DISABLED");
 
@@ -1111,6 +1132,10 @@ static int ether_get_coalesce(struct net_device *dev,
 	ec->rx_max_coalesced_frames = osi_dma->rx_frames;
 	ec->tx_coalesce_usecs = osi_dma->tx_usecs;
 	ec->tx_max_coalesced_frames = osi_dma->tx_frames;
+#ifdef ETHER_DIM
+	ec->use_adaptive_rx_coalesce = pdata->use_adaptive_rx;
+	ec->use_adaptive_tx_coalesce = pdata->use_adaptive_tx;
+#endif
 
 	return 0;
 }
@@ -1618,8 +1643,14 @@ static const struct ethtool_ops ether_ethtool_ops = {
 	.get_sset_count = ether_get_sset_count,
 	.get_coalesce = ether_get_coalesce,
 #if KERNEL_VERSION(5, 5, 0) <= LINUX_VERSION_CODE
+#ifdef ETHER_DIM
+	.supported_coalesce_params = (ETHTOOL_COALESCE_USECS |
+		ETHTOOL_COALESCE_MAX_FRAMES |
+		ETHTOOL_COALESCE_USE_ADAPTIVE),
+#else
 	.supported_coalesce_params = (ETHTOOL_COALESCE_USECS |
 		ETHTOOL_COALESCE_MAX_FRAMES),
+#endif
 #endif
 	.set_coalesce = ether_set_coalesce,
 	.get_wol = ether_get_wol,
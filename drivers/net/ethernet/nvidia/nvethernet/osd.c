@@ -387,20 +387,22 @@ static inline void ether_gro_merge_complete(struct sk_buff_head *nvgro_q,
  * @brief ether_update_fq_with_fs - Populates final queue with TTL = 1 packet
  *
  * @param[in] pdata: Ethernet driver private data
+ * @param[in] flow: NVGRO flow of the packet.
  * @param[in] skb: Socket buffer.
  */
 static inline void ether_update_fq_with_fs(struct ether_priv_data *pdata,
+					   struct ether_nvgro_flow *flow,
 					   struct sk_buff *skb)
 {
-	if (!skb_queue_empty(&pdata->fq)) {
-		pdata->nvgro_dropped += pdata->fq.qlen;
-		__skb_queue_purge(&pdata->fq);
+	if (!skb_queue_empty(&flow->fq)) {
+		pdata->nvgro_dropped += flow->fq.qlen;
+		__skb_queue_purge(&flow->fq);
 	}
 
 	/* queue skb to fq which has TTL = 1 */
-	__skb_queue_tail(&pdata->fq, skb);
+	__skb_queue_tail(&flow->fq, skb);
 
-	pdata->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
+	flow->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
 }
 
 /**
@@ -428,20 +430,21 @@ static inline struct sk_buff *ether_get_skb_from_ip_id(struct sk_buff_head *mq,
 }
 
 /**
- * @brief ether_gro - Perform NVGRO packet merging.
+ * @brief ether_gro - Complete NVGRO packet sequence from out of order queue.
  *
  * @param[in] fq: NVGRO packets sequence queue.
  * @param[in] mq: NVGRO packet out of order queue.
- * @param[in] napi: Driver NAPI instance.
+ *
+ * @retval true if fq holds a complete sequence to be merged
+ * @retval false otherwise.
  */
-static inline void ether_gro(struct sk_buff_head *fq, struct sk_buff_head *mq,
-			     struct napi_struct *napi)
+static inline bool ether_gro(struct sk_buff_head *fq, struct sk_buff_head *mq)
 {
 	struct sk_buff *f_skb, *p;
 	u32 s_ip_id;
 
 	if (skb_queue_empty(fq))
-		return;
+		return false;
 
 	f_skb = skb_peek_tail(fq);
 
@@ -451,7 +454,7 @@ static inline void ether_gro(struct sk_buff_head *fq, struct sk_buff_head *mq,
 		s_ip_id++;
 		p = ether_get_skb_from_ip_id(mq, s_ip_id);
 		if (!p)
-			return;
+			return false;
 
 		__skb_queue_tail(fq, p);
 
@@ -459,22 +462,24 @@ static inline void ether_gro(struct sk_buff_head *fq, struct sk_buff_head *mq,
 			break;
 	} while (1);
 
-	ether_gro_merge_complete(fq, napi);
+	return true;
 }
 
 /**
- * @brief ether_purge_q - Purge master queue based on packet age.
+ * @brief ether_purge_q - Purge master queue of a flow based on packet age.
  *
  * @param[in] pdata: Ethernet private data.
+ * @param[in] flow: NVGRO flow.
  */
-static inline void ether_purge_q(struct ether_priv_data *pdata)
+static inline void ether_purge_q(struct ether_priv_data *pdata,
+				 struct ether_nvgro_flow *flow)
 {
 	struct sk_buff *p, *pp;
 
-	skb_queue_walk_safe(&pdata->mq, p, pp) {
+	skb_queue_walk_safe(&flow->mq, p, pp) {
 		if ((jiffies - NAPI_GRO_CB(p)->age) >
 		    msecs_to_jiffies(pdata->pkt_age_msec)) {
-			__skb_unlink(p, &pdata->mq);
+			__skb_unlink(p, &flow->mq);
 			dev_consume_skb_any(p);
 			pdata->nvgro_dropped++;
 		} else {
@@ -483,35 +488,140 @@ static inline void ether_purge_q(struct ether_priv_data *pdata)
 	}
 }
 
+/**
+ * @brief ether_nvgro_flow_free - Drop the queued packets and free a flow.
+ *
+ * @param[in] pdata: Ethernet private data.
+ * @param[in] flow: NVGRO flow.
+ *
+ * @note nvgro_lock must be held.
+ */
+static void ether_nvgro_flow_free(struct ether_priv_data *pdata,
+				  struct ether_nvgro_flow *flow)
+{
+	pdata->nvgro_dropped += flow->mq.qlen + flow->fq.qlen;
+	__skb_queue_purge(&flow->mq);
+	__skb_queue_purge(&flow->fq);
+	hash_del(&flow->node);
+	pdata->nvgro_nr_flows--;
+	kfree(flow);
+}
+
+/**
+ * @brief ether_nvgro_flow_get - Find or create the NVGRO flow of a packet.
+ *
+ * Algorithm: Flows are hashed on the IPv4/UDP source and destination. When
+ * NVGRO_MAX_FLOWS flows are tracked already, the least recently used one is
+ * evicted to make room for the new flow.
+ *
+ * @param[in] pdata: Ethernet private data.
+ * @param[in] iph: IPv4 header of the packet.
+ * @param[in] uh: UDP header of the packet.
+ *
+ * @note nvgro_lock must be held.
+ *
+ * @retval flow on Success
+ * @retval NULL on failure.
+ */
+static struct ether_nvgro_flow *
+ether_nvgro_flow_get(struct ether_priv_data *pdata, const struct iphdr *iph,
+		     const struct udphdr *uh)
+{
+	struct ether_nvgro_flow *flow, *lru = NULL;
+	u32 key;
+	int bkt;
+
+	key = jhash_3words((__force u32)iph->saddr, (__force u32)iph->daddr,
+			   ((__force u32)uh->source << 16) |
+			   (__force u32)uh->dest, 0);
+
+	hash_for_each_possible(pdata->nvgro_flows, flow, node, key) {
+		if (flow->saddr == iph->saddr && flow->daddr == iph->daddr &&
+		    flow->source == uh->source && flow->dest == uh->dest)
+			return flow;
+	}
+
+	if (pdata->nvgro_nr_flows >= NVGRO_MAX_FLOWS) {
+		hash_for_each(pdata->nvgro_flows, bkt, flow, node) {
+			if (!lru || time_before(flow->last_used, lru->last_used))
+				lru = flow;
+		}
+		ether_nvgro_flow_free(pdata, lru);
+	}
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return NULL;
+
+	flow->saddr = iph->saddr;
+	flow->daddr = iph->daddr;
+	flow->source = uh->source;
+	flow->dest = uh->dest;
+	__skb_queue_head_init(&flow->mq);
+	__skb_queue_head_init(&flow->fq);
+	hash_add(pdata->nvgro_flows, &flow->node, key);
+	pdata->nvgro_nr_flows++;
+
+	return flow;
+}
+
+/**
+ * @brief ether_nvgro_flush - Drop all NVGRO flows.
+ *
+ * @param[in] pdata: Ethernet private data.
+ *
+ * @note Rx NAPI and NVGRO purge timer must be stopped.
+ */
+void ether_nvgro_flush(struct ether_priv_data *pdata)
+{
+	struct ether_nvgro_flow *flow;
+	struct hlist_node *tmp;
+	int bkt;
+
+	spin_lock_bh(&pdata->nvgro_lock);
+	hash_for_each_safe(pdata->nvgro_flows, bkt, tmp, flow, node)
+		ether_nvgro_flow_free(pdata, flow);
+	spin_unlock_bh(&pdata->nvgro_lock);
+}
+
 /**
  * @brief ether_nvgro_purge_timer - NVGRO purge timer handler.
  *
+ * Algorithm: Purges the aged packets of every flow and frees the flows which
+ * did not receive any packet for a purge interval.
+ *
  * @param[in] t: Pointer to the timer.
  */
 void ether_nvgro_purge_timer(struct timer_list *t)
 {
 	struct ether_priv_data *pdata = from_timer(pdata, t, nvgro_timer);
+	unsigned long idle = msecs_to_jiffies(max(pdata->nvgro_timer_intrvl,
+						  pdata->pkt_age_msec));
+	struct ether_nvgro_flow *flow;
+	struct hlist_node *tmp;
 	struct sk_buff *f_skb;
+	int bkt;
 
-	if (atomic_read(&pdata->rx_state) == OSI_ENABLE)
-		return;
-
-	atomic_set(&pdata->timer_state, OSI_ENABLE);
+	spin_lock(&pdata->nvgro_lock);
+	hash_for_each_safe(pdata->nvgro_flows, bkt, tmp, flow, node) {
+		if (time_after(jiffies, flow->last_used + idle)) {
+			ether_nvgro_flow_free(pdata, flow);
+			continue;
+		}
 
-	ether_purge_q(pdata);
+		ether_purge_q(pdata, flow);
 
-	f_skb = skb_peek(&pdata->fq);
-	if (!f_skb)
-		goto exit;
+		f_skb = skb_peek(&flow->fq);
+		if (!f_skb)
+			continue;
 
-	if ((jiffies - NAPI_GRO_CB(f_skb)->age) >
-	    msecs_to_jiffies(pdata->pkt_age_msec)) {
-		pdata->nvgro_dropped += pdata->fq.qlen;
-		__skb_queue_purge(&pdata->fq);
+		if ((jiffies - NAPI_GRO_CB(f_skb)->age) >
+		    msecs_to_jiffies(pdata->pkt_age_msec)) {
+			pdata->nvgro_dropped += flow->fq.qlen;
+			__skb_queue_purge(&flow->fq);
+		}
 	}
-
-exit:
-	atomic_set(&pdata->timer_state, OSI_DISABLE);
+	spin_unlock(&pdata->nvgro_lock);
 
 	mod_timer(&pdata->nvgro_timer,
 		  jiffies + msecs_to_jiffies(pdata->nvgro_timer_intrvl));
@@ -520,6 +630,10 @@ exit:
 /**
  * @brief ether_do_nvgro - Perform NVGRO processing.
  *
+ * Algorithm: Packets are reassembled on the queues of their flow. The UDP
+ * socket lookup result is cached in the flow for NVGRO_SK_CACHE_MSEC, and a
+ * completed sequence is handed to GRO outside of nvgro_lock.
+ *
  * @param[in] pdata: Ethernet private data.
  * @param[in] napi: Ethernet driver NAPI instance.
  * @param[in] skb: socket buffer
@@ -533,9 +647,11 @@ static bool ether_do_nvgro(struct ether_priv_data *pdata,
 {
 	struct udphdr *uh = (struct udphdr *)(skb->data + sizeof(struct iphdr));
 	struct iphdr *iph = (struct iphdr *)skb->data;
-	struct sk_buff_head *mq = &pdata->mq;
 	struct ethhdr *ethh = eth_hdr(skb);
+	struct ether_nvgro_flow *flow;
+	struct sk_buff_head done;
 	struct sock *sk = NULL;
+	bool complete = false;
 
 	if (ethh->h_proto != htons(ETH_P_IP))
 		return false;
@@ -543,56 +659,81 @@ static bool ether_do_nvgro(struct ether_priv_data *pdata,
 	if (iph->protocol != IPPROTO_UDP)
 		return false;
 
-	/* TODO: Hash based based queues selection */
-	/* Socket look up with IPv4/UDP source/destination */
-	sk = __udp4_lib_lookup(dev_net(skb->dev), iph->saddr, uh->source,
-			       iph->daddr, uh->dest, inet_iif(skb),
-			       inet_sdif(skb), &udp_table, NULL);
-	if (!sk)
+	spin_lock(&pdata->nvgro_lock);
+
+	flow = ether_nvgro_flow_get(pdata, iph, uh);
+	if (!flow) {
+		spin_unlock(&pdata->nvgro_lock);
 		return false;
+	}
+
+	flow->last_used = jiffies;
+
+	/* Socket look up with IPv4/UDP source/destination */
+	if (!flow->sk_cached ||
+	    time_after(jiffies, flow->sk_lookup +
+		       msecs_to_jiffies(NVGRO_SK_CACHE_MSEC))) {
+		sk = __udp4_lib_lookup(dev_net(skb->dev), iph->saddr,
+				       uh->source, iph->daddr, uh->dest,
+				       inet_iif(skb), inet_sdif(skb),
+				       &udp_table, NULL);
+		/* Socket not found or GRO not enabled on it - We don't care */
+		flow->gro_enabled = sk && udp_sk(sk)->gro_enabled;
+		flow->sk_lookup = jiffies;
+		flow->sk_cached = true;
+	}
 
-	/* Socket found but GRO not enabled on the socket - We don't care */
-	if (!udp_sk(sk)->gro_enabled)
+	if (!flow->gro_enabled) {
+		spin_unlock(&pdata->nvgro_lock);
 		return false;
+	}
 
 	/* Store IPID, TTL and age of skb inside per skb control block */
 	NAPI_GRO_CB(skb)->flush_id = ntohs(iph->id);
 	NAPI_GRO_CB(skb)->free = (iph->ttl & (BIT(6) | BIT(7))) >> 6;
 	NAPI_GRO_CB(skb)->age = jiffies;
 
-	while (atomic_read(&pdata->timer_state) == OSI_ENABLE) {
-		/* busyloop */
-	};
-
-	atomic_set(&pdata->rx_state, OSI_ENABLE);
-
 	if (NAPI_GRO_CB(skb)->free == 1) {
 		/* Update final queue with first segment */
-		ether_update_fq_with_fs(pdata, skb);
+		ether_update_fq_with_fs(pdata, flow, skb);
 		goto exit;
 	} else {
-		if (pdata->expected_ip_id == NAPI_GRO_CB(skb)->flush_id) {
-			__skb_queue_tail(&pdata->fq, skb);
-			pdata->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
+		if (flow->expected_ip_id == NAPI_GRO_CB(skb)->flush_id) {
+			__skb_queue_tail(&flow->fq, skb);
+			flow->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
 
 			if (NAPI_GRO_CB(skb)->free == 2)
-				ether_gro_merge_complete(&pdata->fq, napi);
+				complete = true;
 
 			goto exit;
 		}
 	}
 
+	/* Bound the out of order packets held by the flow */
+	if (skb_queue_len(&flow->mq) >= NVGRO_FLOW_MAX_PKTS) {
+		pdata->nvgro_dropped += flow->mq.qlen;
+		__skb_queue_purge(&flow->mq);
+	}
+
 	/* Add skb to the queue */
-	__skb_queue_tail(mq, skb);
+	__skb_queue_tail(&flow->mq, skb);
 
 	/* Queue the packets until last segment received */
 	if (NAPI_GRO_CB(skb)->free != 2)
 		goto exit;
 
-	ether_gro(&pdata->fq, &pdata->mq, napi);
+	complete = ether_gro(&flow->fq, &flow->mq);
 
 exit:
-	atomic_set(&pdata->rx_state, OSI_DISABLE);
+	if (complete) {
+		__skb_queue_head_init(&done);
+		skb_queue_splice_init(&flow->fq, &done);
+	}
+	spin_unlock(&pdata->nvgro_lock);
+
+	if (complete)
+		ether_gro_merge_complete(&done, napi);
+
 	return true;
 }
 #endif
@@ -694,6 +835,10 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 		skb->dev = ndev;
 		skb->protocol = eth_type_trans(skb, ndev);
 		ndev->stats.rx_bytes += skb->len;
+#ifdef ETHER_DIM
+		rx_napi->packets++;
+		rx_napi->bytes += skb->len;
+#endif
 #ifdef ETHER_NVGRO
 		if ((ndev->features & NETIF_F_GRO) &&
 		    ether_do_nvgro(pdata, &rx_napi->napi, skb))
@@ -796,6 +941,10 @@ static void osd_transmit_complete(void *priv, const struct osi_tx_swcx *swcx,
 		}
 
 		ndev->stats.tx_packets++;
+#ifdef ETHER_DIM
+		pdata->tx_napi[chan]->packets++;
+		pdata->tx_napi[chan]->bytes += skb->len;
+#endif
 		if ((txdone_pkt_cx->flags & OSI_TXDONE_CX_TS_DELAYED) ==
 		    OSI_TXDONE_CX_TS_DELAYED) {
 			add_skb_node(pdata, skb, txdone_pkt_cx->pktid);
@@ -2550,8 +2550,8 @@ static ssize_t ether_nvgro_stats_show(struct device *dev,
 	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
 	struct ether_priv_data *pdata = netdev_priv(ndev);
 
-	return scnprintf(buf, PAGE_SIZE, "dropped = %llu\n",
-			 pdata->nvgro_dropped);
+	return scnprintf(buf, PAGE_SIZE, "dropped = %llu\nflows = %u\n",
+			 pdata->nvgro_dropped, pdata->nvgro_nr_flows);
 }
 
 /**
@@ -2574,22 +2574,36 @@ static ssize_t ether_nvgro_dump_show(struct device *dev,
 {
 	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
 	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct ether_nvgro_flow *flow;
 	struct sk_buff *p, *pp;
 	char *start = buf;
+	int bkt;
+
+	spin_lock_bh(&pdata->nvgro_lock);
+	hash_for_each(pdata->nvgro_flows, bkt, flow, node) {
+		buf += scnprintf(buf, PAGE_SIZE - (buf - start),
+				 "Flow %pI4:%u -> %pI4:%u GRO %d\n",
+				 &flow->saddr, ntohs(flow->source),
+				 &flow->daddr, ntohs(flow->dest),
+				 flow->gro_enabled);
+
+		buf += scnprintf(buf, PAGE_SIZE - (buf - start), "MQ: ");
+		skb_queue_walk_safe(&flow->mq, p, pp) {
+			buf += scnprintf(buf, PAGE_SIZE - (buf - start),
+					 "skb %p TTL %d IPID %u\n",
+					 p, NAPI_GRO_CB(p)->free,
+					 NAPI_GRO_CB(p)->flush_id);
+		}
 
-	buf += scnprintf(buf, PAGE_SIZE, "MQ: ");
-	skb_queue_walk_safe(&pdata->mq, p, pp) {
-		buf += scnprintf(buf, PAGE_SIZE, "skb %p TTL %d IPID %u\n",
-				 p, NAPI_GRO_CB(p)->free,
-				 NAPI_GRO_CB(p)->flush_id);
-	}
-
-	buf += scnprintf(buf, PAGE_SIZE, "FQ: ");
-	skb_queue_walk_safe(&pdata->fq, p, pp) {
-		buf += scnprintf(buf, PAGE_SIZE, "skb %p TTL %d IPID %u\n",
-				 p, NAPI_GRO_CB(p)->free,
-				 NAPI_GRO_CB(p)->flush_id);
+		buf += scnprintf(buf, PAGE_SIZE - (buf - start), "FQ: ");
+		skb_queue_walk_safe(&flow->fq, p, pp) {
+			buf += scnprintf(buf, PAGE_SIZE - (buf - start),
+					 "skb %p TTL %d IPID %u\n",
+					 p, NAPI_GRO_CB(p)->free,
+					 NAPI_GRO_CB(p)->flush_id);
+		}
 	}
+	spin_unlock_bh(&pdata->nvgro_lock);
 
 	return (buf - start);
 }
@@ -17,6 +17,19 @@
 #include <linux/netdevice.h>
 #include <linux/pci.h>
 #include <linux/tegra_vnet.h>
+#include <linux/version.h>
+
+/*
+ * EP2H empty buffers are owned by the host until their EP2H full message is
+ * processed, so they can sit in both the EP2H empty and EP2H full rings.
+ */
+#define TVNET_RX_BUF_COUNT	(2 * RING_COUNT)
+
+struct tvnet_rx_buf {
+	struct sk_buff *skb;
+	dma_addr_t iova;
+	int len;
+};
 
 struct tvnet_priv {
 	struct net_device *ndev;
@@ -28,9 +41,17 @@ struct tvnet_priv {
 	struct bar_md *bar_md;
 	struct ep_ring_buf ep_mem;
 	struct host_ring_buf host_mem;
-	struct list_head ep2h_empty_list;
-	/* To protect ep2h empty list */
+	/* EP2H empty buffers, indexed by the order they are queued in */
+	struct tvnet_rx_buf rx_bufs[TVNET_RX_BUF_COUNT];
+	u32 rx_buf_wr;
+	u32 rx_buf_rd;
+	/* Slots past rx_buf_rd that were completed out of order */
+	u32 rx_buf_ooo;
+	/* To protect ep2h empty buffers producer */
 	spinlock_t ep2h_empty_lock;
+	/* EP doorbells deferred by xmit_more */
+	bool tx_ctrl_db;
+	bool tx_data_db;
 	struct tvnet_dma_desc *dma_desc;
 #if ENABLE_DMA
 	struct dma_desc_cnt desc_cnt;
@@ -155,16 +176,23 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 	struct net_device *ndev = tvnet->ndev;
 	struct host_ring_buf *host_mem = &tvnet->host_mem;
 	struct data_msg *ep2h_empty_msg = host_mem->ep2h_empty_msgs;
-	struct ep2h_empty_list *ep2h_empty_ptr;
 	struct device *d = &tvnet->pdev->dev;
+	struct tvnet_rx_buf *rx_buf;
 	unsigned long flags;
+	bool queued = false;
 
+	spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
 	while (!tvnet_ivc_full(&tvnet->ep2h_empty)) {
 		struct sk_buff *skb;
 		dma_addr_t iova;
 		int len = ndev->mtu + ETH_HLEN;
 		u32 idx;
 
+		rx_buf = &tvnet->rx_bufs[tvnet->rx_buf_wr % TVNET_RX_BUF_COUNT];
+		/* Slot still holds a packet not yet processed by NAPI */
+		if (smp_load_acquire(&rx_buf->skb))
+			break;
+
 		skb = netdev_alloc_skb(ndev, len);
 		if (!skb) {
 			pr_err("%s: alloc skb failed\n", __func__);
@@ -177,18 +205,10 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 			break;
 		}
 
-		ep2h_empty_ptr = kmalloc(sizeof(*ep2h_empty_ptr), GFP_ATOMIC);
-		if (!ep2h_empty_ptr) {
-			dma_unmap_single(d, iova, len, DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			break;
-		}
-		ep2h_empty_ptr->skb = skb;
-		ep2h_empty_ptr->iova = iova;
-		ep2h_empty_ptr->len = len;
-		spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-		list_add_tail(&ep2h_empty_ptr->list, &tvnet->ep2h_empty_list);
-		spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
+		rx_buf->iova = iova;
+		rx_buf->len = len;
+		rx_buf->skb = skb;
+		tvnet->rx_buf_wr++;
 
 		idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_empty) %
 					RING_COUNT;
@@ -199,26 +219,35 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 		 */
 		mb();
 		tvnet_ivc_advance_wr(&tvnet->ep2h_empty);
+		queued = true;
+	}
+	spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
 
+	/* One doorbell for all the buffers queued */
+	if (queued)
 		tvnet_host_raise_ep_ctrl_irq(tvnet);
-	}
 }
 
 static void tvnet_host_free_empty_buffers(struct tvnet_priv *tvnet)
 {
-	struct ep2h_empty_list *ep2h_empty_ptr, *temp;
 	struct device *d = &tvnet->pdev->dev;
+	struct tvnet_rx_buf *rx_buf;
 	unsigned long flags;
+	int i;
 
 	spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-	list_for_each_entry_safe(ep2h_empty_ptr, temp, &tvnet->ep2h_empty_list,
-				 list) {
-		list_del(&ep2h_empty_ptr->list);
-		dma_unmap_single(d, ep2h_empty_ptr->iova, ep2h_empty_ptr->len,
+	for (i = 0; i < TVNET_RX_BUF_COUNT; i++) {
+		rx_buf = &tvnet->rx_bufs[i];
+		if (!rx_buf->skb)
+			continue;
+		dma_unmap_single(d, rx_buf->iova, rx_buf->len,
 				 DMA_FROM_DEVICE);
-		dev_kfree_skb_any(ep2h_empty_ptr->skb);
-		kfree(ep2h_empty_ptr);
+		dev_kfree_skb_any(rx_buf->skb);
+		rx_buf->skb = NULL;
 	}
+	tvnet->rx_buf_wr = 0;
+	tvnet->rx_buf_rd = 0;
+	tvnet->rx_buf_ooo = 0;
 	spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
 }
 
@@ -395,36 +424,104 @@ static int tvnet_host_change_mtu(struct net_device *ndev, int new_mtu)
 	return 0;
 }
 
+static inline bool tvnet_host_xmit_more(struct sk_buff *skb)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0))
+	return netdev_xmit_more();
+#else
+	return skb->xmit_more;
+#endif
+}
+
+/* Raise the EP irqs deferred while the stack has more packets queued */
+static void tvnet_host_flush_tx_db(struct tvnet_priv *tvnet)
+{
+	if (tvnet->tx_ctrl_db) {
+		tvnet->tx_ctrl_db = false;
+		tvnet_host_raise_ep_ctrl_irq(tvnet);
+	}
+
+	if (tvnet->tx_data_db) {
+		tvnet->tx_data_db = false;
+		tvnet_host_raise_ep_data_irq(tvnet);
+	}
+}
+
+#if ENABLE_DMA
+static void tvnet_host_unmap_skb(struct device *d, dma_addr_t *iova,
+				 u32 *len, int count)
+{
+	int i;
+
+	/* Linear part is mapped with dma_map_single, frags as pages */
+	for (i = 0; i < count; i++) {
+		if (i == 0)
+			dma_unmap_single(d, iova[i], len[i], DMA_TO_DEVICE);
+		else
+			dma_unmap_page(d, iova[i], len[i], DMA_TO_DEVICE);
+	}
+}
+
+/* Map linear part and frags of skb, returns number of segments mapped */
+static int tvnet_host_map_skb(struct device *d, struct sk_buff *skb,
+			      dma_addr_t *iova, u32 *len)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+	int i;
+
+	len[0] = skb_headlen(skb);
+	iova[0] = dma_map_single(d, skb->data, len[0], DMA_TO_DEVICE);
+	if (dma_mapping_error(d, iova[0]))
+		return -ENOMEM;
+
+	for (i = 0; i < info->nr_frags; i++) {
+		skb_frag_t *frag = &info->frags[i];
+
+		len[i + 1] = skb_frag_size(frag);
+		iova[i + 1] = skb_frag_dma_map(d, frag, 0, len[i + 1],
+					       DMA_TO_DEVICE);
+		if (dma_mapping_error(d, iova[i + 1])) {
+			tvnet_host_unmap_skb(d, iova, len, i + 1);
+			return -ENOMEM;
+		}
+	}
+
+	return info->nr_frags + 1;
+}
+#endif
+
 static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 					 struct net_device *ndev)
 {
 	struct tvnet_priv *tvnet = netdev_priv(ndev);
 	struct host_ring_buf *host_mem = &tvnet->host_mem;
 	struct data_msg *h2ep_full_msg = host_mem->h2ep_full_msgs;
-	struct skb_shared_info *info = skb_shinfo(skb);
 	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
 	struct data_msg *h2ep_empty_msg = ep_mem->h2ep_empty_msgs;
-	struct device *d = &tvnet->pdev->dev;
+	bool xmit_more = tvnet_host_xmit_more(skb);
 #if ENABLE_DMA
+	struct skb_shared_info *info = skb_shinfo(skb);
+	struct device *d = &tvnet->pdev->dev;
 	struct tvnet_dma_desc *dma_desc = tvnet->dma_desc;
 	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
-	u32 desc_widx, desc_ridx, val;
-	u32 ctrl_d;
+	dma_addr_t src_iova[MAX_SKB_FRAGS + 1];
+	u32 src_len[MAX_SKB_FRAGS + 1];
+	u32 desc_widx = 0, desc_ridx, val;
+	u32 ctrl_d, dst_off;
 	unsigned long timeout;
+	int nr_src, i;
+#else
+	void *dst_virt;
 #endif
-	dma_addr_t src_iova;
 	dma_addr_t dst_iova;
 	u32 rd_idx;
 	u32 wr_idx;
-	void *dst_virt;
 	int len;
 
-	/* TODO Not expecting skb frags, remove this after testing */
-	WARN_ON(info->nr_frags);
-
 	/* Check if H2EP_EMPTY_BUF available to read */
 	if (!tvnet_ivc_rd_available(&tvnet->h2ep_empty)) {
-		tvnet_host_raise_ep_ctrl_irq(tvnet);
+		tvnet->tx_ctrl_db = true;
+		tvnet_host_flush_tx_db(tvnet);
 		pr_debug("%s: No H2EP empty msg, stop tx\n", __func__);
 		netif_stop_queue(ndev);
 		return NETDEV_TX_BUSY;
@@ -432,57 +529,72 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 
 	/* Check if H2EP_FULL_BUF available to write */
 	if (tvnet_ivc_full(&tvnet->h2ep_full)) {
-		tvnet_host_raise_ep_ctrl_irq(tvnet);
+		tvnet->tx_ctrl_db = true;
+		tvnet_host_flush_tx_db(tvnet);
 		pr_debug("%s: No H2EP full buf, stop tx\n", __func__);
 		netif_stop_queue(ndev);
 		return NETDEV_TX_BUSY;
 	}
 
 #if ENABLE_DMA
-	/* Check if dma desc available */
-	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) >= DMA_DESC_COUNT) {
+	/* Check if dma desc available, one per linear part and frag */
+	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt + info->nr_frags + 1) >
+	    DMA_DESC_COUNT) {
+		tvnet_host_flush_tx_db(tvnet);
 		pr_debug("%s: dma descriptors are not available\n", __func__);
 		netif_stop_queue(ndev);
 		return NETDEV_TX_BUSY;
 	}
-#endif
 
-	len = skb_headlen(skb);
-
-	src_iova = dma_map_single(d, skb->data, len, DMA_TO_DEVICE);
-	if (dma_mapping_error(d, src_iova)) {
-		pr_err("%s: dma_map_single failed\n", __func__);
+	nr_src = tvnet_host_map_skb(d, skb, src_iova, src_len);
+	if (nr_src < 0) {
+		pr_err("%s: dma map of skb failed\n", __func__);
 		dev_kfree_skb_any(skb);
+		if (!xmit_more)
+			tvnet_host_flush_tx_db(tvnet);
 		return NETDEV_TX_OK;
 	}
+#endif
+
+	len = skb->len;
 
 	/* Get H2EP empty msg */
 	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->h2ep_empty) %
 				RING_COUNT;
 	dst_iova = h2ep_empty_msg[rd_idx].u.empty_buffer.pcie_address;
-	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
 	/* Advance read count after all failure cases complated, to avoid
 	 * dangling buffer at endpoint.
 	 */
 	tvnet_ivc_advance_rd(&tvnet->h2ep_empty);
-	/* Raise an interrupt to let EP populate H2EP_EMPTY_BUF ring */
-	tvnet_host_raise_ep_ctrl_irq(tvnet);
+	/* Let EP populate H2EP_EMPTY_BUF ring, irq is raised on flush */
+	tvnet->tx_ctrl_db = true;
 
 #if ENABLE_DMA
-	/* Trigger DMA write from src_iova to dst_iova */
-	desc_widx = desc_cnt->wr_cnt % DMA_DESC_COUNT;
-	dma_desc[desc_widx].size = len;
-	dma_desc[desc_widx].sar_low = lower_32_bits(src_iova);
-	dma_desc[desc_widx].sar_high = upper_32_bits(src_iova);
-	dma_desc[desc_widx].dar_low = lower_32_bits(dst_iova);
-	dma_desc[desc_widx].dar_high = upper_32_bits(dst_iova);
+	/* Trigger DMA write of all the segments to consecutive dst_iova */
+	dst_off = 0;
+	for (i = 0; i < nr_src; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		dma_desc[desc_widx].size = src_len[i];
+		dma_desc[desc_widx].sar_low = lower_32_bits(src_iova[i]);
+		dma_desc[desc_widx].sar_high = upper_32_bits(src_iova[i]);
+		dma_desc[desc_widx].dar_low = lower_32_bits(dst_iova + dst_off);
+		dma_desc[desc_widx].dar_high =
+					upper_32_bits(dst_iova + dst_off);
+		dst_off += src_len[i];
+	}
 	/* CB bit should be set at the end */
 	mb();
-	/* RIE is not required for polling mode */
-	ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_RIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_CB;
-	dma_desc[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	for (i = 0; i < nr_src; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_CB;
+		/* Interrupt only on completion of the last segment */
+		if (i == nr_src - 1) {
+			/* RIE is not required for polling mode */
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_RIE;
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
+		}
+		dma_desc[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	}
 	/*
 	 * Read after write to avoid EP DMA reading LLE before CB is written to
 	 * EP's system memory.
@@ -495,7 +607,7 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	timeout = jiffies + msecs_to_jiffies(1000);
 	dma_common_wr(tvnet->dma_base, DMA_RD_DATA_CH, DMA_READ_DOORBELL_OFF);
 
-	desc_cnt->wr_cnt++;
+	desc_cnt->wr_cnt += nr_src;
 
 	while (true) {
 		val = dma_common_rd(tvnet->dma_base, DMA_READ_INT_STATUS_OFF);
@@ -513,21 +625,25 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 			dma_common_wr(tvnet->dma_base,
 				      DMA_READ_ENGINE_EN_OFF_ENABLE,
 				      DMA_READ_ENGINE_EN_OFF);
-			desc_cnt->wr_cnt--;
-			dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
+			desc_cnt->wr_cnt -= nr_src;
+			tvnet_host_unmap_skb(d, src_iova, src_len, nr_src);
+			tvnet_host_flush_tx_db(tvnet);
 			return NETDEV_TX_BUSY;
 		}
 	}
 
-	desc_ridx = tvnet->desc_cnt.rd_cnt % DMA_DESC_COUNT;
 	/* Clear DMA cycle bit and increment rd_cnt */
-	dma_desc[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	for (i = 0; i < nr_src; i++) {
+		desc_ridx = (tvnet->desc_cnt.rd_cnt + i) % DMA_DESC_COUNT;
+		dma_desc[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	}
 	mb();
 
-	tvnet->desc_cnt.rd_cnt++;
+	tvnet->desc_cnt.rd_cnt += nr_src;
 #else
-	/* Copy skb->data to endpoint dst address, use CPU virt addr */
-	memcpy(dst_virt, skb->data, len);
+	/* Copy skb data and frags to endpoint dst address, use CPU virt addr */
+	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
+	skb_copy_bits(skb, 0, dst_virt, len);
 	/* BAR0 mmio address is wc mem, add mb to make sure that complete
 	 * skb->data is written before updating counters.
 	 */
@@ -545,10 +661,16 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	 */
 	mb();
 	tvnet_ivc_advance_wr(&tvnet->h2ep_full);
-	tvnet_host_raise_ep_data_irq(tvnet);
+	tvnet->tx_data_db = true;
+
+	/* Ring the doorbells once for a batch of packets from the stack */
+	if (!xmit_more)
+		tvnet_host_flush_tx_db(tvnet);
 
 	/* Free skb */
-	dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
+#if ENABLE_DMA
+	tvnet_host_unmap_skb(d, src_iova, src_len, nr_src);
+#endif
 	dev_kfree_skb_any(skb);
 
 	return NETDEV_TX_OK;
@@ -618,22 +740,39 @@ static void tvnet_host_process_ctrl_msg(struct tvnet_priv *tvnet)
 	}
 }
 
+/* Fallback for an EP2H full message which is not the next expected one */
+static struct tvnet_rx_buf *tvnet_host_find_rx_buf(struct tvnet_priv *tvnet,
+						   u64 pcie_address)
+{
+	struct tvnet_rx_buf *rx_buf;
+	int i;
+
+	for (i = 0; i < TVNET_RX_BUF_COUNT; i++) {
+		rx_buf = &tvnet->rx_bufs[i];
+		if (rx_buf->skb && rx_buf->iova == pcie_address)
+			return rx_buf;
+	}
+
+	return NULL;
+}
+
 static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 {
 	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
 	struct data_msg *data_msg = ep_mem->ep2h_full_msgs;
 	struct device *d = &tvnet->pdev->dev;
-	struct ep2h_empty_list *ep2h_empty_ptr;
 	struct net_device *ndev = tvnet->ndev;
+	struct tvnet_rx_buf *rx_buf;
 	int count = 0;
 
 	while ((count < TVNET_NAPI_WEIGHT) &&
 	       tvnet_ivc_rd_available(&tvnet->ep2h_full)) {
 		struct sk_buff *skb;
 		u64 pcie_address;
+		dma_addr_t iova;
+		int buf_len;
 		u32 len;
-		int idx, found = 0;
-		unsigned long flags;
+		int idx;
 
 		/* Read EP2H full msg */
 		idx = tvnet_ivc_get_rd_cnt(&tvnet->ep2h_full) %
@@ -641,36 +780,50 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 		len = data_msg[idx].u.full_buffer.packet_size;
 		pcie_address = data_msg[idx].u.full_buffer.pcie_address;
 
-		spin_lock_irqsave(&tvnet->ep2h_empty_lock, flags);
-		list_for_each_entry(ep2h_empty_ptr, &tvnet->ep2h_empty_list,
-				    list) {
-			if (ep2h_empty_ptr->iova == pcie_address) {
-				found = 1;
-				break;
-			}
+		/* Step over the slots already completed out of order */
+		while (unlikely(tvnet->rx_buf_ooo) &&
+		       !tvnet->rx_bufs[tvnet->rx_buf_rd %
+				       TVNET_RX_BUF_COUNT].skb) {
+			tvnet->rx_buf_rd++;
+			tvnet->rx_buf_ooo--;
+		}
+
+		/* EP returns the empty buffers in the order they were queued */
+		rx_buf = &tvnet->rx_bufs[tvnet->rx_buf_rd % TVNET_RX_BUF_COUNT];
+		if (likely(rx_buf->skb && rx_buf->iova == pcie_address)) {
+			tvnet->rx_buf_rd++;
+		} else {
+			rx_buf = tvnet_host_find_rx_buf(tvnet, pcie_address);
+			/* Out of order completion is not expected from EP */
+			if (WARN_ON_ONCE(rx_buf))
+				tvnet->rx_buf_ooo++;
 		}
-		WARN_ON(!found);
-		list_del(&ep2h_empty_ptr->list);
-		spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
 
-		/* Advance H2EP full buffer after search in local list */
+		/* Advance EP2H full buffer after lookup of the local buffer */
 		tvnet_ivc_advance_rd(&tvnet->ep2h_full);
-		/* If EP2H network queue is stopped due to lack of EP2H_FULL
-		 * queue, raising ctrl irq will help.
-		 */
-		tvnet_host_raise_ep_ctrl_irq(tvnet);
+		count++;
+
+		if (WARN_ON(!rx_buf))
+			continue;
+
+		skb = rx_buf->skb;
+		iova = rx_buf->iova;
+		buf_len = rx_buf->len;
+		/* Hand the slot back to the producer */
+		smp_store_release(&rx_buf->skb, NULL);
 
-		dma_unmap_single(d, pcie_address, ndev->mtu + ETH_HLEN, DMA_FROM_DEVICE);
-		skb = ep2h_empty_ptr->skb;
+		dma_unmap_single(d, iova, buf_len, DMA_FROM_DEVICE);
 		skb_put(skb, len);
 		skb->protocol = eth_type_trans(skb, ndev);
 		napi_gro_receive(&tvnet->napi, skb);
-
-		/* Free EP2H empty list element */
-		kfree(ep2h_empty_ptr);
-		count++;
 	}
 
+	/* If EP2H network queue is stopped due to lack of EP2H_FULL
+	 * queue, raising ctrl irq will help.
+	 */
+	if (count)
+		tvnet_host_raise_ep_ctrl_irq(tvnet);
+
 	return count;
 }
 
@@ -744,6 +897,9 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 	eth_hw_addr_random(ndev);
 	SET_NETDEV_DEV(ndev, &pdev->dev);
 	ndev->netdev_ops = &tvnet_host_netdev_ops;
+	/* Frags are DMA'ed, or copied, back to back into the EP buffer */
+	ndev->hw_features |= NETIF_F_SG;
+	ndev->features |= NETIF_F_SG;
 	tvnet = netdev_priv(ndev);
 	tvnet->ndev = ndev;
 	tvnet->pdev = pdev;
@@ -843,7 +999,6 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 	tvnet_host_write_dma_msix_settings(tvnet);
 #endif
 
-	INIT_LIST_HEAD(&tvnet->ep2h_empty_list);
 	spin_lock_init(&tvnet->ep2h_empty_lock);
 
 	return 0;
@@ -19,6 +19,7 @@
 #define DCE_IPC_HANDLES_MAX 6U
 #define DCE_CLIENT_IPC_HANDLE_INVALID 0U
 #define DCE_CLIENT_IPC_HANDLE_VALID ((u32)BIT(31))
+#define DCE_CLIENT_IPC_TIMEOUT_MS 5000U
 
 struct tegra_dce_client_ipc client_handles[DCE_CLIENT_IPC_TYPE_MAX];
 
@@ -31,6 +32,20 @@ static uint32_t dce_interface_type_map[DCE_CLIENT_IPC_TYPE_MAX] = {
 static void dce_client_process_event_ipc(struct tegra_dce *d,
 					 struct tegra_dce_client_ipc *cl);
 
+static void dce_client_ipc_req_done(struct tegra_dce_client_ipc *cl,
+				    struct tegra_dce_client_ipc_req *req,
+				    int status)
+{
+	req->status = status;
+
+	if (req->orphan)
+		dce_kfree(cl->d, req);
+	else if (req->done_fn != NULL)
+		req->done_fn(cl->handle, req, req->usr_ctx);
+	else
+		complete(&req->done);
+}
+
 static inline uint32_t dce_client_get_type(uint32_t int_type)
 {
 	uint32_t lc = 0;
@@ -138,6 +153,7 @@ int tegra_dce_register_ipc_client(u32 type,
 	uint32_t int_type;
 	struct tegra_dce *d;
 	struct tegra_dce_client_ipc *cl;
+	struct dce_ipc_queue_info q_info;
 	u32 handle = DCE_CLIENT_IPC_HANDLE_INVALID;
 
 	if (handlep == NULL) {
@@ -172,15 +188,23 @@ int tegra_dce_register_ipc_client(u32 type,
 	cl->handle = handle;
 	cl->int_type = int_type;
 	cl->callback_fn = callback_fn;
-	atomic_set(&cl->complete, 0);
 
-	ret = dce_cond_init(&cl->recv_wait);
+	ret = dce_cond_init(&cl->send_wait);
 	if (ret) {
 		dce_err(d, "dce condition initialization failed for int_type: [%u]",
 			int_type);
 		goto out;
 	}
 
+	dce_mutex_init(&cl->req_lock);
+	INIT_LIST_HEAD(&cl->pending);
+	cl->next_tag = 0;
+	cl->inflight = 0;
+	cl->depth = 1;
+	if (dce_ipc_get_channel_info(d, &q_info, int_type) == 0 &&
+	    q_info.nframes > 0)
+		cl->depth = q_info.nframes;
+
 	d->d_clients[type] = cl;
 
 out:
@@ -198,18 +222,127 @@ EXPORT_SYMBOL(tegra_dce_register_ipc_client);
 int tegra_dce_unregister_ipc_client(u32 handle)
 {
 	struct tegra_dce_client_ipc *cl;
+	struct tegra_dce_client_ipc_req *req, *tmp;
+	LIST_HEAD(done);
 
 	cl = &client_handles[client_handle_to_index(handle)];
-	dce_cond_destroy(&cl->recv_wait);
+
+	/* DCE will not answer anymore, fail whatever is still in flight */
+	if (cl->valid && cl->type != DCE_CLIENT_IPC_TYPE_RM_EVENT) {
+		dce_mutex_lock(&cl->req_lock);
+		list_splice_init(&cl->pending, &done);
+		cl->inflight = 0;
+		cl->closing = true;
+		dce_mutex_unlock(&cl->req_lock);
+
+		list_for_each_entry_safe(req, tmp, &done, node) {
+			list_del(&req->node);
+			dce_client_ipc_req_done(cl, req, -ESHUTDOWN);
+		}
+
+		/* throttled senders must be gone before the client is wiped */
+		dce_cond_broadcast(&cl->send_wait);
+		DCE_COND_WAIT(&cl->send_wait, READ_ONCE(cl->nr_waiting) == 0);
+		dce_mutex_lock(&cl->req_lock);
+		dce_mutex_unlock(&cl->req_lock);
+
+		dce_cond_destroy(&cl->send_wait);
+		dce_mutex_destroy(&cl->req_lock);
+	}
 
 	return dce_client_ipc_handle_free(handle);
 }
 EXPORT_SYMBOL(tegra_dce_unregister_ipc_client);
 
+int tegra_dce_client_ipc_send_async(u32 handle,
+		struct tegra_dce_client_ipc_req *req)
+{
+	int ret;
+	struct tegra_dce_client_ipc *cl;
+	struct dce_ipc_message *msg;
+
+	if (req == NULL || req->msg == NULL) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	cl = dce_client_ipc_lookup_handle(handle);
+	if (cl == NULL || cl->valid == false ||
+	    cl->type == DCE_CLIENT_IPC_TYPE_RM_EVENT) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	msg = req->msg;
+	req->status = -EINPROGRESS;
+	req->orphan = false;
+	init_completion(&req->done);
+
+	dce_mutex_lock(&cl->req_lock);
+
+	while (cl->inflight >= cl->depth && !cl->closing) {
+		cl->nr_waiting++;
+		dce_mutex_unlock(&cl->req_lock);
+		ret = DCE_COND_WAIT_INTERRUPTIBLE_TIMEOUT(&cl->send_wait,
+				READ_ONCE(cl->inflight) < cl->depth ||
+				READ_ONCE(cl->closing),
+				DCE_CLIENT_IPC_TIMEOUT_MS);
+		dce_mutex_lock(&cl->req_lock);
+		cl->nr_waiting--;
+		if (ret)
+			goto unlock;
+	}
+
+	if (cl->closing) {
+		ret = -ESHUTDOWN;
+		goto unlock;
+	}
+
+	/*
+	 * Queue before sending so that even a fast reply finds its request,
+	 * the reply path waits for req_lock.
+	 */
+	req->tag = cl->next_tag;
+	list_add_tail(&req->node, &cl->pending);
+
+	ret = dce_ipc_send_message(cl->d, cl->int_type, msg->tx.data,
+				   msg->tx.size);
+	if (ret) {
+		dce_err(cl->d, "Error in sending message to DCE");
+		list_del(&req->node);
+	} else {
+		cl->next_tag++;
+		cl->inflight++;
+	}
+
+unlock:
+	/* let unregister know once the last throttled sender left */
+	if (cl->closing && cl->nr_waiting == 0)
+		dce_cond_broadcast(&cl->send_wait);
+	dce_mutex_unlock(&cl->req_lock);
+
+out:
+	return ret;
+}
+EXPORT_SYMBOL(tegra_dce_client_ipc_send_async);
+
+int tegra_dce_client_ipc_wait(struct tegra_dce_client_ipc_req *req)
+{
+	if (req == NULL || req->done_fn != NULL)
+		return -EINVAL;
+
+	wait_for_completion(&req->done);
+
+	return req->status;
+}
+EXPORT_SYMBOL(tegra_dce_client_ipc_wait);
+
 int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg)
 {
 	int ret;
+	long t;
 	struct tegra_dce_client_ipc *cl;
+	struct tegra_dce_client_ipc_req *req;
 
 	if (msg == NULL) {
 		ret = -1;
@@ -217,13 +350,51 @@ int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg)
 	}
 
 	cl = dce_client_ipc_lookup_handle(handle);
-	if (cl == NULL) {
-		ret = -1;
+	if (cl == NULL || cl->valid == false) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* on the heap, the request may outlive this call if it is aborted */
+	req = dce_kzalloc(cl->d, sizeof(*req), false);
+	if (req == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	req->msg = msg;
+
+	ret = tegra_dce_client_ipc_send_async(handle, req);
+	if (ret)
+		goto free_req;
+
+	t = wait_for_completion_interruptible_timeout(&req->done,
+			msecs_to_jiffies(DCE_CLIENT_IPC_TIMEOUT_MS));
+	if (t > 0) {
+		ret = req->status;
+		goto free_req;
+	}
+
+	/*
+	 * DCE still owes the reply, which keeps its place in the channel
+	 * order. Leave the request queued as an orphan, the reply is then
+	 * dropped and the request freed once it comes in. If the reply was
+	 * already read, only the completion is left and it is imminent.
+	 */
+	dce_mutex_lock(&cl->req_lock);
+	if (req->status == -EINPROGRESS) {
+		req->orphan = true;
+		dce_mutex_unlock(&cl->req_lock);
+		ret = t ? (int)t : -ETIMEDOUT;
+		dce_err(cl->d, "DCE rpc aborted: %d", ret);
 		goto out;
 	}
+	dce_mutex_unlock(&cl->req_lock);
 
-	ret = dce_ipc_send_message_sync(cl->d, cl->int_type, msg);
+	wait_for_completion(&req->done);
+	ret = req->status;
 
+free_req:
+	dce_kfree(cl->d, req);
 out:
 	return ret;
 }
@@ -258,36 +429,6 @@ void dce_client_deinit(struct tegra_dce *d)
 	destroy_workqueue(d_aipc->async_event_wq);
 }
 
-int dce_client_ipc_wait(struct tegra_dce *d, u32 int_type)
-{
-	uint32_t type;
-	struct tegra_dce_client_ipc *cl;
-
-	type = dce_client_get_type(int_type);
-	if (type >= DCE_CLIENT_IPC_TYPE_MAX) {
-		dce_err(d, "Failed to retrieve client info for int_type: [%d]",
-			int_type);
-		return -EINVAL;
-	}
-
-	cl = d->d_clients[type];
-	if ((cl == NULL) || (cl->int_type != int_type)) {
-		dce_err(d, "Failed to retrieve client info for int_type: [%d]",
-			int_type);
-		return -EINVAL;
-	}
-
-retry_wait:
-	DCE_COND_WAIT_INTERRUPTIBLE(&cl->recv_wait,
-			atomic_read(&cl->complete) == 1);
-	if (atomic_read(&cl->complete) != 1)
-		goto retry_wait;
-
-	atomic_set(&cl->complete, 0);
-
-	return 0;
-}
-
 static void dce_client_process_event_ipc(struct tegra_dce *d,
 					 struct tegra_dce_client_ipc *cl)
 {
@@ -347,6 +488,55 @@ static void dce_client_schedule_event_work(struct tegra_dce *d)
 		dce_err(d, "Failed to schedule Async event Queue Full!");
 }
 
+/*
+ * Replies are matched to the oldest pending request and completed from the
+ * interrupt thread, the submitter does not have to be scheduled in between.
+ */
+static void dce_client_process_replies(struct tegra_dce *d,
+				       struct tegra_dce_client_ipc *cl)
+{
+	bool handled = false;
+	struct tegra_dce_client_ipc_req *req, *tmp;
+	LIST_HEAD(done);
+
+	dce_mutex_lock(&cl->req_lock);
+
+	while (dce_ipc_is_data_available(d, cl->int_type)) {
+		req = list_first_entry_or_null(&cl->pending,
+				struct tegra_dce_client_ipc_req, node);
+		if (req == NULL)
+			break;
+
+		list_move_tail(&req->node, &done);
+		cl->inflight--;
+		handled = true;
+
+		/* the reply to an aborted rpc is read and dropped */
+		if (req->orphan)
+			req->status = dce_ipc_read_message(d, cl->int_type,
+					NULL, 0);
+		else
+			req->status = dce_ipc_read_message(d, cl->int_type,
+					req->msg->rx.data, req->msg->rx.size);
+		if (req->status)
+			dce_err(d, "Error in reading DCE msg for ch_type [%d]",
+				cl->int_type);
+	}
+
+	dce_mutex_unlock(&cl->req_lock);
+
+	if (!handled)
+		return;
+
+	dce_cond_broadcast(&cl->send_wait);
+
+	/* callbacks may queue the next request, run them unlocked */
+	list_for_each_entry_safe(req, tmp, &done, node) {
+		list_del(&req->node);
+		dce_client_ipc_req_done(cl, req, req->status);
+	}
+}
+
 void dce_client_ipc_wakeup(struct tegra_dce *d, u32 ch_type)
 {
 	uint32_t type;
@@ -369,6 +559,5 @@ void dce_client_ipc_wakeup(struct tegra_dce *d, u32 ch_type)
 	if (type == DCE_CLIENT_IPC_TYPE_RM_EVENT)
 		return dce_client_schedule_event_work(d);
 
-	atomic_set(&cl->complete, 1);
-	dce_cond_signal_interruptible(&cl->recv_wait);
+	dce_client_process_replies(d, cl);
 }
@@ -228,14 +228,19 @@ static int _dce_ipc_wait(struct tegra_dce *d, u32 w_type, u32 ch_type)
 		goto out;
 	}
 
+	/* client rpcs are waited on through their tegra_dce_client_ipc_req */
+	if (ch_type != DCE_IPC_TYPE_ADMIN) {
+		dce_err(d, "No synchronous wait on channel type : [%d]",
+			ch_type);
+		ret = -EINVAL;
+		goto out;
+	}
+
 	ch->w_type = w_type;
 
 	dce_mutex_unlock(&ch->lock);
 
-	if (ch_type == DCE_IPC_TYPE_ADMIN)
-		ret = dce_admin_ipc_wait(d, w_type);
-	else
-		ret = dce_client_ipc_wait(d, ch_type);
+	ret = dce_admin_ipc_wait(d, w_type);
 
 	dce_mutex_lock(&ch->lock);
 
@@ -28,10 +28,17 @@
  * @int_type : IPC interface type for above IPC type as defined in CPU driver
  * @d : pointer to OS agnostic dce struct. Stores all runtime info for dce
  *      cluster elements
- * @recv_wait : condition variable used for IPC synchronization
- * @complete : atomic variable used for IPC synchronization
  * @callback_fn : function pointer to the callback function passed by the
  *                client during registration
+ * @req_lock : serializes request submission against reply processing so
+ *             that pending stays in channel order
+ * @pending : asynchronous requests sent to DCE and not yet replied to
+ * @next_tag : tag of the next submitted request
+ * @inflight : number of requests in pending
+ * @depth : max requests in flight, the number of frames of the channel
+ * @send_wait : condition variable senders wait on while the channel is full
+ * @nr_waiting : number of senders sleeping on send_wait
+ * @closing : set by unregister, fails throttled and new senders
  */
 struct tegra_dce_client_ipc {
 	bool valid;
@@ -40,9 +47,15 @@ struct tegra_dce_client_ipc {
 	uint32_t handle;
 	uint32_t int_type;
 	struct tegra_dce *d;
-	struct dce_cond recv_wait;
-	atomic_t complete;
 	tegra_dce_client_ipc_callback_t callback_fn;
+	struct dce_mutex req_lock;
+	struct list_head pending;
+	u32 next_tag;
+	u32 inflight;
+	u32 depth;
+	struct dce_cond send_wait;
+	u32 nr_waiting;
+	bool closing;
 };
 
 #define DCE_MAX_ASYNC_WORK	8
@@ -62,8 +75,6 @@ struct tegra_dce_async_ipc_info {
 
 void dce_client_ipc_wakeup(struct tegra_dce *d,	u32 ch_type);
 
-int dce_client_ipc_wait(struct tegra_dce *d, u32 ch_type);
-
 int dce_client_init(struct tegra_dce *d);
 
 void dce_client_deinit(struct tegra_dce *d);
@@ -29,7 +29,7 @@
 /**
  * TODO : Move the DispRM max to a config file
  */
-#define DCE_DISPRM_CMD_MAX_NFRAMES	        1U
+#define DCE_DISPRM_CMD_MAX_NFRAMES	        4U
 #define DCE_DISPRM_CMD_MAX_FSIZE	        4096U
 #define DCE_DISPRM_EVENT_NOTIFY_CMD_MAX_NFRAMES	4U
 #define DCE_DISPRM_EVENT_NOTIFY_CMD_MAX_FSIZE	4096U
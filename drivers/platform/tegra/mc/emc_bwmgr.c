@@ -23,6 +23,7 @@
 #include <linux/debugfs.h>
 #include <linux/thermal.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 #if KERNEL_VERSION(4, 15, 0) > LINUX_VERSION_CODE
 #include <soc/tegra/chip-id.h>
 #include <soc/tegra/tegra_bpmp.h>
@@ -83,8 +84,33 @@ static struct {
 	bool status;
 	struct bwmgr_ops *ops;
 	bool override;
+	/* deferred update for tegra_bwmgr_set_emc_async() */
+	struct delayed_work work;
+	bool clk_dirty;
+	u32 coalesce_us;
 } bwmgr;
 
+/*
+ * Aggregate of all client requests, kept up to date as requests change so
+ * that a clock update does not have to walk every client. The sums are not
+ * clamped; bwmgr_update_clk() clamps them to emc_max_rate.
+ */
+static struct {
+	u64 bw;
+	u64 iso_bw_nvdis;
+	u64 iso_bw_vi;
+	u64 iso_bw_other;
+	u64 iso_client_flags;
+	unsigned long non_iso_cap;
+	unsigned long iso_cap;
+	unsigned long floor;
+
+	/* last values handed to the clock framework */
+	bool clk_valid;
+	unsigned long clk_cap_req;
+	unsigned long clk_rate;
+} bwmgr_agg;
+
 static struct dram_refresh_alrt {
 	unsigned long cur_state;
 	u32 max_cooling_state;
@@ -211,6 +237,117 @@ static inline bool bwmgr_unlock(void)
 	return true;
 }
 
+/* call with bwmgr lock held except during init */
+static void bwmgr_agg_rebuild_limits(void)
+{
+	int i;
+
+	bwmgr_agg.non_iso_cap = bwmgr.emc_max_rate;
+	bwmgr_agg.iso_cap = bwmgr.emc_max_rate;
+	bwmgr_agg.floor = 0;
+
+	for (i = 0; i < TEGRA_BWMGR_CLIENT_COUNT; i++) {
+		bwmgr_agg.non_iso_cap = min(bwmgr_agg.non_iso_cap,
+				bwmgr.bwmgr_client[i].cap);
+		bwmgr_agg.iso_cap = min(bwmgr_agg.iso_cap,
+				bwmgr.bwmgr_client[i].iso_cap);
+		bwmgr_agg.floor = max(bwmgr_agg.floor,
+				bwmgr.bwmgr_client[i].floor);
+	}
+}
+
+/* call with bwmgr lock held except during init */
+static void bwmgr_agg_rebuild(void)
+{
+	int i;
+
+	bwmgr_agg.bw = 0;
+	bwmgr_agg.iso_bw_nvdis = 0;
+	bwmgr_agg.iso_bw_vi = 0;
+	bwmgr_agg.iso_bw_other = 0;
+	bwmgr_agg.iso_client_flags = 0;
+
+	for (i = 0; i < TEGRA_BWMGR_CLIENT_COUNT; i++) {
+		unsigned long iso_bw = bwmgr.bwmgr_client[i].iso_bw;
+
+		bwmgr_agg.bw += bwmgr.bwmgr_client[i].bw;
+
+		if (iso_bw > 0)
+			bwmgr_agg.iso_client_flags |= BIT_ULL(i);
+
+		if ((i == TEGRA_BWMGR_CLIENT_DISP0) ||
+				(i == TEGRA_BWMGR_CLIENT_DISP1) ||
+				(i == TEGRA_BWMGR_CLIENT_DISP2))
+			bwmgr_agg.iso_bw_nvdis += iso_bw;
+		else if (i == TEGRA_BWMGR_CLIENT_CAMERA)
+			bwmgr_agg.iso_bw_vi += iso_bw;
+		else
+			bwmgr_agg.iso_bw_other += iso_bw;
+	}
+
+	bwmgr_agg_rebuild_limits();
+}
+
+/*
+ * Fold the change of one client request from old to val into the aggregate.
+ * Sums are adjusted by the difference. A min/max limit is only recomputed
+ * from all clients when the client that defined it relaxes its request.
+ * Call with bwmgr lock held.
+ */
+static void bwmgr_agg_update(int client, enum tegra_bwmgr_request_type req,
+		unsigned long old, unsigned long val)
+{
+	u64 *iso_sum;
+
+	switch (req) {
+	case TEGRA_BWMGR_SET_EMC_FLOOR:
+		if (val >= bwmgr_agg.floor)
+			bwmgr_agg.floor = val;
+		else if (old == bwmgr_agg.floor)
+			bwmgr_agg_rebuild_limits();
+		break;
+
+	case TEGRA_BWMGR_SET_EMC_CAP:
+		if (val <= bwmgr_agg.non_iso_cap)
+			bwmgr_agg.non_iso_cap = val;
+		else if (old == bwmgr_agg.non_iso_cap)
+			bwmgr_agg_rebuild_limits();
+		break;
+
+	case TEGRA_BWMGR_SET_EMC_ISO_CAP:
+		if (val <= bwmgr_agg.iso_cap)
+			bwmgr_agg.iso_cap = val;
+		else if (old == bwmgr_agg.iso_cap)
+			bwmgr_agg_rebuild_limits();
+		break;
+
+	case TEGRA_BWMGR_SET_EMC_SHARED_BW:
+		bwmgr_agg.bw = bwmgr_agg.bw - old + val;
+		break;
+
+	case TEGRA_BWMGR_SET_EMC_SHARED_BW_ISO:
+		if ((client == TEGRA_BWMGR_CLIENT_DISP0) ||
+				(client == TEGRA_BWMGR_CLIENT_DISP1) ||
+				(client == TEGRA_BWMGR_CLIENT_DISP2))
+			iso_sum = &bwmgr_agg.iso_bw_nvdis;
+		else if (client == TEGRA_BWMGR_CLIENT_CAMERA)
+			iso_sum = &bwmgr_agg.iso_bw_vi;
+		else
+			iso_sum = &bwmgr_agg.iso_bw_other;
+
+		*iso_sum = *iso_sum - old + val;
+
+		if (val > 0)
+			bwmgr_agg.iso_client_flags |= BIT_ULL(client);
+		else
+			bwmgr_agg.iso_client_flags &= ~BIT_ULL(client);
+		break;
+
+	default:
+		break;
+	}
+}
+
 /* call with bwmgr lock held except during init*/
 static void purge_client(struct tegra_bwmgr_client *handle)
 {
@@ -236,18 +373,18 @@ static unsigned long tegra_bwmgr_apply_efficiency(
 /* call with bwmgr lock held */
 static int bwmgr_update_clk(void)
 {
-	int i;
-	unsigned long bw = 0;
-	unsigned long iso_bw = 0; // iso_bw_guarantee
-	unsigned long iso_bw_nvdis = 0; //DISP0 + DISP1 + DISP2
-	unsigned long iso_bw_vi = 0; //CAMERA
-	unsigned long iso_bw_other_clients = 0; //Other ISO clients
-	unsigned long non_iso_cap = bwmgr.emc_max_rate;
-	unsigned long iso_cap = bwmgr.emc_max_rate;
-	unsigned long clk_cap = bwmgr.emc_max_rate;
-	unsigned long floor = 0;
+	unsigned long max_rate = bwmgr.emc_max_rate;
+	unsigned long bw;
+	unsigned long iso_bw; // iso_bw_guarantee
+	unsigned long iso_bw_nvdis; //DISP0 + DISP1 + DISP2
+	unsigned long iso_bw_vi; //CAMERA
+	unsigned long iso_bw_other_clients; //Other ISO clients
+	unsigned long non_iso_cap;
+	unsigned long iso_cap;
+	unsigned long clk_cap;
+	unsigned long cap_req;
+	unsigned long floor;
 	unsigned long iso_bw_min;
-	u64 iso_client_flags = 0;
 	int ret = 0;
 
 	/* sizeof(iso_client_flags) */
@@ -261,52 +398,39 @@ static int bwmgr_update_clk(void)
 	if (bwmgr.override)
 		return 0;
 
-	for (i = 0; i < TEGRA_BWMGR_CLIENT_COUNT; i++) {
-		bw += bwmgr.bwmgr_client[i].bw;
-		bw = min(bw, bwmgr.emc_max_rate);
-
-		if (bwmgr.bwmgr_client[i].iso_bw > 0) {
-			iso_client_flags |= BIT(i);
-
-			if ((i == TEGRA_BWMGR_CLIENT_DISP0) ||
-					(i == TEGRA_BWMGR_CLIENT_DISP1) ||
-					(i == TEGRA_BWMGR_CLIENT_DISP2)) {
-				iso_bw_nvdis += bwmgr.bwmgr_client[i].iso_bw;
-				iso_bw_nvdis = min(iso_bw_nvdis,
-							bwmgr.emc_max_rate);
-			} else if (i == TEGRA_BWMGR_CLIENT_CAMERA) {
-				iso_bw_vi += bwmgr.bwmgr_client[i].iso_bw;
-				iso_bw_vi = min(iso_bw_vi, bwmgr.emc_max_rate);
-			} else {
-				iso_bw_other_clients +=
-						bwmgr.bwmgr_client[i].iso_bw;
-				iso_bw_other_clients = min(iso_bw_other_clients,
-							bwmgr.emc_max_rate);
-			}
-
-			iso_bw = iso_bw_nvdis + iso_bw_vi +
-						iso_bw_other_clients;
-			iso_bw = min(iso_bw, bwmgr.emc_max_rate);
+	bwmgr.clk_dirty = false;
+
+	bw = min_t(u64, bwmgr_agg.bw, max_rate);
+	iso_bw_nvdis = min_t(u64, bwmgr_agg.iso_bw_nvdis, max_rate);
+	iso_bw_vi = min_t(u64, bwmgr_agg.iso_bw_vi, max_rate);
+	iso_bw_other_clients = min_t(u64, bwmgr_agg.iso_bw_other, max_rate);
+	iso_bw = min(iso_bw_nvdis + iso_bw_vi + iso_bw_other_clients,
+			max_rate);
+	non_iso_cap = bwmgr_agg.non_iso_cap;
+	iso_cap = bwmgr_agg.iso_cap;
+	floor = bwmgr_agg.floor;
+
+	/* the clock max rate only needs touching when the caps move */
+	cap_req = min(iso_cap, non_iso_cap);
+	if (!bwmgr_agg.clk_valid || cap_req != bwmgr_agg.clk_cap_req) {
+		bwmgr_agg.clk_valid = false;
+
+		ret = clk_set_max_rate(bwmgr.emc_clk, ULONG_MAX);
+		if (ret) {
+			pr_err("bwmgr: clk_set_max_rate failed for freq %lu Hz with errno %d\n",
+			       ULONG_MAX, ret);
+			return ret;
 		}
 
-		non_iso_cap = min(non_iso_cap, bwmgr.bwmgr_client[i].cap);
-		iso_cap = min(iso_cap, bwmgr.bwmgr_client[i].iso_cap);
-		floor = max(floor, bwmgr.bwmgr_client[i].floor);
-	}
-
-	ret = clk_set_max_rate(bwmgr.emc_clk, ULONG_MAX);
-	if (ret) {
-		pr_err("bwmgr: clk_set_max_rate failed for freq %lu Hz with errno %d\n",
-		       ULONG_MAX, ret);
-		return ret;
-	}
+		clk_cap = clk_round_rate(bwmgr.emc_clk, cap_req);
+		ret = clk_set_max_rate(bwmgr.emc_clk, clk_cap);
+		if (ret) {
+			pr_err("bwmgr: clk_set_max_rate failed for freq %lu Hz with errno %d\n",
+			       clk_cap, ret);
+			return ret;
+		}
 
-	clk_cap = clk_round_rate(bwmgr.emc_clk, min(iso_cap, non_iso_cap));
-	ret = clk_set_max_rate(bwmgr.emc_clk, clk_cap);
-	if (ret) {
-		pr_err("bwmgr: clk_set_max_rate failed for freq %lu Hz with errno %d\n",
-		       clk_cap, ret);
-		return ret;
+		bwmgr_agg.clk_cap_req = cap_req;
 	}
 
 	debug_info.bw = bw;
@@ -317,7 +441,7 @@ static int bwmgr_update_clk(void)
 	bw += iso_bw;
 	bw = tegra_bwmgr_apply_efficiency(
 			bw, iso_bw, bwmgr.emc_max_rate,
-			iso_client_flags, &iso_bw_min,
+			bwmgr_agg.iso_client_flags, &iso_bw_min,
 			iso_bw_nvdis, iso_bw_vi);
 	debug_info.total_bw_aftr_eff = bw;
 	debug_info.iso_bw_aftr_eff = iso_bw_min;
@@ -327,15 +451,39 @@ static int bwmgr_update_clk(void)
 	debug_info.calc_freq = bw;
 	debug_info.req_freq = bw;
 
+	/* nothing to do if the effective rate did not change */
+	if (bwmgr_agg.clk_valid && bw == bwmgr_agg.clk_rate)
+		return 0;
+
 	ret = clk_set_rate(bwmgr.emc_clk, bw);
-	if (ret)
+	if (ret) {
 		pr_err
 		("bwmgr: clk_set_rate failed for freq %lu Hz with errno %d\n",
 				bw, ret);
+		bwmgr_agg.clk_valid = false;
+		return ret;
+	}
+
+	bwmgr_agg.clk_rate = bw;
+	bwmgr_agg.clk_valid = true;
 
 	return ret;
 }
 
+static void bwmgr_update_worker(struct work_struct *work)
+{
+	if (!bwmgr_lock()) {
+		pr_err("bwmgr: %s failed\n", __func__);
+		return;
+	}
+
+	if (bwmgr.clk_dirty && !clk_update_disabled)
+		bwmgr_update_clk();
+
+	if (!bwmgr_unlock())
+		pr_err("bwmgr: %s failed\n", __func__);
+}
+
 struct tegra_bwmgr_client *tegra_bwmgr_register(
 		enum tegra_bwmgr_client_id client)
 {
@@ -402,6 +550,7 @@ void tegra_bwmgr_unregister(struct tegra_bwmgr_client *handle)
 			WARN_ON(true);
 		}
 		purge_client(handle);
+		bwmgr_agg_rebuild();
 	}
 
 	if (!bwmgr_unlock()) {
@@ -461,11 +610,13 @@ unsigned long tegra_bwmgr_round_rate(unsigned long bw)
 }
 EXPORT_SYMBOL_GPL(tegra_bwmgr_round_rate);
 
-int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
-		enum tegra_bwmgr_request_type req)
+static int __tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle,
+		unsigned long val, enum tegra_bwmgr_request_type req,
+		bool async)
 {
 	int ret = 0;
 	bool update_clk = false;
+	unsigned long old = 0;
 
 	IS_BWMGR_SUPPORTED(bwmgr_disable, -ENOTSUPP);
 
@@ -511,6 +662,7 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 	switch (req) {
 	case TEGRA_BWMGR_SET_EMC_FLOOR:
 		if (handle->floor != val) {
+			old = handle->floor;
 			handle->floor = val;
 			update_clk = true;
 		}
@@ -521,6 +673,7 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 			val = bwmgr.emc_max_rate;
 
 		if (handle->cap != val) {
+			old = handle->cap;
 			handle->cap = val;
 			update_clk = true;
 		}
@@ -531,6 +684,7 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 			val = bwmgr.emc_max_rate;
 
 		if (handle->iso_cap != val) {
+			old = handle->iso_cap;
 			handle->iso_cap = val;
 			update_clk = true;
 		}
@@ -538,6 +692,7 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 
 	case TEGRA_BWMGR_SET_EMC_SHARED_BW:
 		if (handle->bw != val) {
+			old = handle->bw;
 			handle->bw = val;
 			update_clk = true;
 		}
@@ -545,6 +700,7 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 
 	case TEGRA_BWMGR_SET_EMC_SHARED_BW_ISO:
 		if (handle->iso_bw != val) {
+			old = handle->iso_bw;
 			handle->iso_bw = val;
 			update_clk = true;
 		}
@@ -561,8 +717,24 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 		return -EINVAL;
 	}
 
-	if (update_clk && !clk_update_disabled)
-		ret = bwmgr_update_clk();
+	if (update_clk)
+		bwmgr_agg_update(handle - bwmgr.bwmgr_client, req, old, val);
+
+	/*
+	 * An async request is folded into the next deferred update, unless
+	 * it raises ISO bandwidth: isochronous clients cannot wait for the
+	 * coalescing window, so the clock is raised before returning.
+	 */
+	if (update_clk && !clk_update_disabled) {
+		if (async && !(req == TEGRA_BWMGR_SET_EMC_SHARED_BW_ISO &&
+				val > old)) {
+			bwmgr.clk_dirty = true;
+			queue_delayed_work(system_highpri_wq, &bwmgr.work,
+					usecs_to_jiffies(bwmgr.coalesce_us));
+		} else {
+			ret = bwmgr_update_clk();
+		}
+	}
 
 	if (!bwmgr_unlock()) {
 		pr_err("bwmgr: %s failed for client %s\n",
@@ -573,8 +745,21 @@ int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 
 	return ret;
 }
+
+int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
+		enum tegra_bwmgr_request_type req)
+{
+	return __tegra_bwmgr_set_emc(handle, val, req, false);
+}
 EXPORT_SYMBOL_GPL(tegra_bwmgr_set_emc);
 
+int tegra_bwmgr_set_emc_async(struct tegra_bwmgr_client *handle,
+		unsigned long val, enum tegra_bwmgr_request_type req)
+{
+	return __tegra_bwmgr_set_emc(handle, val, req, true);
+}
+EXPORT_SYMBOL_GPL(tegra_bwmgr_set_emc_async);
+
 int tegra_bwmgr_get_client_info(struct tegra_bwmgr_client *handle,
 		unsigned long *out_val,
 		enum tegra_bwmgr_request_type req)
@@ -870,6 +1055,8 @@ int __init bwmgr_init(void)
 #endif
 
 	mutex_init(&bwmgr.lock);
+	INIT_DELAYED_WORK(&bwmgr.work, bwmgr_update_worker);
+	bwmgr.coalesce_us = 1000;
 
 	if (tegra_get_chip_id() == TEGRA210)
 		bwmgr.ops = bwmgr_eff_init_t21x();
@@ -965,6 +1152,7 @@ bpmp_skip:
 
 	for (i = 0; i < TEGRA_BWMGR_CLIENT_COUNT; i++)
 		purge_client(bwmgr.bwmgr_client + i);
+	bwmgr_agg_rebuild();
 
 	bwmgr_debugfs_init();
 
@@ -989,6 +1177,8 @@ void __exit bwmgr_exit(void)
 	if (bwmgr_disable)
 		return;
 
+	cancel_delayed_work_sync(&bwmgr.work);
+
 	for (i = 0; i < TEGRA_BWMGR_CLIENT_COUNT; i++)
 		purge_client(bwmgr.bwmgr_client + i);
 
@@ -1084,6 +1274,7 @@ static int bwmgr_debugfs_emc_rate_set(void *data, u64 val)
 		bwmgr_update_clk();
 	} else if (bwmgr.emc_clk) {
 		bwmgr.override = true;
+		bwmgr_agg.clk_valid = false;
 		ret = clk_set_rate(bwmgr.emc_clk, val);
 	}
 
@@ -1277,6 +1468,8 @@ static void bwmgr_debugfs_init(void)
 		debugfs_create_bool(
 			"clk_update_disabled", S_IRWXU, debugfs_dir,
 			&clk_update_disabled);
+		debugfs_create_u32("coalesce_us", S_IRUSR | S_IWUSR,
+			debugfs_dir, &bwmgr.coalesce_us);
 		debugfs_create_u64("emc_min_rate", S_IRUSR, debugfs_dir,
 			(u64 *) &bwmgr.emc_min_rate);
 		debugfs_create_u64("emc_max_rate", S_IRUSR, debugfs_dir,
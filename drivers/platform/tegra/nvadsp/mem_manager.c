@@ -3,7 +3,7 @@
  *
  * memory manager
  *
- * Copyright (C) 2014-2018 NVIDIA Corporation. All rights reserved.
+ * Copyright (C) 2014-2022 NVIDIA Corporation. All rights reserved.
  *
  * This software is licensed under the terms of the GNU General Public
  * License version 2, as published by the Free Software Foundation, and
@@ -18,7 +18,7 @@
 
 #define pr_fmt(fmt) "%s : %d, " fmt, __func__, __LINE__
 
-#include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/err.h>
@@ -26,34 +26,114 @@
 
 #include "mem_manager.h"
 
-static void clear_alloc_list(struct mem_manager_info *mm_info);
+/*
+ * Free chunks are kept in two rbtrees, one ordered by address to find the
+ * neighbours to coalesce with on release and one ordered by size, then
+ * address, for the best fit search. Allocated chunks are kept ordered by
+ * address. Every operation is O(log n) in the number of chunks.
+ */
+
+static void mem_addr_insert(struct rb_root *root, struct mem_chunk *mc)
+{
+	struct rb_node **link = &root->rb_node, *parent = NULL;
+	struct mem_chunk *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct mem_chunk, addr_node);
+		if (mc->address < entry->address)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&mc->addr_node, parent, link);
+	rb_insert_color(&mc->addr_node, root);
+}
+
+static void mem_size_insert(struct mem_manager_info *mm_info,
+			    struct mem_chunk *mc)
+{
+	struct rb_node **link = &mm_info->free_size_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct mem_chunk *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct mem_chunk, size_node);
+		if (mc->size < entry->size ||
+		    (mc->size == entry->size && mc->address < entry->address))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&mc->size_node, parent, link);
+	rb_insert_color(&mc->size_node, &mm_info->free_size_tree);
+}
+
+/* Smallest free chunk of at least size bytes, lowest address on a tie */
+static struct mem_chunk *mem_best_fit(struct mem_manager_info *mm_info,
+				      size_t size)
+{
+	struct rb_node *n = mm_info->free_size_tree.rb_node;
+	struct mem_chunk *mc, *best = NULL;
+
+	while (n) {
+		mc = rb_entry(n, struct mem_chunk, size_node);
+		if (mc->size >= size) {
+			best = mc;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return best;
+}
+
+/* Free chunks right below and right above address */
+static void mem_free_neighbours(struct mem_manager_info *mm_info,
+				unsigned long address,
+				struct mem_chunk **prev, struct mem_chunk **next)
+{
+	struct rb_node *n = mm_info->free_tree.rb_node;
+	struct mem_chunk *mc;
+
+	*prev = NULL;
+	*next = NULL;
+
+	while (n) {
+		mc = rb_entry(n, struct mem_chunk, addr_node);
+		if (address < mc->address) {
+			*next = mc;
+			n = n->rb_left;
+		} else {
+			*prev = mc;
+			n = n->rb_right;
+		}
+	}
+}
 
 void *mem_request(void *mem_handle, const char *name, size_t size)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_iterator = NULL, *best_match_chunk = NULL;
+	struct mem_chunk *best_match_chunk = NULL;
 	struct mem_chunk *new_mc = NULL;
 
 	spin_lock_irqsave(&mm_info->lock, flags);
 
 	/* Is mem full? */
-	if (list_empty(mm_info->free_list)) {
+	if (RB_EMPTY_ROOT(&mm_info->free_tree)) {
 		pr_err("%s : memory full\n", mm_info->name);
 		spin_unlock_irqrestore(&mm_info->lock, flags);
 		return ERR_PTR(-ENOMEM);
 	}
 
 	/* Find the best size match */
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
-		if (mc_iterator->size >= size) {
-			if (best_match_chunk == NULL)
-				best_match_chunk = mc_iterator;
-			else if (mc_iterator->size < best_match_chunk->size)
-				best_match_chunk = mc_iterator;
-		}
-	}
+	best_match_chunk = mem_best_fit(mm_info, size);
 
 	/* Is free node found? */
 	if (best_match_chunk == NULL) {
@@ -64,21 +144,10 @@ void *mem_request(void *mem_handle, const char *name, size_t size)
 
 	/* Is it exact match? */
 	if (best_match_chunk->size == size) {
-		list_del(&best_match_chunk->node);
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (best_match_chunk->address < mc_iterator->address) {
-				list_add_tail(&best_match_chunk->node,
-						&mc_iterator->node);
-				strlcpy(best_match_chunk->name, name,
-						NAME_SIZE);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return best_match_chunk;
-			}
-		}
-		list_add(&best_match_chunk->node, mm_info->alloc_list);
-		strlcpy(best_match_chunk->name, name, NAME_SIZE);
-		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return best_match_chunk;
+		rb_erase(&best_match_chunk->size_node,
+			 &mm_info->free_size_tree);
+		rb_erase(&best_match_chunk->addr_node, &mm_info->free_tree);
+		new_mc = best_match_chunk;
 	} else {
 		new_mc = kzalloc(sizeof(struct mem_chunk), GFP_ATOMIC);
 		if (unlikely(!new_mc)) {
@@ -89,32 +158,31 @@ void *mem_request(void *mem_handle, const char *name, size_t size)
 		}
 		new_mc->address = best_match_chunk->address;
 		new_mc->size = size;
-		strlcpy(new_mc->name, name, NAME_SIZE);
+
+		/* the remainder keeps its place in address order */
+		rb_erase(&best_match_chunk->size_node,
+			 &mm_info->free_size_tree);
 		best_match_chunk->address += size;
 		best_match_chunk->size -= size;
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (new_mc->address < mc_iterator->address) {
-				list_add_tail(&new_mc->node,
-						&mc_iterator->node);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return new_mc;
-			}
-		}
-		list_add_tail(&new_mc->node, mm_info->alloc_list);
-		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return new_mc;
+		mem_size_insert(mm_info, best_match_chunk);
 	}
+
+	strlcpy(new_mc->name, name, NAME_SIZE);
+	mem_addr_insert(&mm_info->alloc_tree, new_mc);
+
+	spin_unlock_irqrestore(&mm_info->lock, flags);
+	return new_mc;
 }
 
 /*
- * Find the node with sepcified address and remove it from list
+ * Return the chunk to the free trees, merged with adjacent free chunks
  */
 bool mem_release(void *mem_handle, void *handle)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_curr = NULL, *mc_prev = NULL;
+	struct mem_chunk *mc_prev = NULL, *mc_next = NULL;
 	struct mem_chunk *mc_free = (struct mem_chunk *)handle;
 
 	pr_debug(" addr = %lu, size = %lu, name = %s\n",
@@ -122,50 +190,35 @@ bool mem_release(void *mem_handle, void *handle)
 
 	spin_lock_irqsave(&mm_info->lock, flags);
 
-	list_for_each_entry(mc_curr, mm_info->free_list, node) {
-		if (mc_free->address < mc_curr->address) {
-
-			strlcpy(mc_free->name, "FREE", NAME_SIZE);
-
-			/* adjacent next free node */
-			if (mc_curr->address ==
-				(mc_free->address + mc_free->size)) {
-
-				mc_curr->address = mc_free->address;
-				mc_curr->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-
-				/* and adjacent prev free node */
-				if ((mc_prev != NULL) &&
-				   ((mc_prev->address + mc_prev->size) ==
-						mc_curr->address)) {
-
-					mc_prev->size += mc_curr->size;
-					list_del(&mc_curr->node);
-					kfree(mc_curr);
-				}
-			}
-			/* adjacent prev free node */
-			else if ((mc_prev != NULL) &&
-				((mc_prev->address + mc_prev->size) ==
-						mc_free->address)) {
-
-				mc_prev->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-			} else {
-				list_del(&mc_free->node);
-				list_add_tail(&mc_free->node,
-						&mc_curr->node);
-			}
-			spin_unlock_irqrestore(&mm_info->lock, flags);
-			return true;
-		}
-		mc_prev = mc_curr;
+	rb_erase(&mc_free->addr_node, &mm_info->alloc_tree);
+	strlcpy(mc_free->name, "FREE", NAME_SIZE);
+
+	mem_free_neighbours(mm_info, mc_free->address, &mc_prev, &mc_next);
+
+	/* adjacent prev free node */
+	if ((mc_prev != NULL) &&
+	    ((mc_prev->address + mc_prev->size) == mc_free->address)) {
+		rb_erase(&mc_prev->size_node, &mm_info->free_size_tree);
+		mc_prev->size += mc_free->size;
+		kfree(mc_free);
+		mc_free = mc_prev;
+	} else {
+		mem_addr_insert(&mm_info->free_tree, mc_free);
+	}
+
+	/* adjacent next free node */
+	if ((mc_next != NULL) &&
+	    ((mc_free->address + mc_free->size) == mc_next->address)) {
+		rb_erase(&mc_next->size_node, &mm_info->free_size_tree);
+		rb_erase(&mc_next->addr_node, &mm_info->free_tree);
+		mc_free->size += mc_next->size;
+		kfree(mc_next);
 	}
+
+	mem_size_insert(mm_info, mc_free);
+
 	spin_unlock_irqrestore(&mm_info->lock, flags);
-	return false;
+	return true;
 }
 
 inline unsigned long mem_get_address(void *handle)
@@ -179,17 +232,20 @@ void mem_print(void *mem_handle)
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
 	struct mem_chunk *mc_iterator = NULL;
+	struct rb_node *n;
 
 	pr_info("------------------------------------\n");
 	pr_info("%s ALLOCATED\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
+	for (n = rb_first(&mm_info->alloc_tree); n; n = rb_next(n)) {
+		mc_iterator = rb_entry(n, struct mem_chunk, addr_node);
 		pr_info("  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
 	}
 
 	pr_info("%s FREE\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
+	for (n = rb_first(&mm_info->free_tree); n; n = rb_next(n)) {
+		mc_iterator = rb_entry(n, struct mem_chunk, addr_node);
 		pr_info("  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
@@ -203,17 +259,20 @@ void mem_dump(void *mem_handle, struct seq_file *s)
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
 	struct mem_chunk *mc_iterator = NULL;
+	struct rb_node *n;
 
 	seq_puts(s, "---------------------------------------\n");
 	seq_printf(s, "%s ALLOCATED\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
+	for (n = rb_first(&mm_info->alloc_tree); n; n = rb_next(n)) {
+		mc_iterator = rb_entry(n, struct mem_chunk, addr_node);
 		seq_printf(s, "  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
 	}
 
 	seq_printf(s, "%s FREE\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
+	for (n = rb_first(&mm_info->free_tree); n; n = rb_next(n)) {
+		mc_iterator = rb_entry(n, struct mem_chunk, addr_node);
 		seq_printf(s, "  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
@@ -224,11 +283,11 @@ void mem_dump(void *mem_handle, struct seq_file *s)
 
 static void clear_alloc_list(struct mem_manager_info *mm_info)
 {
-	struct list_head *curr, *next;
+	struct rb_node *n;
 	struct mem_chunk *mc = NULL;
 
-	list_for_each_safe(curr, next, mm_info->alloc_list) {
-		mc = list_entry(curr, struct mem_chunk, node);
+	while ((n = rb_first(&mm_info->alloc_tree))) {
+		mc = rb_entry(n, struct mem_chunk, addr_node);
 		pr_debug("  addr = %lu, size = %lu, name = %s\n",
 			mc->address, mc->size,
 			mc->name);
@@ -239,7 +298,6 @@ static void clear_alloc_list(struct mem_manager_info *mm_info)
 void *create_mem_manager(const char *name, unsigned long start_address,
 				unsigned long size)
 {
-	void *ret = NULL;
 	struct mem_chunk *mc;
 	struct mem_manager_info *mm_info =
 			kzalloc(sizeof(struct mem_manager_info), GFP_KERNEL);
@@ -250,22 +308,9 @@ void *create_mem_manager(const char *name, unsigned long start_address,
 
 	strlcpy(mm_info->name, name, NAME_SIZE);
 
-	mm_info->alloc_list = kzalloc(sizeof(struct list_head), GFP_KERNEL);
-	if (unlikely(!mm_info->alloc_list)) {
-		pr_err("failed to allocate memory for alloc_list\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_mm_info;
-	}
-
-	mm_info->free_list = kzalloc(sizeof(struct list_head), GFP_KERNEL);
-	if (unlikely(!mm_info->free_list)) {
-		pr_err("failed to allocate memory for free_list\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_alloc_list;
-	}
-
-	INIT_LIST_HEAD(mm_info->alloc_list);
-	INIT_LIST_HEAD(mm_info->free_list);
+	mm_info->alloc_tree = RB_ROOT;
+	mm_info->free_tree = RB_ROOT;
+	mm_info->free_size_tree = RB_ROOT;
 
 	mm_info->start_address = start_address;
 	mm_info->size = size;
@@ -274,43 +319,32 @@ void *create_mem_manager(const char *name, unsigned long start_address,
 	mc = kzalloc(sizeof(struct mem_chunk), GFP_KERNEL);
 	if (unlikely(!mc)) {
 		pr_err("failed to allocate memory for mem_chunk\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_free_list;
+		kfree(mm_info);
+		return ERR_PTR(-ENOMEM);
 	}
 
 	mc->address = mm_info->start_address;
 	mc->size = mm_info->size;
 	strlcpy(mc->name, "FREE", NAME_SIZE);
-	list_add(&mc->node, mm_info->free_list);
+	mem_addr_insert(&mm_info->free_tree, mc);
+	mem_size_insert(mm_info, mc);
 	spin_lock_init(&mm_info->lock);
 
 	return (void *)mm_info;
-
-free_free_list:
-	kfree(mm_info->free_list);
-free_alloc_list:
-	kfree(mm_info->alloc_list);
-free_mm_info:
-	kfree(mm_info);
-
-	return ret;
 }
 
 void destroy_mem_manager(void *mem_handle)
 {
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_last = NULL;
+	struct mem_chunk *mc, *tmp;
 
 	/* Clear all allocated memory */
 	clear_alloc_list(mm_info);
 
-	mc_last = list_entry((mm_info->free_list)->next,
-			struct mem_chunk, node);
-	list_del(&mc_last->node);
+	rbtree_postorder_for_each_entry_safe(mc, tmp, &mm_info->free_tree,
+					     addr_node)
+		kfree(mc);
 
-	kfree(mc_last);
-	kfree(mm_info->alloc_list);
-	kfree(mm_info->free_list);
 	kfree(mm_info);
 }
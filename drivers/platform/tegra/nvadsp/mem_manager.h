@@ -1,7 +1,7 @@
 /*
  * Header file for memory manager
  *
- * Copyright (c) 2014, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2014-2022, NVIDIA CORPORATION.  All rights reserved.
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms and conditions of the GNU General Public License,
@@ -17,19 +17,22 @@
 #define __TEGRA_NVADSP_MEM_MANAGER_H
 
 #include <linux/sizes.h>
+#include <linux/rbtree.h>
 
 #define NAME_SIZE SZ_16
 
 struct mem_chunk {
-	struct list_head node;
+	struct rb_node addr_node;	/* alloc_tree or free_tree */
+	struct rb_node size_node;	/* free_size_tree, free chunks only */
 	char name[NAME_SIZE];
 	unsigned long address;
 	unsigned long size;
 };
 
 struct mem_manager_info {
-	struct list_head *alloc_list;
-	struct list_head *free_list;
+	struct rb_root alloc_tree;	/* allocated chunks by address */
+	struct rb_root free_tree;	/* free chunks by address */
+	struct rb_root free_size_tree;	/* free chunks by size, address */
 	char name[NAME_SIZE];
 	unsigned long start_address;
 	unsigned long size;
@@ -2,7 +2,7 @@
  * @file drivers/platform/tegra/rtcpu/capture-ivc-priv.h
  * @brief Capture IVC driver private header for T186/T194
  *
- * Copyright (c) 2017-2019 NVIDIA Corporation.  All rights reserved.
+ * Copyright (c) 2017-2022 NVIDIA Corporation.  All rights reserved.
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms and conditions of the GNU General Public License,
@@ -49,8 +49,10 @@ struct tegra_capture_ivc {
 	struct mutex cb_ctx_lock;
 	/** Channel write lock */
 	struct mutex ivc_wr_lock;
+	/** Dedicated RT worker draining the responses */
+	struct kthread_worker *worker;
 	/** Deferred work */
-	struct work_struct work;
+	struct kthread_work work;
 	/** Channel work queue head */
 	wait_queue_head_t write_q;
 	/** Array holding callbacks registered by each channel */
@@ -95,10 +97,10 @@ static struct tegra_capture_ivc *__scivc_capture;
  * @brief Worker thread to handle the asynchronous msgs on the IVC channel.
 	This will further calls callbacks registered by Channel drivers.
  *
- * @param[in]	work	work_struct pointer
+ * @param[in]	work	kthread_work pointer
  */
 static void tegra_capture_ivc_worker(
-	struct work_struct *work);
+	struct kthread_work *work);
 
 /**
  * @brief Implementation of IVC notify operation which gets called when we any
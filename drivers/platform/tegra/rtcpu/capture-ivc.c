@@ -20,6 +20,7 @@
 #include <linux/tegra-capture-ivc.h>
 
 #include <linux/completion.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -28,11 +29,25 @@
 #include <linux/tegra-ivc.h>
 #include <linux/tegra-ivc-bus.h>
 #include <linux/nospec.h>
+#include <linux/sched.h>
+#include <linux/version.h>
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#include <uapi/linux/sched/types.h>
+#endif
 
 #include <asm/barrier.h>
 
 #include "capture-ivc-priv.h"
 
+/*
+ * Frame completions are drained by a SCHED_FIFO kthread per channel instead
+ * of the shared system workqueue. It can be kept on one CPU, e.g. away from
+ * the CPU taking the HSP interrupt or next to the camera clients.
+ */
+static int worker_cpu = -1;
+module_param(worker_cpu, int, 0444);
+MODULE_PARM_DESC(worker_cpu, "CPU to run the response workers on, -1 for any");
+
 static int tegra_capture_ivc_tx(struct tegra_capture_ivc *civc,
 				const void *req, size_t len)
 {
@@ -356,7 +371,7 @@ static inline void tegra_capture_ivc_recv(struct tegra_capture_ivc *civc)
 	}
 }
 
-static void tegra_capture_ivc_worker(struct work_struct *work)
+static void tegra_capture_ivc_worker(struct kthread_work *work)
 {
 	struct tegra_capture_ivc *civc;
 	struct tegra_ivc_channel *chan;
@@ -386,11 +401,45 @@ static void tegra_capture_ivc_notify(struct tegra_ivc_channel *chan)
 
 	/* Only 1 thread can wait on write_q, rest wait for write_lock */
 	wake_up(&civc->write_q);
-	schedule_work(&civc->work);
+	kthread_queue_work(civc->worker, &civc->work);
 }
 
 #define NV(x) "nvidia," #x
 
+static int tegra_capture_ivc_create_worker(struct tegra_capture_ivc *civc,
+		const char *service)
+{
+	struct device *dev = &civc->chan->dev;
+	struct kthread_worker *worker;
+#if KERNEL_VERSION(5, 9, 0) > LINUX_VERSION_CODE
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO / 2 };
+#endif
+
+	worker = kthread_create_worker(0, "%s-ivc", service);
+	if (IS_ERR(worker)) {
+		dev_err(dev, "failed to create worker: %ld\n", PTR_ERR(worker));
+		return PTR_ERR(worker);
+	}
+
+#if KERNEL_VERSION(5, 9, 0) > LINUX_VERSION_CODE
+	sched_setscheduler_nocheck(worker->task, SCHED_FIFO, &param);
+#else
+	sched_set_fifo(worker->task);
+#endif
+
+	if (worker_cpu >= 0) {
+		if (worker_cpu < nr_cpu_ids && cpu_possible(worker_cpu))
+			set_cpus_allowed_ptr(worker->task,
+					cpumask_of(worker_cpu));
+		else
+			dev_warn(dev, "invalid worker_cpu %d\n", worker_cpu);
+	}
+
+	civc->worker = worker;
+
+	return 0;
+}
+
 static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 {
 	struct device *dev = &chan->dev;
@@ -416,7 +465,10 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 	mutex_init(&civc->ivc_wr_lock);
 
 	/* Initialize ivc_work */
-	INIT_WORK(&civc->work, tegra_capture_ivc_worker);
+	ret = tegra_capture_ivc_create_worker(civc, service);
+	if (ret)
+		return ret;
+	kthread_init_work(&civc->work, tegra_capture_ivc_worker);
 
 	/* Initialize wait queue */
 	init_waitqueue_head(&civc->write_q);
@@ -432,26 +484,36 @@ static int tegra_capture_ivc_probe(struct tegra_ivc_channel *chan)
 	tegra_ivc_channel_set_drvdata(chan, civc);
 
 	if (!strcmp("capture-control", service)) {
-		if (WARN_ON(__scivc_control != NULL))
-			return -EEXIST;
+		if (WARN_ON(__scivc_control != NULL)) {
+			ret = -EEXIST;
+			goto fail;
+		}
 		__scivc_control = civc;
 	} else if (!strcmp("capture", service)) {
-		if (WARN_ON(__scivc_capture != NULL))
-			return -EEXIST;
+		if (WARN_ON(__scivc_capture != NULL)) {
+			ret = -EEXIST;
+			goto fail;
+		}
 		__scivc_capture = civc;
 	} else {
 		dev_err(dev, "Unknown ivc channel %s\n", service);
-		return -EINVAL;
+		ret = -EINVAL;
+		goto fail;
 	}
 
 	return 0;
+
+fail:
+	kthread_destroy_worker(civc->worker);
+	return ret;
 }
 
 static void tegra_capture_ivc_remove(struct tegra_ivc_channel *chan)
 {
 	struct tegra_capture_ivc *civc = tegra_ivc_channel_get_drvdata(chan);
 
-	cancel_work_sync(&civc->work);
+	kthread_cancel_work_sync(&civc->work);
+	kthread_destroy_worker(civc->worker);
 
 	if (__scivc_control == civc)
 		__scivc_control = NULL;
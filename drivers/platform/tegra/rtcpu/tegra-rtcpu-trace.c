@@ -23,21 +23,32 @@
 #include <linux/ioport.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/kref.h>
 #include <linux/module.h>
 #include <linux/nospec.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/of_reserved_mem.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
 #include <linux/printk.h>
 #include <linux/seq_buf.h>
 #include <linux/slab.h>
 #include <linux/tegra-camera-rtcpu.h>
 #include <linux/tegra-rtcpu-trace.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include <linux/wait.h>
 #include <linux/workqueue.h>
 #include <linux/platform_device.h>
 #include <linux/nvhost.h>
 #include <asm/cacheflush.h>
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 16, 0)
+#include <uapi/linux/eventpoll.h>
+typedef unsigned int __poll_t;
+#endif
+
 #ifdef CONFIG_EVENTLIB
 #include <linux/keventlib.h>
 #include <uapi/linux/nvhost_events.h>
@@ -57,6 +68,30 @@
  * Private driver data structure
  */
 
+/* Ring indices published to "raw" readers by each flush */
+struct rtcpu_trace_raw_state {
+	u32 exception_next_idx;
+	u32 event_next_idx;
+	u32 n_exceptions;
+	u32 reserved;
+	u64 n_events;
+};
+
+/*
+ * The trace memory and the state seen by "raw" readers. Open readers and user
+ * mappings hold a reference, so it stays valid after the tracer is destroyed.
+ */
+struct rtcpu_trace_raw {
+	struct kref ref;
+	struct device *dev;
+	void *trace_memory;
+	size_t size;
+	dma_addr_t dma_handle;
+	wait_queue_head_t wait;
+	spinlock_t lock;
+	struct rtcpu_trace_raw_state state;
+};
+
 struct tegra_rtcpu_trace {
 	struct device *dev;
 	struct device_node *of_node;
@@ -87,6 +122,12 @@ struct tegra_rtcpu_trace {
 	/* worker */
 	struct delayed_work work;
 	unsigned long work_interval_jiffies;
+	unsigned long work_interval_min_jiffies;
+	unsigned long work_cur_interval_jiffies;
+
+	/* raw ring export */
+	bool decode;
+	struct rtcpu_trace_raw *raw;
 
 	/* statistics */
 	u32 n_exceptions;
@@ -120,6 +161,7 @@ static int rtcpu_trace_setup_memory(struct tegra_rtcpu_trace *tracer)
 	struct of_phandle_args reg_spec;
 	int ret;
 	void *trace_memory;
+	struct rtcpu_trace_raw *raw;
 	size_t mem_size;
 	dma_addr_t dma_addr;
 
@@ -130,15 +172,31 @@ static int rtcpu_trace_setup_memory(struct tegra_rtcpu_trace *tracer)
 		return -EINVAL;
 	}
 
+	raw = kzalloc(sizeof(*raw), GFP_KERNEL);
+	if (raw == NULL) {
+		ret = -ENOMEM;
+		goto error;
+	}
+
 	mem_size = reg_spec.args[2];
 	trace_memory = dma_alloc_coherent(dev, mem_size, &dma_addr,
 					GFP_KERNEL | __GFP_ZERO);
 	if (trace_memory == NULL) {
+		kfree(raw);
 		ret = -ENOMEM;
 		goto error;
 	}
 
+	kref_init(&raw->ref);
+	raw->dev = get_device(dev);
+	raw->trace_memory = trace_memory;
+	raw->size = mem_size;
+	raw->dma_handle = dma_addr;
+	init_waitqueue_head(&raw->wait);
+	spin_lock_init(&raw->lock);
+
 	/* Save the information */
+	tracer->raw = raw;
 	tracer->trace_memory = trace_memory;
 	tracer->trace_memory_size = mem_size;
 	tracer->dma_handle = dma_addr;
@@ -151,6 +209,22 @@ error:
 	return ret;
 }
 
+static void rtcpu_trace_raw_free(struct kref *ref)
+{
+	struct rtcpu_trace_raw *raw =
+		container_of(ref, struct rtcpu_trace_raw, ref);
+
+	dma_free_coherent(raw->dev, raw->size, raw->trace_memory,
+			raw->dma_handle);
+	put_device(raw->dev);
+	kfree(raw);
+}
+
+static void rtcpu_trace_raw_put(struct rtcpu_trace_raw *raw)
+{
+	kref_put(&raw->ref, rtcpu_trace_raw_free);
+}
+
 static void rtcpu_trace_init_memory(struct tegra_rtcpu_trace *tracer)
 {
 	/* memory map */
@@ -1126,7 +1200,8 @@ static inline void rtcpu_trace_events(struct tegra_rtcpu_trace *tracer)
 	while (old_next != new_next) {
 		event = &tracer->events[old_next];
 		last_event = event;
-		rtcpu_trace_event(tracer, event);
+		if (tracer->decode)
+			rtcpu_trace_event(tracer, event);
 		tracer->n_events++;
 
 		if (++old_next == tracer->event_entries)
@@ -1137,13 +1212,17 @@ static inline void rtcpu_trace_events(struct tegra_rtcpu_trace *tracer)
 	tracer->copy_last_event = *last_event;
 }
 
-void tegra_rtcpu_trace_flush(struct tegra_rtcpu_trace *tracer)
+/* Returns true if RTCPU produced anything since the previous flush */
+static bool rtcpu_trace_flush(struct tegra_rtcpu_trace *tracer)
 {
-	if (tracer == NULL)
-		return;
+	u64 n_events;
+	u32 n_exceptions;
 
 	mutex_lock(&tracer->lock);
 
+	n_events = tracer->n_events;
+	n_exceptions = tracer->n_exceptions;
+
 	/* invalidate the cache line for the pointers */
 	dma_sync_single_for_cpu(tracer->dev, tracer->dma_handle_pointers,
 	    CAMRTC_TRACE_NEXT_IDX_SIZE, DMA_FROM_DEVICE);
@@ -1152,20 +1231,59 @@ void tegra_rtcpu_trace_flush(struct tegra_rtcpu_trace *tracer)
 	rtcpu_trace_exceptions(tracer);
 	rtcpu_trace_events(tracer);
 
+	n_events = tracer->n_events - n_events;
+	n_exceptions = tracer->n_exceptions - n_exceptions;
+
+	if (n_events != 0 || n_exceptions != 0) {
+		struct rtcpu_trace_raw *raw = tracer->raw;
+
+		spin_lock(&raw->lock);
+		raw->state.exception_next_idx = tracer->exception_last_idx;
+		raw->state.event_next_idx = tracer->event_last_idx;
+		raw->state.n_exceptions = tracer->n_exceptions;
+		raw->state.n_events = tracer->n_events;
+		spin_unlock(&raw->lock);
+	}
+
 	mutex_unlock(&tracer->lock);
+
+	if (n_events == 0 && n_exceptions == 0)
+		return false;
+
+	wake_up_interruptible(&tracer->raw->wait);
+
+	return true;
+}
+
+void tegra_rtcpu_trace_flush(struct tegra_rtcpu_trace *tracer)
+{
+	if (tracer == NULL)
+		return;
+
+	rtcpu_trace_flush(tracer);
 }
 EXPORT_SYMBOL(tegra_rtcpu_trace_flush);
 
 static void rtcpu_trace_worker(struct work_struct *work)
 {
 	struct tegra_rtcpu_trace *tracer;
+	unsigned long interval;
 
 	tracer = container_of(work, struct tegra_rtcpu_trace, work.work);
 
-	tegra_rtcpu_trace_flush(tracer);
+	/*
+	 * Poll faster while RTCPU is producing so that bursts do not wrap
+	 * the ring, and back off to the configured interval when idle.
+	 */
+	interval = tracer->work_cur_interval_jiffies;
+	if (rtcpu_trace_flush(tracer))
+		interval = max(interval / 2, tracer->work_interval_min_jiffies);
+	else
+		interval = min(interval * 2, tracer->work_interval_jiffies);
+	tracer->work_cur_interval_jiffies = interval;
 
 	/* reschedule */
-	schedule_delayed_work(&tracer->work, tracer->work_interval_jiffies);
+	schedule_delayed_work(&tracer->work, interval);
 }
 
 /*
@@ -1257,6 +1375,158 @@ static int rtcpu_trace_debugfs_last_event_read(
 DEFINE_SEQ_FOPS(rtcpu_trace_debugfs_last_event,
 	rtcpu_trace_debugfs_last_event_read);
 
+/*
+ * Raw ring export
+ *
+ * "raw" maps the trace memory read-only: the camrtc_trace_memory_header
+ * followed by the exception and event rings, as written by RTCPU. A read
+ * returns a struct rtcpu_trace_raw_state with the ring indices seen by the
+ * last flush, and poll reports POLLIN once more entries have arrived since
+ * the previous read. Setting "decode" to 0 leaves decoding to the consumer
+ * and stops emitting the ftrace events.
+ */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0)
+struct rtcpu_trace_raw_reader {
+	struct rtcpu_trace_raw *raw;
+	u64 seen;
+};
+
+static u64 rtcpu_trace_raw_count(struct rtcpu_trace_raw *raw)
+{
+	u64 count;
+
+	spin_lock(&raw->lock);
+	count = raw->state.n_events + raw->state.n_exceptions;
+	spin_unlock(&raw->lock);
+
+	return count;
+}
+
+static int rtcpu_trace_raw_open(struct inode *inode, struct file *file)
+{
+	struct dentry *dentry = file->f_path.dentry;
+	struct tegra_rtcpu_trace *tracer;
+	struct rtcpu_trace_raw_reader *reader;
+	int ret;
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (reader == NULL)
+		return -ENOMEM;
+
+	/* "raw" is not proxied, the tracer is only valid while the file is */
+	ret = debugfs_file_get(dentry);
+	if (ret) {
+		kfree(reader);
+		return ret;
+	}
+
+	tracer = inode->i_private;
+	reader->raw = tracer->raw;
+	kref_get(&reader->raw->ref);
+
+	debugfs_file_put(dentry);
+
+	file->private_data = reader;
+
+	return nonseekable_open(inode, file);
+}
+
+static int rtcpu_trace_raw_release(struct inode *inode, struct file *file)
+{
+	struct rtcpu_trace_raw_reader *reader = file->private_data;
+
+	rtcpu_trace_raw_put(reader->raw);
+	kfree(reader);
+	return 0;
+}
+
+static ssize_t rtcpu_trace_raw_read(struct file *file, char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct rtcpu_trace_raw_reader *reader = file->private_data;
+	struct rtcpu_trace_raw *raw = reader->raw;
+	struct rtcpu_trace_raw_state state;
+
+	if (count < sizeof(state))
+		return -EINVAL;
+
+	spin_lock(&raw->lock);
+	state = raw->state;
+	spin_unlock(&raw->lock);
+
+	reader->seen = state.n_events + state.n_exceptions;
+
+	if (copy_to_user(buf, &state, sizeof(state)))
+		return -EFAULT;
+
+	return sizeof(state);
+}
+
+static __poll_t rtcpu_trace_raw_poll(struct file *file, poll_table *wait)
+{
+	struct rtcpu_trace_raw_reader *reader = file->private_data;
+	struct rtcpu_trace_raw *raw = reader->raw;
+
+	poll_wait(file, &raw->wait, wait);
+
+	if (rtcpu_trace_raw_count(raw) != reader->seen)
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static void rtcpu_trace_raw_vm_open(struct vm_area_struct *vma)
+{
+	struct rtcpu_trace_raw *raw = vma->vm_private_data;
+
+	kref_get(&raw->ref);
+}
+
+static void rtcpu_trace_raw_vm_close(struct vm_area_struct *vma)
+{
+	rtcpu_trace_raw_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct rtcpu_trace_raw_vm_ops = {
+	.open = rtcpu_trace_raw_vm_open,
+	.close = rtcpu_trace_raw_vm_close,
+};
+
+static int rtcpu_trace_raw_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct rtcpu_trace_raw_reader *reader = file->private_data;
+	struct rtcpu_trace_raw *raw = reader->raw;
+	int ret;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	ret = dma_mmap_coherent(raw->dev, vma, raw->trace_memory,
+			raw->dma_handle, raw->size);
+	if (ret)
+		return ret;
+
+	/* each mapping keeps the trace memory, it is freed on the last unmap */
+	vma->vm_private_data = raw;
+	vma->vm_ops = &rtcpu_trace_raw_vm_ops;
+	kref_get(&raw->ref);
+
+	return 0;
+}
+
+static const struct file_operations rtcpu_trace_debugfs_raw = {
+	.open = rtcpu_trace_raw_open,
+	.release = rtcpu_trace_raw_release,
+	.read = rtcpu_trace_raw_read,
+	.poll = rtcpu_trace_raw_poll,
+	.mmap = rtcpu_trace_raw_mmap,
+	.llseek = no_llseek,
+};
+#endif
+
 static void rtcpu_trace_debugfs_deinit(struct tegra_rtcpu_trace *tracer)
 {
 	debugfs_remove_recursive(tracer->debugfs_root);
@@ -1285,6 +1555,17 @@ static void rtcpu_trace_debugfs_init(struct tegra_rtcpu_trace *tracer)
 	if (IS_ERR_OR_NULL(entry))
 		goto failed_create;
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 15, 0)
+	/* the full proxy has no .mmap, the fops handle the lifetime instead */
+	entry = debugfs_create_file_unsafe("raw", S_IRUSR,
+	    tracer->debugfs_root, tracer, &rtcpu_trace_debugfs_raw);
+	if (IS_ERR_OR_NULL(entry))
+		goto failed_create;
+#endif
+
+	debugfs_create_bool("decode", S_IRUGO | S_IWUSR,
+	    tracer->debugfs_root, &tracer->decode);
+
 	return;
 
 failed_create:
@@ -1308,6 +1589,7 @@ struct tegra_rtcpu_trace *tegra_rtcpu_trace_create(struct device *dev,
 
 	tracer->dev = dev;
 	mutex_init(&tracer->lock);
+	tracer->decode = true;
 
 	/* Get the trace memory */
 	ret = rtcpu_trace_setup_memory(tracer);
@@ -1361,7 +1643,10 @@ struct tegra_rtcpu_trace *tegra_rtcpu_trace_create(struct device *dev,
 	}
 
 	INIT_DELAYED_WORK(&tracer->work, rtcpu_trace_worker);
-	tracer->work_interval_jiffies = msecs_to_jiffies(param);
+	tracer->work_interval_jiffies = max(msecs_to_jiffies(param), 1UL);
+	tracer->work_interval_min_jiffies =
+		max(tracer->work_interval_jiffies / 8, 1UL);
+	tracer->work_cur_interval_jiffies = tracer->work_interval_jiffies;
 
 	/* Done with initialization */
 	schedule_delayed_work(&tracer->work, 0);
@@ -1400,8 +1685,7 @@ void tegra_rtcpu_trace_destroy(struct tegra_rtcpu_trace *tracer)
 	cancel_delayed_work_sync(&tracer->work);
 	flush_delayed_work(&tracer->work);
 	rtcpu_trace_debugfs_deinit(tracer);
-	dma_free_coherent(tracer->dev, tracer->trace_memory_size,
-			tracer->trace_memory, tracer->dma_handle);
+	rtcpu_trace_raw_put(tracer->raw);
 	kfree(tracer);
 }
 EXPORT_SYMBOL(tegra_rtcpu_trace_destroy);
@@ -21,6 +21,8 @@
 #include <linux/fs.h>
 #include <linux/poll.h>
 #include <linux/idr.h>
+#include <linux/rcupdate.h>
+#include <linux/spinlock.h>
 #include <linux/completion.h>
 #include <linux/version.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
@@ -122,7 +124,10 @@ enum tipc_device_state {
 
 struct tipc_virtio_dev {
 	struct kref refcount;
-	struct mutex lock; /* protects access to this device */
+	struct mutex lock; /* protects device state and channel map updates */
+	struct mutex txvq_lock; /* serializes access to txvq */
+	spinlock_t buf_lock; /* protects free buffer lists */
+	atomic_t tx_queued;
 	struct virtio_device *vdev;
 	struct virtqueue *rxvq;
 	struct virtqueue *txvq;
@@ -131,6 +136,9 @@ struct tipc_virtio_dev {
 	size_t msg_buf_max_sz;
 	uint free_msg_buf_cnt;
 	struct list_head free_buf_list;
+	uint rx_free_cnt;
+	uint rx_cache_max;
+	struct list_head rx_free_list;
 	wait_queue_head_t sendq;
 	struct idr addr_idr;
 	enum tipc_device_state state;
@@ -157,6 +165,7 @@ struct tipc_chan {
 	u32 max_msg_size;
 	u32 max_msg_cnt;
 	char srv_name[MAX_SRV_NAME_LEN];
+	struct rcu_head rcu;
 };
 
 static struct class *tipc_class;
@@ -249,18 +258,47 @@ static void _free_chan(struct kref *kref)
 		ch->ops->handle_release(ch->ops_arg);
 
 	kref_put(&ch->vds->refcount, _free_vds);
-	kfree(ch);
+	/* vds_lookup_channel() may still be looking at it */
+	kfree_rcu(ch, rcu);
 }
 
+/*
+ * Rx buffers handed out to channels are recycled through a small cache,
+ * bounded by the rx ring size, instead of going back to the page allocator
+ * for every received message.
+ */
 static struct tipc_msg_buf *vds_alloc_msg_buf(struct tipc_virtio_dev *vds)
 {
-	return _alloc_msg_buf(vds->msg_buf_max_sz);
+	struct tipc_msg_buf *mb;
+
+	spin_lock(&vds->buf_lock);
+	mb = list_first_entry_or_null(&vds->rx_free_list,
+				      struct tipc_msg_buf, node);
+	if (mb) {
+		list_del(&mb->node);
+		vds->rx_free_cnt--;
+	}
+	spin_unlock(&vds->buf_lock);
+
+	if (!mb)
+		mb = _alloc_msg_buf(vds->msg_buf_max_sz);
+
+	return mb;
 }
 
 static void vds_free_msg_buf(struct tipc_virtio_dev *vds,
 			     struct tipc_msg_buf *mb)
 {
-	_free_msg_buf(mb);
+	spin_lock(&vds->buf_lock);
+	if (vds->rx_free_cnt < vds->rx_cache_max) {
+		list_add(&mb->node, &vds->rx_free_list);
+		vds->rx_free_cnt++;
+		mb = NULL;
+	}
+	spin_unlock(&vds->buf_lock);
+
+	if (mb)
+		_free_msg_buf(mb);
 }
 
 static bool _put_txbuf_locked(struct tipc_virtio_dev *vds,
@@ -270,50 +308,48 @@ static bool _put_txbuf_locked(struct tipc_virtio_dev *vds,
 	return vds->free_msg_buf_cnt++ == 0;
 }
 
-static struct tipc_msg_buf *_get_txbuf_locked(struct tipc_virtio_dev *vds)
+static struct tipc_msg_buf *_vds_get_txbuf(struct tipc_virtio_dev *vds)
 {
-	struct tipc_msg_buf *mb;
-
-	if (vds->state != VDS_ONLINE)
-		return  ERR_PTR(-ENODEV);
+	struct tipc_msg_buf *mb = NULL;
 
-	if (vds->free_msg_buf_cnt) {
+	spin_lock(&vds->buf_lock);
+	if (READ_ONCE(vds->state) != VDS_ONLINE) {
+		mb = ERR_PTR(-ENODEV);
+	} else if (vds->free_msg_buf_cnt) {
 		/* take it out of free list */
 		mb = list_first_entry(&vds->free_buf_list,
 				      struct tipc_msg_buf, node);
 		list_del(&mb->node);
 		vds->free_msg_buf_cnt--;
+	} else if (vds->msg_buf_cnt >= vds->msg_buf_max_cnt) {
+		mb = ERR_PTR(-EAGAIN);
 	} else {
-		if (vds->msg_buf_cnt >= vds->msg_buf_max_cnt)
-			return ERR_PTR(-EAGAIN);
-
-		/* try to allocate it */
-		mb = _alloc_msg_buf(vds->msg_buf_max_sz);
-		if (!mb)
-			return ERR_PTR(-ENOMEM);
-
+		/* reserve a slot and allocate outside of the lock */
 		vds->msg_buf_cnt++;
 	}
-	return mb;
-}
+	spin_unlock(&vds->buf_lock);
 
-static struct tipc_msg_buf *_vds_get_txbuf(struct tipc_virtio_dev *vds)
-{
-	struct tipc_msg_buf *mb;
+	if (mb)
+		return mb;
 
-	mutex_lock(&vds->lock);
-	mb = _get_txbuf_locked(vds);
-	mutex_unlock(&vds->lock);
+	mb = _alloc_msg_buf(vds->msg_buf_max_sz);
+	if (!mb) {
+		spin_lock(&vds->buf_lock);
+		vds->msg_buf_cnt--;
+		spin_unlock(&vds->buf_lock);
+		return ERR_PTR(-ENOMEM);
+	}
 
 	return mb;
 }
 
 static void vds_put_txbuf(struct tipc_virtio_dev *vds, struct tipc_msg_buf *mb)
 {
-	mutex_lock(&vds->lock);
+	spin_lock(&vds->buf_lock);
 	_put_txbuf_locked(vds, mb);
+	spin_unlock(&vds->buf_lock);
+
 	wake_up_interruptible(&vds->sendq);
-	mutex_unlock(&vds->lock);
 }
 
 static struct tipc_msg_buf *vds_get_txbuf(struct tipc_virtio_dev *vds,
@@ -367,15 +403,22 @@ static int vds_queue_txbuf(struct tipc_virtio_dev *vds,
 	struct scatterlist sg;
 	bool need_notify = false;
 
-	mutex_lock(&vds->lock);
+	/*
+	 * Senders racing for txvq_lock are batched: only the last one to
+	 * add its buffer kicks the queue, on behalf of all of them.
+	 */
+	atomic_inc(&vds->tx_queued);
+
+	mutex_lock(&vds->txvq_lock);
 	if (vds->state == VDS_ONLINE) {
 		sg_init_one(&sg, mb->buf_va, mb->wpos);
 		err = virtqueue_add_outbuf(vds->txvq, &sg, 1, mb, GFP_KERNEL);
-		need_notify = virtqueue_kick_prepare(vds->txvq);
 	} else {
 		err = -ENODEV;
 	}
-	mutex_unlock(&vds->lock);
+	if (atomic_dec_and_test(&vds->tx_queued))
+		need_notify = virtqueue_kick_prepare(vds->txvq);
+	mutex_unlock(&vds->txvq_lock);
 
 	if (need_notify)
 		virtqueue_notify(vds->txvq);
@@ -425,17 +468,23 @@ static struct tipc_chan *vds_lookup_channel(struct tipc_virtio_dev *vds,
 	int id;
 	struct tipc_chan *chan = NULL;
 
-	mutex_lock(&vds->lock);
 	if (addr == TIPC_ANY_ADDR) {
+		mutex_lock(&vds->lock);
 		id = idr_for_each(&vds->addr_idr, _match_any, NULL);
 		if (id > 0)
 			chan = idr_find(&vds->addr_idr, id);
-	} else {
-		chan = idr_find(&vds->addr_idr, addr);
+		if (chan)
+			kref_get(&chan->refcount);
+		mutex_unlock(&vds->lock);
+		return chan;
 	}
-	if (chan)
-		kref_get(&chan->refcount);
-	mutex_unlock(&vds->lock);
+
+	/* lockless lookup; channels are freed after an RCU grace period */
+	rcu_read_lock();
+	chan = idr_find(&vds->addr_idr, addr);
+	if (chan && !kref_get_unless_zero(&chan->refcount))
+		chan = NULL;
+	rcu_read_unlock();
 
 	return chan;
 }
@@ -1281,8 +1330,10 @@ static void destroy_cdev_node(struct tipc_virtio_dev *vds,
 static void _go_online(struct tipc_virtio_dev *vds)
 {
 	mutex_lock(&vds->lock);
+	mutex_lock(&vds->txvq_lock);
 	if (vds->state == VDS_OFFLINE)
 		vds->state = VDS_ONLINE;
+	mutex_unlock(&vds->txvq_lock);
 	mutex_unlock(&vds->lock);
 
 	create_cdev_node(vds, &vds->cdev_node);
@@ -1300,7 +1351,9 @@ static void _go_offline(struct tipc_virtio_dev *vds)
 		mutex_unlock(&vds->lock);
 		return;
 	}
+	mutex_lock(&vds->txvq_lock);
 	vds->state = VDS_OFFLINE;
+	mutex_unlock(&vds->txvq_lock);
 	mutex_unlock(&vds->lock);
 
 	/* wakeup all waiters */
@@ -1519,17 +1572,29 @@ static void _rxvq_cb(struct virtqueue *rxvq)
 static void _txvq_cb(struct virtqueue *txvq)
 {
 	unsigned int len;
+	uint cnt = 0;
 	struct tipc_msg_buf *mb;
 	bool need_wakeup = false;
 	struct tipc_virtio_dev *vds = txvq->vdev->priv;
+	LIST_HEAD(done);
 
 	dev_dbg(&txvq->vdev->dev, "%s\n", __func__);
 
 	/* detach all buffers */
-	mutex_lock(&vds->lock);
-	while ((mb = virtqueue_get_buf(txvq, &len)) != NULL)
-		need_wakeup |= _put_txbuf_locked(vds, mb);
-	mutex_unlock(&vds->lock);
+	mutex_lock(&vds->txvq_lock);
+	while ((mb = virtqueue_get_buf(txvq, &len)) != NULL) {
+		list_add_tail(&mb->node, &done);
+		cnt++;
+	}
+	mutex_unlock(&vds->txvq_lock);
+
+	if (cnt) {
+		spin_lock(&vds->buf_lock);
+		need_wakeup = !vds->free_msg_buf_cnt;
+		list_splice_tail(&done, &vds->free_buf_list);
+		vds->free_msg_buf_cnt += cnt;
+		spin_unlock(&vds->buf_lock);
+	}
 
 	if (need_wakeup) {
 		/* wake up potential senders waiting for a tx buffer */
@@ -1558,9 +1623,13 @@ static int tipc_virtio_probe(struct virtio_device *vdev)
 	vds->vdev = vdev;
 
 	mutex_init(&vds->lock);
+	mutex_init(&vds->txvq_lock);
+	spin_lock_init(&vds->buf_lock);
+	atomic_set(&vds->tx_queued, 0);
 	kref_init(&vds->refcount);
 	init_waitqueue_head(&vds->sendq);
 	INIT_LIST_HEAD(&vds->free_buf_list);
+	INIT_LIST_HEAD(&vds->rx_free_list);
 	idr_init(&vds->addr_idr);
 
 	/* set default max message size and alignment */
@@ -1590,6 +1659,7 @@ static int tipc_virtio_probe(struct virtio_device *vdev)
 	/* save max buffer size and count */
 	vds->msg_buf_max_sz = config.msg_buf_max_size;
 	vds->msg_buf_max_cnt = virtqueue_get_vring_size(vds->txvq);
+	vds->rx_cache_max = virtqueue_get_vring_size(vds->rxvq);
 
 	/* set up the receive buffers */
 	for (i = 0; i < virtqueue_get_vring_size(vds->rxvq); i++) {
@@ -1624,11 +1694,14 @@ err_find_vqs:
 static void tipc_virtio_remove(struct virtio_device *vdev)
 {
 	struct tipc_virtio_dev *vds = vdev->priv;
+	LIST_HEAD(rx_free);
 
 	_go_offline(vds);
 
 	mutex_lock(&vds->lock);
+	mutex_lock(&vds->txvq_lock);
 	vds->state = VDS_DEAD;
+	mutex_unlock(&vds->txvq_lock);
 	mutex_unlock(&vds->lock);
 
 	vdev->config->reset(vdev);
@@ -1639,6 +1712,14 @@ static void tipc_virtio_remove(struct virtio_device *vdev)
 	_cleanup_vq(vds->txvq);
 	_free_msg_buf_list(&vds->free_buf_list);
 
+	/* stop caching rx buffers still held by channels */
+	spin_lock(&vds->buf_lock);
+	vds->rx_cache_max = 0;
+	list_splice_init(&vds->rx_free_list, &rx_free);
+	vds->rx_free_cnt = 0;
+	spin_unlock(&vds->buf_lock);
+	_free_msg_buf_list(&rx_free);
+
 	vdev->config->del_vqs(vds->vdev);
 
 	mutex_lock(&vds->lock);
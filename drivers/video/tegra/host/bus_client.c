@@ -247,6 +247,7 @@ int nvhost_write_module_regs(struct platform_device *ndev,
 struct nvhost_channel_userctx {
 	struct nvhost_channel *ch;
 	u32 timeout;
+	u32 deadline_us;
 	int clientid;
 	bool timeout_debug_dump;
 	struct platform_device *pdev;
@@ -828,6 +829,9 @@ static int nvhost_ioctl_channel_submit(struct nvhost_channel_userctx *ctx,
 		job->timeout = ctx->timeout;
 	job->timeout_debug_dump = ctx->timeout_debug_dump;
 
+	if (ctx->deadline_us)
+		job->deadline = ktime_add_us(ktime_get(), ctx->deadline_us);
+
 	err = nvhost_channel_submit(job);
 	if (err)
 		goto unpin_job;
@@ -1464,6 +1468,10 @@ static long nvhost_channelctl(struct file *filp,
 			__func__, priv->timeout, priv);
 		break;
 	}
+	case NVHOST_IOCTL_CHANNEL_SET_DEADLINE:
+		priv->deadline_us =
+			((struct nvhost_set_deadline_args *)buf)->deadline_us;
+		break;
 	case NVHOST_IOCTL_CHANNEL_SET_SYNCPOINT_NAME:
 	{
 		err = nvhost_ioctl_channel_set_syncpoint_name(priv,
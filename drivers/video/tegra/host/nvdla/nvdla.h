@@ -308,6 +308,7 @@ struct nvdla_emu_task {
  * @buf_size		Total size of task dma alloc
  * @timeout		max timeout to wait for task completion
  * @op_handle		pointer to handle list of operation descriptor
+ * @tmpl		template the task is launched from, if any
  *
  */
 struct nvdla_task {
@@ -338,6 +339,7 @@ struct nvdla_task {
 	size_t buf_size;
 	int timeout;
 	int pool_index;
+	struct nvdla_task_template *tmpl;
 
 	struct dma_buf *memory_dmabuf[MAX_NVDLA_BUFFERS_PER_TASK];
 	struct dma_buf *prefences_sem_dmabuf[MAX_NVDLA_PREFENCES_PER_TASK];
@@ -353,6 +355,29 @@ struct dla_mem_addr {
 	uint64_t val;
 };
 
+/**
+ * struct nvdla_task_template:	task registered once and launched many times
+ *
+ * @ref			Reference count, held by the owner and by launched tasks
+ * @id			Identifier given to user space
+ * @buffers		nvhost buffers the template is pinned from
+ * @unpin_gen		buffers->unpin_gen when the handles were last validated
+ * @task		Task parameters, without fences
+ * @num_handles		Number of pinned handles
+ * @handles		Handles pinned for the lifetime of the template
+ * @addresses		Address list resolved at creation time
+ */
+struct nvdla_task_template {
+	struct kref ref;
+	u32 id;
+	struct nvdla_buffers *buffers;
+	u32 unpin_gen;
+	struct nvdla_task task;
+	u32 num_handles;
+	u32 handles[MAX_NVDLA_BUFFERS_PER_TASK];
+	struct dla_mem_addr addresses[MAX_NVDLA_BUFFERS_PER_TASK];
+};
+
 extern const struct file_operations tegra_nvdla_ctrl_ops;
 extern struct nvdla_queue_ops nvdla_queue_ops;
 
@@ -468,6 +493,12 @@ int nvdla_free_gcov_region(struct platform_device *pdev, bool update_region);
 
 int nvdla_emulator_submit(struct nvdla_queue *queue,
 				struct nvdla_emu_task *task);
+int nvdla_emulator_submit_task(struct nvdla_queue *queue,
+				struct nvdla_task *task);
+int nvdla_task_template_pin(struct nvdla_task_template *tmpl);
+void nvdla_task_template_get(struct nvdla_task_template *tmpl);
+void nvdla_task_template_put(struct nvdla_task_template *tmpl);
+int nvdla_task_template_validate(struct nvdla_task_template *tmpl);
 void task_free(struct kref *ref);
 int nvdla_get_signal_fences(struct nvdla_queue *queue, void *in_task);
 
@@ -385,6 +385,9 @@ void nvdla_buffer_unpin(struct nvdla_buffers *nvdla_buffers,
 
 		if (vm->user_map_count-- < 0)
 			vm->user_map_count = 0;
+		if (vm->user_map_count <= 0)
+			WRITE_ONCE(nvdla_buffers->unpin_gen,
+				   nvdla_buffers->unpin_gen + 1);
 		nvdla_buffer_unmap(nvdla_buffers, vm);
 	}
 	spec_bar(); /* break_spec_p#5_1 */
@@ -392,6 +395,29 @@ void nvdla_buffer_unpin(struct nvdla_buffers *nvdla_buffers,
 	mutex_unlock(&nvdla_buffers->mutex);
 }
 
+bool nvdla_buffer_user_pinned(struct nvdla_buffers *nvdla_buffers,
+				u32 *handles, u32 count)
+{
+	struct nvdla_vm_buffer *vm;
+	bool pinned = true;
+	int i = 0;
+
+	mutex_lock(&nvdla_buffers->mutex);
+
+	for (i = 0; i < count; i++) {
+		vm = nvdla_find_map_buffer(nvdla_buffers, handles[i]);
+		if ((vm == NULL) || (vm->user_map_count <= 0)) {
+			pinned = false;
+			break;
+		}
+	}
+	spec_bar(); /* break_spec_p#5_1 */
+
+	mutex_unlock(&nvdla_buffers->mutex);
+
+	return pinned;
+}
+
 void nvdla_buffer_release(struct nvdla_buffers *nvdla_buffers)
 {
 	struct nvdla_vm_buffer *vm, *n;
@@ -35,6 +35,8 @@ enum nvdla_buffers_heap {
  * list			List for traversing through all the buffers
  * mutex		Mutex for the buffer tree and the buffer list
  * kref			Reference count for the bufferlist
+ * unpin_gen		Bumped each time user space drops its last pin on a
+ *			buffer, used to revalidate cached buffer lookups
  *
  */
 struct nvdla_buffers {
@@ -45,6 +47,7 @@ struct nvdla_buffers {
 	struct mutex mutex;
 
 	struct kref kref;
+	u32 unpin_gen;
 };
 
 /**
@@ -148,6 +151,22 @@ int nvdla_buffer_submit_pin(struct nvdla_buffers *nvdla_buffers,
 void nvdla_buffer_submit_unpin(struct nvdla_buffers *nvdla_buffers,
 					u32 *handles, u32 count);
 
+/**
+ * @brief		Checks that user space still pins a list of buffers.
+ *
+ * Buffers held by a submit pin stay mapped after user space unpins them.
+ * This function is used to find out whether a list of such buffers is
+ * still valid from the user point of view.
+ *
+ * @param nvdla_buffers		Pointer to nvdla_buffer struct
+ * @param handles		Pointer to MemHandle list
+ * @param count			Number of memhandles in the list
+ * @return			true if every buffer is still pinned by user
+ *
+ */
+bool nvdla_buffer_user_pinned(struct nvdla_buffers *nvdla_buffers,
+					u32 *handles, u32 count);
+
 /**
  * @brief			Drop a user reference to buffer structure
  *
@@ -18,6 +18,8 @@
 
 #include <linux/arm64-barrier.h>
 #include <linux/fs.h>
+#include <linux/idr.h>
+#include <linux/mm.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
@@ -38,12 +40,16 @@
  * @pdev		pointer to platform device
  * @queue		pointer to nvdla_queue
  * @buffers		pointer to nvdla_buffer
+ * @templates		task templates registered through this FD
+ * @template_lock	lock for the template idr
  */
 
 struct nvdla_private {
 	struct platform_device *pdev;
 	struct nvdla_queue *queue;
 	struct nvdla_buffers *buffers;
+	struct idr templates;
+	struct mutex template_lock;
 };
 
 static int nvdla_get_fw_ver(struct nvdla_private *priv,
@@ -707,6 +713,7 @@ static int nvdla_fill_task(struct nvdla_queue *queue,
 	 /* initialize task parameters */
 	task->queue = queue;
 	task->buffers = buffers;
+	task->tmpl = NULL;
 
 	err = nvdla_val_task_submit_input(local_task);
 	if (err) {
@@ -1122,7 +1129,10 @@ static int nvdla_submit(struct nvdla_private *priv, void *arg)
 		nvdla_dbg_info(pdev, "postfences of task[%d] update", i + 1);
 
 		/* send job to engine through queue framework */
-		err = nvdla_queue_submit(queue, task);
+		if (args->flags & NVDLA_SUBMIT_FLAGS_EMULATE)
+			err = nvdla_emulator_submit_task(queue, task);
+		else
+			err = nvdla_queue_submit(queue, task);
 		if (err) {
 			nvdla_dbg_err(pdev, "fail to submit task: %d", i + 1);
 			goto fail_to_submit_task;
@@ -1155,6 +1165,299 @@ fail_to_copy_task:
 	return err;
 }
 
+static int nvdla_create_template(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_template_args *args =
+			(struct nvdla_template_args *)arg;
+	struct nvdla_ioctl_submit_task local_task;
+	struct nvdla_task_template *tmpl;
+	struct platform_device *pdev;
+	struct nvdla_queue *queue;
+	struct nvdla_buffers *buffers;
+	int err = 0;
+
+	if (!args || !priv)
+		return -EINVAL;
+
+	pdev = priv->pdev;
+	queue = priv->queue;
+	buffers = priv->buffers;
+	if (!(queue && pdev && buffers))
+		return -EINVAL;
+
+	nvdla_dbg_fn(pdev, "inside template create");
+
+	if (copy_from_user(&local_task, (void __user *)(uintptr_t)args->task,
+			   sizeof(local_task)))
+		return -EFAULT;
+
+	/* fences are given on every launch */
+	if (local_task.num_prefences || local_task.num_postfences) {
+		nvdla_dbg_err(pdev, "template must not carry fences");
+		return -EINVAL;
+	}
+
+	tmpl = kvzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl)
+		return -ENOMEM;
+
+	kref_init(&tmpl->ref);
+	tmpl->buffers = buffers;
+
+	err = nvdla_fill_task(queue, buffers, &local_task, &tmpl->task);
+	if (err) {
+		nvdla_dbg_err(pdev, "failed to fill template task");
+		goto fail;
+	}
+
+	/* pin buffers and resolve the address list once */
+	err = nvdla_task_template_pin(tmpl);
+	if (err) {
+		nvdla_dbg_err(pdev, "failed to pin template");
+		goto fail;
+	}
+
+	mutex_lock(&priv->template_lock);
+	err = idr_alloc(&priv->templates, tmpl, 1, 0, GFP_KERNEL);
+	mutex_unlock(&priv->template_lock);
+	if (err < 0)
+		goto fail;
+
+	tmpl->id = err;
+	args->id = tmpl->id;
+
+	nvdla_dbg_info(pdev, "template[%u] created, %u buffers pinned",
+			tmpl->id, tmpl->num_handles);
+
+	return 0;
+
+fail:
+	nvdla_task_template_put(tmpl);
+	return err;
+}
+
+static int nvdla_destroy_template(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_template_args *args =
+			(struct nvdla_template_args *)arg;
+	struct nvdla_task_template *tmpl;
+
+	if (!args || !priv)
+		return -EINVAL;
+
+	mutex_lock(&priv->template_lock);
+	tmpl = idr_remove(&priv->templates, args->id);
+	mutex_unlock(&priv->template_lock);
+	if (!tmpl)
+		return -EINVAL;
+
+	/* tasks in flight keep the buffers pinned until they complete */
+	nvdla_task_template_put(tmpl);
+
+	return 0;
+}
+
+static int nvdla_fill_task_from_template(struct nvdla_queue *queue,
+				struct nvdla_task_template *tmpl,
+				struct nvdla_ioctl_template_task *local_task,
+				struct nvdla_task *task)
+{
+	struct nvdla_task *proto = &tmpl->task;
+	struct platform_device *pdev = queue->pool->pdev;
+
+	if (local_task->num_prefences > MAX_NVDLA_PREFENCES_PER_TASK ||
+	    local_task->num_postfences > MAX_NVDLA_POSTFENCES_PER_TASK) {
+		nvdla_dbg_err(pdev, "fences[%u/%u] crossing expected[%d/%d]",
+			local_task->num_prefences, local_task->num_postfences,
+			MAX_NVDLA_PREFENCES_PER_TASK,
+			MAX_NVDLA_POSTFENCES_PER_TASK);
+		return -EINVAL;
+	}
+
+	task->queue = queue;
+	task->buffers = tmpl->buffers;
+	task->tmpl = NULL;
+
+	task->num_prefences = local_task->num_prefences;
+	task->num_postfences = local_task->num_postfences;
+	task->num_in_task_status = proto->num_in_task_status;
+	task->num_sof_task_status = proto->num_sof_task_status;
+	task->num_eof_task_status = proto->num_eof_task_status;
+	task->num_sof_timestamps = proto->num_sof_timestamps;
+	task->num_eof_timestamps = proto->num_eof_timestamps;
+	task->num_addresses = proto->num_addresses;
+	task->timeout = local_task->timeout ? local_task->timeout :
+			proto->timeout;
+
+	memcpy(task->in_task_status, proto->in_task_status,
+	       task->num_in_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->sof_task_status, proto->sof_task_status,
+	       task->num_sof_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->eof_task_status, proto->eof_task_status,
+	       task->num_eof_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->sof_timestamps, proto->sof_timestamps,
+	       task->num_sof_timestamps * sizeof(struct nvdla_mem_handle));
+	memcpy(task->eof_timestamps, proto->eof_timestamps,
+	       task->num_eof_timestamps * sizeof(struct nvdla_mem_handle));
+
+	/* get pre fences */
+	if (copy_from_user(task->prefences,
+		(void __user *)local_task->prefences,
+		(task->num_prefences * sizeof(struct nvdev_fence)))) {
+		nvdla_dbg_err(pdev, "failed to copy prefences");
+		return -EFAULT;
+	}
+
+	/* get post fences */
+	if (copy_from_user(task->postfences,
+		(void __user *)local_task->postfences,
+		(task->num_postfences * sizeof(struct nvdev_fence)))) {
+		nvdla_dbg_err(pdev, "failed to copy postfences");
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int nvdla_template_submit(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_submit_args *args =
+			(struct nvdla_submit_args *)arg;
+	struct nvdla_ioctl_template_task __user *user_tasks;
+	struct nvdla_ioctl_template_task local_task;
+	struct nvdla_ioctl_submit_task fence_task;
+	struct nvdla_task_template *tmpl;
+	struct platform_device *pdev;
+	struct nvdla_queue *queue;
+	u32 num_tasks;
+	struct nvdla_task *task = NULL; // task under submission
+	int err = 0, i = 0;
+	bool bypass_exec;
+
+	if (!args || !priv)
+		return -EINVAL;
+
+	pdev = priv->pdev;
+	queue = priv->queue;
+	if (!(queue && pdev))
+		return -EINVAL;
+
+	nvdla_dbg_fn(pdev, "inside template submit");
+
+	user_tasks = (struct nvdla_ioctl_template_task __user *)
+			(uintptr_t)args->tasks;
+	if (!user_tasks)
+		return -EINVAL;
+
+	num_tasks = args->num_tasks;
+	if (num_tasks == 0 || num_tasks > MAX_NVDLA_TASKS_PER_SUBMIT)
+		return -EINVAL;
+
+	bypass_exec = ((args->flags & NVDLA_SUBMIT_FLAGS_BYPASS_EXEC) != 0U);
+
+	for (i = 0; i < num_tasks; i++) {
+		/* IOCTL copy descriptor */
+		if (copy_from_user(&local_task, (void __user *)&user_tasks[i],
+				   sizeof(*user_tasks))) {
+			err = -EFAULT;
+			goto fail_to_copy_task;
+		}
+
+		mutex_lock(&priv->template_lock);
+		tmpl = idr_find(&priv->templates, local_task.id);
+		if (tmpl)
+			nvdla_task_template_get(tmpl);
+		mutex_unlock(&priv->template_lock);
+		if (!tmpl) {
+			nvdla_dbg_err(pdev, "invalid template[%u]",
+					local_task.id);
+			err = -EINVAL;
+			goto fail_to_copy_task;
+		}
+
+		/* a buffer of the template may have been freed by user */
+		err = nvdla_task_template_validate(tmpl);
+		if (err) {
+			nvdla_dbg_err(pdev, "template[%u] is stale",
+					local_task.id);
+			goto fail_to_get_task_mem;
+		}
+
+		err = nvdla_get_task_mem(queue, &task);
+		if (err) {
+			nvdla_dbg_err(pdev, "failed to get task[%d] mem", i + 1);
+			goto fail_to_get_task_mem;
+		}
+
+		/* Initialize ref for task submit preparation */
+		kref_init(&task->ref);
+
+		err = nvdla_fill_task_from_template(queue, tmpl, &local_task,
+						    task);
+		if (err) {
+			nvdla_dbg_err(pdev, "failed to fill task[%d]", i + 1);
+			goto fail_to_fill_task;
+		}
+
+		/* task owns the template reference from now on */
+		task->tmpl = tmpl;
+
+		err = nvdla_fill_task_desc(task, bypass_exec);
+		if (err) {
+			nvdla_dbg_err(pdev, "fail to fill task desc%d", i + 1);
+			goto fail_to_fill_task_desc;
+		}
+
+		/* get expected signal fences prior to submit */
+		err = nvdla_get_signal_fences(queue, task);
+		if (err) {
+			nvdla_dbg_err(pdev, "fail to get fences%d", i + 1);
+			goto fail_to_get_fences;
+		}
+
+		/* update fences to user */
+		fence_task.prefences = local_task.prefences;
+		fence_task.postfences = local_task.postfences;
+		err = nvdla_update_signal_fences(task, &fence_task);
+		if (err) {
+			nvdla_dbg_err(pdev, "fail update postfence%d", i + 1);
+			goto fail_to_get_fences;
+		}
+
+		/* send job to engine through queue framework */
+		if (args->flags & NVDLA_SUBMIT_FLAGS_EMULATE)
+			err = nvdla_emulator_submit_task(queue, task);
+		else
+			err = nvdla_queue_submit(queue, task);
+		/* a failed submit already released the task memory */
+		if (err) {
+			nvdla_dbg_err(pdev, "fail to submit task: %d", i + 1);
+			goto fail_to_fill_task_desc;
+		}
+		nvdla_dbg_info(pdev, "task[%d] submitted", i + 1);
+		kref_put(&task->ref, task_free);
+	}
+	nvdla_dbg_fn(pdev, "Template tasks submitted, done!");
+
+	return 0;
+
+fail_to_fill_task:
+	kref_put(&task->ref, task_free);
+fail_to_get_task_mem:
+	nvdla_task_template_put(tmpl);
+	return err;
+
+fail_to_get_fences:
+	/* task was never submitted, nothing else drops its template ref */
+	nvdla_task_template_put(task->tmpl);
+	task->tmpl = NULL;
+fail_to_fill_task_desc:
+	/* Remove ref corresponding task submit preparation */
+	kref_put(&task->ref, task_free);
+fail_to_copy_task:
+	return err;
+}
+
 static long nvdla_ioctl(struct file *file, unsigned int cmd,
 			unsigned long arg)
 {
@@ -1224,6 +1527,15 @@ static long nvdla_ioctl(struct file *file, unsigned int cmd,
 	case NVDLA_IOCTL_RELEASE_QUEUE:
 		err = nvdla_queue_release_handler(priv, (void*)buf);
 		break;
+	case NVDLA_IOCTL_CREATE_TEMPLATE:
+		err = nvdla_create_template(priv, (void *)buf);
+		break;
+	case NVDLA_IOCTL_DESTROY_TEMPLATE:
+		err = nvdla_destroy_template(priv, (void *)buf);
+		break;
+	case NVDLA_IOCTL_TEMPLATE_SUBMIT:
+		err = nvdla_template_submit(priv, (void *)buf);
+		break;
 	default:
 		nvdla_dbg_err(pdev, "invalid IOCTL CMD");
 		err = -ENOIOCTLCMD;
@@ -1280,6 +1592,9 @@ static int nvdla_open(struct inode *inode, struct file *file)
 	/* Zero out explicitly */
 	priv->queue = NULL;
 
+	idr_init(&priv->templates);
+	mutex_init(&priv->template_lock);
+
 	/**
 	 * Platform device corresponding to buffers is deferred
 	 * to queue allocation.
@@ -1306,6 +1621,8 @@ static int nvdla_release(struct inode *inode, struct file *file)
 {
 	struct nvdla_private *priv = file->private_data;
 	struct platform_device *pdev = priv->pdev;
+	struct nvdla_task_template *tmpl;
+	int id;
 
 	nvdla_dbg_fn(pdev, "priv:%p", priv);
 
@@ -1319,6 +1636,11 @@ static int nvdla_release(struct inode *inode, struct file *file)
 		nvdla_queue_release_handler(priv, NULL);
 	}
 
+	/* drop templates, tasks still in flight hold their own reference */
+	idr_for_each_entry(&priv->templates, tmpl, id)
+		nvdla_task_template_put(tmpl);
+	idr_destroy(&priv->templates);
+
 	nvdla_buffer_release(priv->buffers);
 	nvhost_module_remove_client(pdev, priv);
 
@@ -18,6 +18,7 @@
 
 #include <linux/arm64-barrier.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-buf.h>
@@ -172,6 +173,13 @@ static int nvdla_unmap_task_memory(struct nvdla_task *task)
 
 	nvdla_dbg_fn(pdev, "task:[%p]", task);
 
+	/* address list of a template stays pinned by the template */
+	if (task->tmpl) {
+		nvdla_task_template_put(task->tmpl);
+		task->tmpl = NULL;
+		goto unmap_actions;
+	}
+
 	/* unpin address list */
 	for (ii = 0; ii < task->num_addresses; ii++) {
 		if (task->memory_handles[ii].type ==
@@ -186,6 +194,7 @@ static int nvdla_unmap_task_memory(struct nvdla_task *task)
 	}
 	nvdla_dbg_fn(pdev, "all mem handles unmaped");
 
+unmap_actions:
 	/* unpin prefences memory */
 	for (ii = 0; ii < task->num_prefences; ii++) {
 		if ((task->prefences[ii].type == NVDEV_FENCE_TYPE_SEMAPHORE ||
@@ -523,6 +532,13 @@ static int nvdla_map_task_memory(struct nvdla_task *task)
 	task_desc->address_list = (uint64_t)((u8 *)task->task_desc_pa + offset);
 	task_desc->num_addresses = task->num_addresses;
 
+	/* address list of a template is resolved already */
+	if (task->tmpl) {
+		memcpy(next, task->tmpl->addresses,
+		       task->num_addresses * sizeof(struct dla_mem_addr));
+		return 0;
+	}
+
 	/* update address list with all dma */
 	for (jj = 0; jj < task->num_addresses; jj++) {
 		dma_addr_t dma_addr;
@@ -562,6 +578,106 @@ fail_to_pin_mem:
 	return err;
 }
 
+static void nvdla_task_template_free(struct kref *ref)
+{
+	struct nvdla_task_template *tmpl =
+		container_of(ref, struct nvdla_task_template, ref);
+
+	if (tmpl->num_handles)
+		nvdla_buffer_submit_unpin(tmpl->buffers, tmpl->handles,
+					  tmpl->num_handles);
+
+	kvfree(tmpl);
+}
+
+void nvdla_task_template_get(struct nvdla_task_template *tmpl)
+{
+	kref_get(&tmpl->ref);
+}
+
+void nvdla_task_template_put(struct nvdla_task_template *tmpl)
+{
+	kref_put(&tmpl->ref, nvdla_task_template_free);
+}
+
+int nvdla_task_template_pin(struct nvdla_task_template *tmpl)
+{
+	struct nvdla_task *task = &tmpl->task;
+	struct platform_device *pdev = task->queue->pool->pdev;
+	dma_addr_t *dma_addr;
+	size_t *dma_size;
+	u32 jj, n = 0;
+	int err = 0;
+
+	dma_addr = kcalloc(task->num_addresses, sizeof(*dma_addr), GFP_KERNEL);
+	dma_size = kcalloc(task->num_addresses, sizeof(*dma_size), GFP_KERNEL);
+	if (!dma_addr || !dma_size) {
+		err = -ENOMEM;
+		goto fail;
+	}
+
+	for (jj = 0; jj < task->num_addresses; jj++) {
+		if (task->memory_handles[jj].type ==
+				NVDLA_BUFFER_TYPE_INTERNAL)
+			continue;
+
+		if (!task->memory_handles[jj].handle) {
+			err = -EFAULT;
+			goto fail;
+		}
+
+		tmpl->handles[n++] = task->memory_handles[jj].handle;
+	}
+
+	/* pin the whole address list with one lookup pass */
+	tmpl->unpin_gen = READ_ONCE(tmpl->buffers->unpin_gen);
+	if (n) {
+		err = nvdla_buffer_submit_pin(tmpl->buffers, tmpl->handles, n,
+					      dma_addr, dma_size, NULL);
+		if (err) {
+			nvdla_dbg_err(pdev, "fail to pin template address list");
+			goto fail;
+		}
+	}
+	tmpl->num_handles = n;
+
+	for (jj = 0, n = 0; jj < task->num_addresses; jj++) {
+		if (task->memory_handles[jj].type ==
+				NVDLA_BUFFER_TYPE_INTERNAL) {
+			/* For internal buffers, offset is the final address */
+			tmpl->addresses[jj].val =
+				task->memory_handles[jj].offset;
+			continue;
+		}
+
+		tmpl->addresses[jj].val = dma_addr[n++] +
+				task->memory_handles[jj].offset;
+	}
+	spec_bar(); /* break_spec_p#5_1 */
+
+fail:
+	kfree(dma_size);
+	kfree(dma_addr);
+	return err;
+}
+
+int nvdla_task_template_validate(struct nvdla_task_template *tmpl)
+{
+	u32 gen = READ_ONCE(tmpl->buffers->unpin_gen);
+
+	/* no buffer was unpinned by user since the last check */
+	if (gen == READ_ONCE(tmpl->unpin_gen))
+		return 0;
+
+	if (!nvdla_buffer_user_pinned(tmpl->buffers, tmpl->handles,
+				      tmpl->num_handles))
+		return -ESTALE;
+
+	WRITE_ONCE(tmpl->unpin_gen, gen);
+
+	return 0;
+}
+
 static int nvdla_fill_wait_fence_action(struct nvdla_task *task,
 	struct nvdev_fence *fence,
 	struct dma_buf **dma_buf,
@@ -1215,6 +1331,29 @@ int nvdla_emulator_submit(struct nvdla_queue *queue, struct nvdla_emu_task *task
 	return 0;
 }
 
+int nvdla_emulator_submit_task(struct nvdla_queue *queue,
+				struct nvdla_task *task)
+{
+	struct platform_device *pdev = queue->pool->pdev;
+
+	mutex_lock(&queue->list_lock);
+
+	/* consume the fences the emulator is expected to signal */
+	task->fence = nvhost_syncpt_incr_max_ext(pdev, queue->syncpt_id,
+						task->fence_counter);
+
+	nvdla_dbg_fn(pdev, "syncpt[%d] fence[%d] task[%p] fence_counter[%u]",
+				queue->syncpt_id, task->fence,
+				task, task->fence_counter);
+
+	/* task is prepared only, release memory shared with engine */
+	nvdla_unmap_task_memory(task);
+
+	mutex_unlock(&queue->list_lock);
+
+	return 0;
+}
+
 int nvdla_get_signal_fences(struct nvdla_queue *queue, void *in_task)
 {
 	struct nvdla_task *task = (struct nvdla_task *)in_task;
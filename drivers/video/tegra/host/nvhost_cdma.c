@@ -21,6 +21,7 @@
 #include "nvhost_cdma.h"
 #include "nvhost_channel.h"
 #include "nvhost_job.h"
+#include "nvhost_scale.h"
 #include "dev.h"
 #include "debug.h"
 #include "chip_support.h"
@@ -349,6 +350,9 @@ static void update_cdma_locked(struct nvhost_cdma *cdma)
 		}
 
 		list_del(&job->list);
+		nvhost_scale_job_complete(job,
+			list_first_entry_or_null(&cdma->sync_queue,
+						 struct nvhost_job, list));
 		mutex_unlock(&cdma->sync_queue_lock);
 
 		/* Cancel timeout, when a buffer completes */
@@ -643,6 +647,8 @@ void nvhost_cdma_end(struct nvhost_cdma *cdma,
 	was_idle = list_empty(&cdma->sync_queue);
 	mutex_unlock(&cdma->sync_queue_lock);
 
+	nvhost_scale_job_submit(job);
+
 	add_to_sync_queue(cdma,
 			job,
 			cdma->slots_used,
@@ -108,6 +108,10 @@ struct nvhost_job {
 	/* Maximum time to wait for this job */
 	int timeout;
 
+	/* Time of submission and optional completion deadline (0 if none) */
+	ktime_t submit_time;
+	ktime_t deadline;
+
 	/* Do debug dump after timeout */
 	bool timeout_debug_dump;
 
@@ -41,6 +41,8 @@
 #include "debug.h"
 #include "chip_support.h"
 #include "nvhost_acm.h"
+#include "nvhost_channel.h"
+#include "nvhost_job.h"
 #include "nvhost_scale.h"
 #include "host1x/host1x_actmon.h"
 #include "platform.h"
@@ -205,6 +207,87 @@ void nvhost_scale_notify_busy(struct platform_device *pdev)
 	nvhost_scale_notify(pdev, true);
 }
 
+/*
+ * nvhost_scale_job_submit(job)
+ *
+ * Account a job that was just placed on a channel sync queue.
+ */
+
+void nvhost_scale_job_submit(struct nvhost_job *job)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(job->ch->dev);
+	struct nvhost_device_profile *profile = pdata->power_profile;
+	struct nvhost_workload_stat *wl;
+
+	job->submit_time = ktime_get();
+
+	if (!profile)
+		return;
+
+	spin_lock(&profile->workload_lock);
+	wl = &profile->workload;
+
+	/* engine was idle, so the service time of this job starts now */
+	if (!wl->queue_depth)
+		profile->last_complete_time = job->submit_time;
+
+	wl->queue_depth++;
+	wl->submitted++;
+
+	if (job->deadline && (!wl->next_deadline ||
+			      ktime_before(job->deadline, wl->next_deadline)))
+		wl->next_deadline = job->deadline;
+	spin_unlock(&profile->workload_lock);
+}
+
+/*
+ * nvhost_scale_job_complete(job, next)
+ *
+ * Account a job that was retired from a channel sync queue. The per-job cost
+ * is measured from the later of its submission and the previous completion,
+ * and converted to cycles at the last sampled clock rate. next is the job that
+ * is now at the head of the same sync queue, if any, and is used to advance
+ * the earliest pending deadline. Deadlines of other channels of the same
+ * engine are picked up again on their next submit.
+ */
+
+void nvhost_scale_job_complete(struct nvhost_job *job, struct nvhost_job *next)
+{
+	struct nvhost_device_data *pdata = platform_get_drvdata(job->ch->dev);
+	struct nvhost_device_profile *profile = pdata->power_profile;
+	struct nvhost_workload_stat *wl;
+	ktime_t now = ktime_get();
+	ktime_t start;
+	u64 cycles;
+
+	if (!profile)
+		return;
+
+	spin_lock(&profile->workload_lock);
+	wl = &profile->workload;
+
+	if (wl->queue_depth)
+		wl->queue_depth--;
+	wl->completed++;
+
+	if (job->deadline && ktime_after(now, job->deadline))
+		wl->deadline_misses++;
+
+	start = ktime_after(job->submit_time, profile->last_complete_time) ?
+		job->submit_time : profile->last_complete_time;
+	cycles = div_u64((u64)ktime_us_delta(now, start) *
+			 profile->dev_stat.current_frequency, USEC_PER_SEC);
+	wl->job_cycles_avg = wl->job_cycles_avg ?
+		(wl->job_cycles_avg * 7 + cycles) / 8 : cycles;
+	profile->last_complete_time = now;
+
+	if (job->deadline && job->deadline == wl->next_deadline)
+		wl->next_deadline = next ? next->deadline : 0;
+	if (!wl->queue_depth)
+		wl->next_deadline = 0;
+	spin_unlock(&profile->workload_lock);
+}
+
 /*
  * nvhost_scale_get_dev_status(dev, *stat)
  *
@@ -223,6 +306,10 @@ static int nvhost_scale_get_dev_status(struct device *dev,
 	if (profile->actmon[ENGINE_ACTMON])
 		update_load_estimate_actmon(profile);
 
+	spin_lock(&profile->workload_lock);
+	profile->workload_snapshot = profile->workload;
+	spin_unlock(&profile->workload_lock);
+
 	/* Copy the contents of the current device status */
 	*stat = profile->dev_stat;
 
@@ -332,6 +419,10 @@ void nvhost_scale_init(struct platform_device *pdev)
 	profile->pdev = pdev;
 	profile->clk = pdata->clk[0];
 	profile->dev_stat.busy = false;
+	profile->workload.magic = NVHOST_WORKLOAD_STAT_MAGIC;
+	profile->workload_snapshot.magic = NVHOST_WORKLOAD_STAT_MAGIC;
+	profile->dev_stat.private_data = &profile->workload_snapshot;
+	spin_lock_init(&profile->workload_lock);
 	profile->num_actmons = nvhost_get_host(pdev)->info.nb_actmons;
 
 	/* Create frequency table */
@@ -26,6 +26,7 @@
 
 struct platform_device;
 struct host1x_actmon;
+struct nvhost_job;
 struct clk;
 
 /*
@@ -48,6 +49,13 @@ struct nvhost_device_profile {
 	void				*private_data;
 	struct notifier_block		qos_notify_block;
 	int				num_actmons;
+
+	/* queue depth and job timing, protected by workload_lock */
+	spinlock_t			workload_lock;
+	struct nvhost_workload_stat	workload;
+	ktime_t				last_complete_time;
+	/* copy of workload exported through dev_stat.private_data */
+	struct nvhost_workload_stat	workload_snapshot;
 };
 
 #if defined(CONFIG_TEGRA_GRHOST_SCALE)
@@ -62,6 +70,14 @@ void nvhost_scale_deinit(struct platform_device *);
 void nvhost_scale_notify_busy(struct platform_device *);
 void nvhost_scale_notify_idle(struct platform_device *);
 
+/*
+ * call when a job enters or leaves the channel sync queue to keep queue depth
+ * and per-job cost statistics for workload aware governors
+ */
+void nvhost_scale_job_submit(struct nvhost_job *job);
+void nvhost_scale_job_complete(struct nvhost_job *job,
+			       struct nvhost_job *next);
+
 int nvhost_scale_hw_init(struct platform_device *);
 void nvhost_scale_hw_deinit(struct platform_device *);
 
@@ -72,6 +88,9 @@ static inline void nvhost_scale_init(struct platform_device *d) { }
 static inline void nvhost_scale_deinit(struct platform_device *d) { }
 static inline void nvhost_scale_notify_busy(struct platform_device *d) { }
 static inline void nvhost_scale_notify_idle(struct platform_device *d) { }
+static inline void nvhost_scale_job_submit(struct nvhost_job *job) { }
+static inline void nvhost_scale_job_complete(struct nvhost_job *job,
+					     struct nvhost_job *next) { }
 static inline int nvhost_scale_hw_init(struct platform_device *d)
 {
 	return 0;
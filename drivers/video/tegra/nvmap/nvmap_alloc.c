@@ -1044,7 +1044,8 @@ void _nvmap_handle_free(struct nvmap_handle *h)
 out:
 	NVMAP_TAG_TRACE(trace_nvmap_destroy_handle,
 		NULL, get_current()->pid, 0, NVMAP_TP_ARGS_H(h));
-	kfree(h);
+	/* lockless lookups in nvmap_validate_get() may still see it */
+	kfree_rcu(h, rcu);
 }
 
 void nvmap_free_handle(struct nvmap_client *client,
@@ -1072,7 +1073,7 @@ void nvmap_free_handle(struct nvmap_client *client,
 	}
 
 	smp_rmb();
-	rb_erase(&ref->node, &client->handle_refs);
+	nvmap_remove_handle_ref(client, ref);
 	client->handle_count--;
 	atomic_dec(&ref->handle->share_count);
 
@@ -1087,7 +1088,8 @@ void nvmap_free_handle(struct nvmap_client *client,
 		dma_buf_put(ref->handle->dmabuf);
 	NVMAP_TAG_TRACE(trace_nvmap_free_handle,
 		NVMAP_TP_ARGS_CHR(client, h, ref));
-	kfree(ref);
+	/* lockless lookups in nvmap_duplicate_handle() may still see it */
+	kfree_rcu(ref, rcu);
 
 out:
 	BUG_ON(!atomic_read(&h->ref));
@@ -209,6 +209,7 @@ struct nvmap_client *__nvmap_create_client(struct nvmap_device *dev,
 	client->name = name;
 	client->kernel_client = true;
 	client->handle_refs = RB_ROOT;
+	seqcount_init(&client->ref_seq);
 
 	get_task_struct(current->group_leader);
 	task_lock(current->group_leader);
@@ -264,14 +265,14 @@ static void destroy_client(struct nvmap_client *client)
 			dma_buf_put(ref->handle->dmabuf_ro);
 		else
 			dma_buf_put(ref->handle->dmabuf);
-		rb_erase(&ref->node, &client->handle_refs);
+		nvmap_remove_handle_ref(client, ref);
 		atomic_dec(&ref->handle->share_count);
 
 		dupes = atomic_read(&ref->dupes);
 		while (dupes--)
 			nvmap_handle_put(ref->handle);
 
-		kfree(ref);
+		kfree_rcu(ref, rcu);
 	}
 
 	if (client->task)
@@ -765,8 +766,8 @@ static void nvmap_get_client_mss(struct nvmap_client *client,
 #define PSS_SHIFT 12
 static void nvmap_get_total_mss(u64 *pss, u64 *total, u32 heap_type)
 {
-	int i;
-	struct rb_node *n;
+	int i, bkt;
+	struct nvmap_handle *h;
 	struct nvmap_device *dev = nvmap_dev;
 
 	*total = 0;
@@ -775,11 +776,7 @@ static void nvmap_get_total_mss(u64 *pss, u64 *total, u32 heap_type)
 	if (!dev)
 		return;
 	spin_lock(&dev->handle_lock);
-	n = rb_first(&dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *h =
-			rb_entry(n, struct nvmap_handle, node);
-
+	hash_for_each(dev->handles, bkt, h, node) {
 		if (!h || !h->alloc || h->heap_type != heap_type)
 			continue;
 
@@ -873,7 +870,8 @@ DEBUGFS_OPEN_FOPS(device_list);
 static int nvmap_debug_all_allocations_show(struct seq_file *s, void *unused)
 {
 	u32 heap_type = (u32)(uintptr_t)s->private;
-	struct rb_node *n;
+	struct nvmap_handle *handle;
+	int bkt;
 
 
 	spin_lock(&nvmap_dev->handle_lock);
@@ -882,10 +880,7 @@ static int nvmap_debug_all_allocations_show(struct seq_file *s, void *unused)
 			"KMAPS", "UMAPS", "SHARE", "UID");
 
 	/* for each handle */
-	n = rb_first(&nvmap_dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *handle =
-			rb_entry(n, struct nvmap_handle, node);
+	hash_for_each(nvmap_dev->handles, bkt, handle, node) {
 		int i = 0;
 
 		if (handle->alloc && handle->heap_type == heap_type) {
@@ -928,7 +923,8 @@ DEBUGFS_OPEN_FOPS(all_allocations);
 static int nvmap_debug_orphan_handles_show(struct seq_file *s, void *unused)
 {
 	u32 heap_type = (u32)(uintptr_t)s->private;
-	struct rb_node *n;
+	struct nvmap_handle *handle;
+	int bkt;
 
 
 	spin_lock(&nvmap_dev->handle_lock);
@@ -937,10 +933,7 @@ static int nvmap_debug_orphan_handles_show(struct seq_file *s, void *unused)
 			"KMAPS", "UMAPS", "UID");
 
 	/* for each handle */
-	n = rb_first(&nvmap_dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *handle =
-			rb_entry(n, struct nvmap_handle, node);
+	hash_for_each(nvmap_dev->handles, bkt, handle, node) {
 		int i = 0;
 
 		if (handle->alloc && handle->heap_type == heap_type &&
@@ -1482,7 +1475,7 @@ int __init nvmap_probe(struct platform_device *pdev)
 	dev->dev_user.name = "nvmap";
 	dev->dev_user.fops = &nvmap_user_fops;
 	dev->dev_user.parent = &pdev->dev;
-	dev->handles = RB_ROOT;
+	hash_init(dev->handles);
 
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 	e = nvmap_page_pool_init(dev);
@@ -1603,9 +1596,9 @@ finish:
 int nvmap_remove(struct platform_device *pdev)
 {
 	struct nvmap_device *dev = platform_get_drvdata(pdev);
-	struct rb_node *n;
+	struct hlist_node *tmp;
 	struct nvmap_handle *h;
-	int i;
+	int i, bkt;
 
 #ifdef NVMAP_CONFIG_SCIIPC
 	nvmap_sci_ipc_exit();
@@ -1616,9 +1609,8 @@ int nvmap_remove(struct platform_device *pdev)
 	nvmap_page_pool_clear();
 	nvmap_page_pool_fini(nvmap_dev);
 #endif
-	while ((n = rb_first(&dev->handles))) {
-		h = rb_entry(n, struct nvmap_handle, node);
-		rb_erase(&h->node, &dev->handles);
+	hash_for_each_safe(dev->handles, bkt, tmp, h, node) {
+		hash_del(&h->node);
 		kfree(h);
 	}
 
@@ -41,55 +41,86 @@
 #include "nvmap_ioctl.h"
 
 /*
- * Verifies that the passed ID is a valid handle ID. Then the passed client's
- * reference to the handle is returned.
- *
- * Note: to call this function make sure you own the client ref lock.
+ * Order of the client ref tree: by handle, then RO refs after RW ones, so
+ * that both refs to a handle can always be told apart during a lookup.
  */
-struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *c,
+static inline int nvmap_ref_cmp(struct nvmap_handle *h, bool is_ro,
+				struct nvmap_handle_ref *ref)
+{
+	if (h != ref->handle)
+		return (uintptr_t)h > (uintptr_t)ref->handle ? 1 : -1;
+	if (is_ro != ref->is_ro)
+		return is_ro ? 1 : -1;
+	return 0;
+}
+
+static struct nvmap_handle_ref *__nvmap_ref_find(struct nvmap_client *c,
 						 struct nvmap_handle *h,
 						 bool is_ro)
 {
-	struct rb_node *n = c->handle_refs.rb_node;
+	struct rb_node *n = rcu_dereference_raw(c->handle_refs.rb_node);
 
 	while (n) {
 		struct nvmap_handle_ref *ref;
+		int cmp;
+
 		ref = rb_entry(n, struct nvmap_handle_ref, node);
-		if ((ref->handle == h) && (ref->is_ro == is_ro))
+		cmp = nvmap_ref_cmp(h, is_ro, ref);
+		if (!cmp)
 			return ref;
-		else if ((uintptr_t)h > (uintptr_t)ref->handle)
-			n = n->rb_right;
+		else if (cmp > 0)
+			n = rcu_dereference_raw(n->rb_right);
 		else
-			n = n->rb_left;
+			n = rcu_dereference_raw(n->rb_left);
 	}
 
 	return NULL;
 }
-/* adds a newly-created handle to the device master tree */
-void nvmap_handle_add(struct nvmap_device *dev, struct nvmap_handle *h)
+
+/*
+ * Verifies that the passed ID is a valid handle ID. Then the passed client's
+ * reference to the handle is returned.
+ *
+ * Note: to call this function make sure you own the client ref lock.
+ */
+struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *c,
+						 struct nvmap_handle *h,
+						 bool is_ro)
 {
-	struct rb_node **p;
-	struct rb_node *parent = NULL;
+	return __nvmap_ref_find(c, h, is_ro);
+}
 
-	spin_lock(&dev->handle_lock);
-	p = &dev->handles.rb_node;
-	while (*p) {
-		struct nvmap_handle *b;
+/*
+ * Lockless variant of __nvmap_validate_locked(), to be called under
+ * rcu_read_lock(). The ref may be concurrently released, so the caller has
+ * to take a dupe with atomic_inc_not_zero() before using it.
+ */
+static struct nvmap_handle_ref *__nvmap_validate_rcu(struct nvmap_client *c,
+						     struct nvmap_handle *h,
+						     bool is_ro)
+{
+	struct nvmap_handle_ref *ref;
+	unsigned int seq;
 
-		parent = *p;
-		b = rb_entry(parent, struct nvmap_handle, node);
-		if (h > b)
-			p = &parent->rb_right;
-		else
-			p = &parent->rb_left;
-	}
-	rb_link_node(&h->node, parent, p);
-	rb_insert_color(&h->node, &dev->handles);
+	/* a lookup racing with a rebalance may miss, but never loops */
+	do {
+		seq = read_seqcount_begin(&c->ref_seq);
+		ref = __nvmap_ref_find(c, h, is_ro);
+	} while (!ref && read_seqcount_retry(&c->ref_seq, seq));
+
+	return ref;
+}
+
+/* adds a newly-created handle to the device master table */
+void nvmap_handle_add(struct nvmap_device *dev, struct nvmap_handle *h)
+{
+	spin_lock(&dev->handle_lock);
+	hash_add_rcu(dev->handles, &h->node, (unsigned long)h);
 	nvmap_lru_add(h);
 	spin_unlock(&dev->handle_lock);
 }
 
-/* remove a handle from the device's tree of all handles; called
+/* remove a handle from the device's table of all handles; called
  * when freeing handles. */
 int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 {
@@ -106,37 +137,32 @@ int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 	BUG_ON(atomic_read(&h->pin) != 0);
 
 	nvmap_lru_del(h);
-	rb_erase(&h->node, &dev->handles);
+	hash_del_rcu(&h->node);
 
 	spin_unlock(&dev->handle_lock);
 	return 0;
 }
 
-/* Validates that a handle is in the device master tree and that the
+/* Validates that a handle is in the device master table and that the
  * client has permission to access it. */
 struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *id)
 {
-	struct nvmap_handle *h = NULL;
-	struct rb_node *n;
-
-	spin_lock(&nvmap_dev->handle_lock);
-
-	n = nvmap_dev->handles.rb_node;
-
-	while (n) {
-		h = rb_entry(n, struct nvmap_handle, node);
-		if (h == id) {
-			h = nvmap_handle_get(h);
-			spin_unlock(&nvmap_dev->handle_lock);
-			return h;
-		}
-		if (id > h)
-			n = n->rb_right;
-		else
-			n = n->rb_left;
+	struct nvmap_handle *h, *found = NULL;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(nvmap_dev->handles, h, node,
+				   (unsigned long)id) {
+		if (h != id)
+			continue;
+
+		/* handle is being freed once its refcount dropped to zero */
+		if (atomic_inc_not_zero(&h->ref))
+			found = h;
+		break;
 	}
-	spin_unlock(&nvmap_dev->handle_lock);
-	return NULL;
+	rcu_read_unlock();
+
+	return found;
 }
 
 static void add_handle_ref(struct nvmap_client *client,
@@ -150,13 +176,17 @@ static void add_handle_ref(struct nvmap_client *client,
 		struct nvmap_handle_ref *node;
 		parent = *p;
 		node = rb_entry(parent, struct nvmap_handle_ref, node);
-		if (ref->handle > node->handle)
+		if (nvmap_ref_cmp(ref->handle, ref->is_ro, node) > 0)
 			p = &parent->rb_right;
 		else
 			p = &parent->rb_left;
 	}
-	rb_link_node(&ref->node, parent, p);
+	preempt_disable();
+	write_seqcount_begin(&client->ref_seq);
+	rb_link_node_rcu(&ref->node, parent, p);
 	rb_insert_color(&ref->node, &client->handle_refs);
+	write_seqcount_end(&client->ref_seq);
+	preempt_enable();
 	client->handle_count++;
 	if (client->handle_count > nvmap_max_handle_count)
 		nvmap_max_handle_count = client->handle_count;
@@ -164,6 +194,20 @@ static void add_handle_ref(struct nvmap_client *client,
 	nvmap_ref_unlock(client);
 }
 
+/*
+ * Removes a ref from the client tree. The caller owns the client ref lock
+ * and frees the ref with kfree_rcu() if lockless lookups may still see it.
+ */
+void nvmap_remove_handle_ref(struct nvmap_client *client,
+			     struct nvmap_handle_ref *ref)
+{
+	preempt_disable();
+	write_seqcount_begin(&client->ref_seq);
+	rb_erase(&ref->node, &client->handle_refs);
+	write_seqcount_end(&client->ref_seq);
+	preempt_enable();
+}
+
 struct nvmap_handle_ref *nvmap_create_handle_from_va(struct nvmap_client *client,
 						     ulong vaddr, size_t size,
 						     u32 flags)
@@ -268,11 +312,8 @@ struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 	 */
 	atomic_set(&ref->dupes, 1);
 	ref->handle = h;
+	ref->is_ro = ro_buf;
 	add_handle_ref(client, ref);
-	if (ro_buf)
-		ref->is_ro = true;
-	else
-		ref->is_ro = false;
 	trace_nvmap_create_handle(client, client->name, h, size, ref);
 	return ref;
 
@@ -289,13 +330,11 @@ struct nvmap_handle_ref *nvmap_try_duplicate_by_ivmid(
 {
 	struct nvmap_handle *h = NULL;
 	struct nvmap_handle_ref *ref = NULL;
-	struct rb_node *n;
+	int bkt;
 
 	spin_lock(&nvmap_dev->handle_lock);
 
-	n = nvmap_dev->handles.rb_node;
-	for (n = rb_first(&nvmap_dev->handles); n; n = rb_next(n)) {
-		h = rb_entry(n, struct nvmap_handle, node);
+	hash_for_each(nvmap_dev->handles, bkt, h, node) {
 		if (h->ivm_id == ivm_id) {
 			BUG_ON(!virt_addr_valid(h));
 			/* get handle's ref only if non-zero */
@@ -303,13 +342,14 @@ struct nvmap_handle_ref *nvmap_try_duplicate_by_ivmid(
 				*block = h->carveout;
 				/* strip handle's block and fail duplication */
 				h->carveout = NULL;
-				break;
+				goto not_found;
 			}
 			spin_unlock(&nvmap_dev->handle_lock);
 			goto found;
 		}
 	}
 
+not_found:
 	spin_unlock(&nvmap_dev->handle_lock);
 	/* handle is either freed or being freed, don't duplicate it */
 	goto finish;
@@ -377,6 +417,15 @@ struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
 		return ERR_PTR(-EINVAL);
 	}
 
+	/* fast path: the client already holds a ref to the handle */
+	rcu_read_lock();
+	ref = __nvmap_validate_rcu(client, h, is_ro);
+	if (ref && atomic_inc_not_zero(&ref->dupes)) {
+		rcu_read_unlock();
+		goto out;
+	}
+	rcu_read_unlock();
+
 	nvmap_ref_lock(client);
 	ref = __nvmap_validate_locked(client, h, is_ro);
 
@@ -396,8 +445,8 @@ struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
 
 	atomic_set(&ref->dupes, 1);
 	ref->handle = h;
-	add_handle_ref(client, ref);
 
+	/* the ref is fully set up before lockless lookups can find it */
 	if (is_ro) {
 		ref->is_ro = true;
 		get_dma_buf(h->dmabuf_ro);
@@ -406,6 +455,8 @@ struct nvmap_handle_ref *nvmap_duplicate_handle(struct nvmap_client *client,
 		get_dma_buf(h->dmabuf);
 	}
 
+	add_handle_ref(client, ref);
+
 out:
 	NVMAP_TAG_TRACE(trace_nvmap_duplicate_handle,
 		NVMAP_TP_ARGS_CHR(client, h, ref));
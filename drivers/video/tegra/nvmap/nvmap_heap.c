@@ -28,6 +28,8 @@
 #include <linux/bug.h>
 #include <linux/stat.h>
 #include <linux/sizes.h>
+#include <linux/seq_file.h>
+#include <linux/math64.h>
 #include <linux/io.h>
 #include <linux/version.h>
 
@@ -104,6 +106,37 @@ size_t nvmap_query_heap_size(struct nvmap_heap *heap)
 	return heap->len;
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+static int nvmap_heap_fragmentation_show(struct seq_file *s, void *unused)
+{
+	struct nvmap_heap *heap = s->private;
+	struct nvmap_coherent_stats st;
+	unsigned int frag = 0;
+
+	if (nvmap_dma_coherent_stats(heap->dma_dev, &st))
+		return -ENODEV;
+
+	/* share of free memory unusable by an allocation of all of it */
+	if (st.free_pages)
+		frag = 100 - div_u64((u64)st.largest_free * 100,
+				     st.free_pages);
+
+	seq_printf(s, "total_pages: %u\n", st.total_pages);
+	seq_printf(s, "free_pages: %u\n", st.free_pages);
+	seq_printf(s, "largest_free_pages: %u\n", st.largest_free);
+	seq_printf(s, "free_extents: %u\n", st.nr_extents);
+	seq_printf(s, "fragmentation: %u%%\n", frag);
+	seq_printf(s, "allocs: %llu\n", st.nr_allocs);
+	seq_printf(s, "alloc_fails: %llu\n", st.nr_alloc_fails);
+	seq_printf(s, "alloc_avg_ns: %llu\n",
+		   div64_u64(st.alloc_ns_total,
+			     max_t(u64, st.nr_allocs + st.nr_alloc_fails, 1)));
+	seq_printf(s, "alloc_max_ns: %llu\n", st.alloc_ns_max);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvmap_heap_fragmentation);
+#endif
+
 void nvmap_heap_debugfs_init(struct dentry *heap_root, struct nvmap_heap *heap)
 {
 	if (sizeof(heap->base) == sizeof(u64))
@@ -124,6 +157,11 @@ void nvmap_heap_debugfs_init(struct dentry *heap_root, struct nvmap_heap *heap)
 	else
 		debugfs_create_x32("free_size", S_IRUGO,
 			heap_root, (u32 *)&heap->free_size);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+	if (heap->dma_dev && heap->dma_dev->dma_mem)
+		debugfs_create_file("fragmentation", S_IRUGO, heap_root, heap,
+				    &nvmap_heap_fragmentation_fops);
+#endif
 }
 
 static phys_addr_t nvmap_alloc_mem(struct nvmap_heap *h, size_t len,
@@ -205,7 +243,8 @@ static void nvmap_free_mem(struct nvmap_heap *h, phys_addr_t base,
 		dma_mark_declared_memory_unoccupied(dev, base, len,
 						    DMA_ATTR_ALLOC_EXACT_SIZE);
 #else
-		nvmap_dma_release_from_dev_coherent(dev, len, (void *)(uintptr_t)base);
+		nvmap_dma_release_from_dev_coherent(dev, get_order(len),
+						    (void *)(uintptr_t)base);
 #endif
 	} else
 #endif
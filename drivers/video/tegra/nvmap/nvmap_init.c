@@ -23,6 +23,7 @@
 #include <linux/version.h>
 #include <linux/kmemleak.h>
 #include <linux/io.h>
+#include <linux/sort.h>
 
 #if defined(NVMAP_LOADABLE_MODULE)
 #include <linux/nvmap_t19x.h>
@@ -344,23 +345,272 @@ static inline struct page **nvmap_kvzalloc_pages(u32 count)
 		return vzalloc(count * sizeof(struct page *));
 }
 
+/*
+ * Free space of a coherent carveout is kept as extents of free pages, indexed
+ * by start page for coalescing on free and by (length, start) for best-fit
+ * allocation. Best-fit leaves large extents intact for large buffers rather
+ * than carving every request off the bottom of the carveout, which is what
+ * fragmented long running carveouts with the first-fit bitmap scan.
+ *
+ * Extent nodes are allocated outside of mem->spinlock and kept on a list of
+ * spares, so that frees, which may run where sleeping is not allowed, never
+ * allocate. Every allocation adds one node and nodes of extents that go away
+ * are recycled, so a single page allocation spread over k extents leaves k
+ * nodes behind for its k runs. Free extents are separated by allocated runs,
+ * so with R runs there are at most R + 1 extents, and the R + 1 nodes owned
+ * by the carveout always cover the extent a free may have to insert. Each
+ * free ends one run, so it hands the node that is no longer needed back to
+ * the caller to be freed once mem->spinlock is dropped.
+ */
+static void nvmap_extent_put_spare(struct dma_coherent_mem_replica *mem,
+				   struct nvmap_free_extent *ext)
+{
+	list_add(&ext->list, &mem->spares);
+	mem->nr_spares++;
+}
+
+static struct nvmap_free_extent *nvmap_extent_get_spare(
+			struct dma_coherent_mem_replica *mem)
+{
+	struct nvmap_free_extent *ext;
+
+	ext = list_first_entry_or_null(&mem->spares,
+				       struct nvmap_free_extent, list);
+	if (ext) {
+		list_del(&ext->list);
+		mem->nr_spares--;
+	}
+	return ext;
+}
+
+/* Move the nodes beyond the R + 1 the carveout needs to @excess */
+static void nvmap_extent_trim_spares(struct dma_coherent_mem_replica *mem,
+				     struct list_head *excess)
+{
+	while (mem->nr_extents + mem->nr_spares > mem->nr_runs + 1) {
+		struct nvmap_free_extent *ext = nvmap_extent_get_spare(mem);
+
+		if (!ext)
+			break;
+		list_add(&ext->list, excess);
+	}
+}
+
+static void nvmap_extent_free_list(struct list_head *excess)
+{
+	struct nvmap_free_extent *ext, *tmp;
+
+	list_for_each_entry_safe(ext, tmp, excess, list)
+		kfree(ext);
+}
+
+static void nvmap_extent_link_start(struct dma_coherent_mem_replica *mem,
+				    struct nvmap_free_extent *ext)
+{
+	struct rb_node **p = &mem->free_by_start.rb_node, *parent = NULL;
+	struct nvmap_free_extent *e;
+
+	while (*p) {
+		parent = *p;
+		e = rb_entry(parent, struct nvmap_free_extent, start_node);
+		if (ext->start < e->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&ext->start_node, parent, p);
+	rb_insert_color(&ext->start_node, &mem->free_by_start);
+}
+
+static void nvmap_extent_link_size(struct dma_coherent_mem_replica *mem,
+				   struct nvmap_free_extent *ext)
+{
+	struct rb_node **p = &mem->free_by_size.rb_node, *parent = NULL;
+	struct nvmap_free_extent *e;
+
+	while (*p) {
+		parent = *p;
+		e = rb_entry(parent, struct nvmap_free_extent, size_node);
+		if (ext->len < e->len ||
+		    (ext->len == e->len && ext->start < e->start))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&ext->size_node, parent, p);
+	rb_insert_color(&ext->size_node, &mem->free_by_size);
+}
+
+static void nvmap_extent_insert(struct dma_coherent_mem_replica *mem,
+				struct nvmap_free_extent *ext,
+				unsigned int start, unsigned int len)
+{
+	ext->start = start;
+	ext->len = len;
+	nvmap_extent_link_start(mem, ext);
+	nvmap_extent_link_size(mem, ext);
+	mem->nr_extents++;
+}
+
+static void nvmap_extent_remove(struct dma_coherent_mem_replica *mem,
+				struct nvmap_free_extent *ext)
+{
+	rb_erase(&ext->start_node, &mem->free_by_start);
+	rb_erase(&ext->size_node, &mem->free_by_size);
+	mem->nr_extents--;
+	nvmap_extent_put_spare(mem, ext);
+}
+
+/* Callers never move an extent past a neighbour, so only resort by size */
+static void nvmap_extent_update(struct dma_coherent_mem_replica *mem,
+				struct nvmap_free_extent *ext,
+				unsigned int start, unsigned int len)
+{
+	rb_erase(&ext->size_node, &mem->free_by_size);
+	ext->start = start;
+	ext->len = len;
+	nvmap_extent_link_size(mem, ext);
+}
+
+/*
+ * Find the smallest extent holding @count pages at a page offset aligned to
+ * @align + 1. An extent shorter than count + align may not fit once aligned,
+ * so walk up from the smallest candidate until one does. That walk is linear
+ * in the number of extents of at least @count pages when alignment rejects
+ * most of them; the size tree only bounds where it starts.
+ */
+static struct nvmap_free_extent *nvmap_extent_find(
+			struct dma_coherent_mem_replica *mem,
+			unsigned int count, unsigned long align,
+			unsigned int *pageno)
+{
+	struct rb_node *n = mem->free_by_size.rb_node, *best = NULL;
+	struct nvmap_free_extent *e;
+	unsigned int first;
+
+	while (n) {
+		e = rb_entry(n, struct nvmap_free_extent, size_node);
+		if (e->len >= count) {
+			best = n;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	for (n = best; n; n = rb_next(n)) {
+		e = rb_entry(n, struct nvmap_free_extent, size_node);
+		first = (e->start + align) & ~align;
+		if (first + count <= e->start + e->len) {
+			*pageno = first;
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static void nvmap_extent_carve(struct dma_coherent_mem_replica *mem,
+			       struct nvmap_free_extent *ext,
+			       unsigned int pageno, unsigned int count)
+{
+	struct nvmap_free_extent *spare;
+	unsigned int head = pageno - ext->start;
+	unsigned int tail = ext->start + ext->len - pageno - count;
+
+	mem->free_pages -= count;
+	mem->nr_runs++;
+	if (!head && !tail) {
+		nvmap_extent_remove(mem, ext);
+	} else if (!head) {
+		nvmap_extent_update(mem, ext, pageno + count, tail);
+	} else {
+		nvmap_extent_update(mem, ext, ext->start, head);
+		if (tail) {
+			spare = nvmap_extent_get_spare(mem);
+			if (WARN_ON_ONCE(!spare))
+				return;
+			nvmap_extent_insert(mem, spare, pageno + count, tail);
+		}
+	}
+}
+
+static void nvmap_extent_free(struct dma_coherent_mem_replica *mem,
+			      unsigned int pageno, unsigned int count)
+{
+	struct nvmap_free_extent *spare;
+	struct rb_node *n = mem->free_by_start.rb_node;
+	struct nvmap_free_extent *e, *prev = NULL, *next = NULL;
+	unsigned int end = pageno + count;
+
+	if (WARN_ONCE(pageno >= mem->size || count > mem->size - pageno,
+		      "invalid pageno:%u count:%u\n", pageno, count))
+		return;
+
+	while (n) {
+		e = rb_entry(n, struct nvmap_free_extent, start_node);
+		if (e->start < pageno) {
+			prev = e;
+			n = n->rb_right;
+		} else {
+			next = e;
+			n = n->rb_left;
+		}
+	}
+
+	if (WARN_ONCE((prev && prev->start + prev->len > pageno) ||
+		      (next && next->start < end),
+		      "double free of pages %u-%u\n", pageno, end - 1))
+		return;
+
+	mem->free_pages += count;
+	if (!WARN_ON_ONCE(!mem->nr_runs))
+		mem->nr_runs--;
+	if (prev && prev->start + prev->len == pageno) {
+		if (next && next->start == end) {
+			count += next->len;
+			nvmap_extent_remove(mem, next);
+		}
+		nvmap_extent_update(mem, prev, prev->start, prev->len + count);
+	} else if (next && next->start == end) {
+		nvmap_extent_update(mem, next, pageno, next->len + count);
+	} else {
+		spare = nvmap_extent_get_spare(mem);
+		if (WARN_ON_ONCE(!spare))
+			return;
+		nvmap_extent_insert(mem, spare, pageno, count);
+	}
+}
+
+static void nvmap_extent_account(struct dma_coherent_mem_replica *mem,
+				 u64 start, bool ok)
+{
+	u64 delta = sched_clock() - start;
+
+	if (ok)
+		mem->nr_allocs++;
+	else
+		mem->nr_alloc_fails++;
+	mem->alloc_ns_total += delta;
+	mem->alloc_ns_max = max(mem->alloc_ns_max, delta);
+}
+
 static void *__nvmap_dma_alloc_from_coherent(struct device *dev,
 					     struct dma_coherent_mem_replica *mem,
 					     ssize_t size,
 					     dma_addr_t *dma_handle,
-					     unsigned long attrs,
-					     unsigned long start)
+					     unsigned long attrs)
 {
 	int order = get_order(size);
 	unsigned long flags;
-	int pageno, i = 0, j = 0;
+	unsigned int pageno = 0, i = 0, j, n;
 	unsigned int count;
-	unsigned int alloc_size;
 	unsigned long align;
 	void *addr = NULL;
 	struct page **pages = NULL;
+	struct nvmap_free_extent *ext, *spare;
+	bool single_pages;
 	int do_memset = 0;
-	int *bitmap_nos = NULL;
+	u64 start;
 
 	if (dma_get_attr(DMA_ATTR_ALLOC_EXACT_SIZE, attrs))
 		count = PAGE_ALIGN(size) >> PAGE_SHIFT;
@@ -370,58 +620,70 @@ static void *__nvmap_dma_alloc_from_coherent(struct device *dev,
 	if (!count)
 		return NULL;
 
-	bitmap_nos = vzalloc(count * sizeof(int));
-	if (!bitmap_nos) {
-		dev_err(dev, "failed to allocate memory\n");
-		return NULL;
-	}
-	if ((mem->flags & DMA_MEMORY_NOMAP) &&
-	    dma_get_attr(DMA_ATTR_ALLOC_SINGLE_PAGES, attrs)) {
-		alloc_size = 1;
+	single_pages = (mem->flags & DMA_MEMORY_NOMAP) &&
+		       dma_get_attr(DMA_ATTR_ALLOC_SINGLE_PAGES, attrs);
+	if (single_pages) {
+		align = 0;
 		pages = nvmap_kvzalloc_pages(count);
 		if (!pages)
 			return NULL;
 	} else {
-		alloc_size = count;
-	}
-
-	spin_lock_irqsave(&mem->spinlock, flags);
-
-	if (unlikely(size > (mem->size << PAGE_SHIFT)))
-		goto err;
-
-	if ((mem->flags & DMA_MEMORY_NOMAP) &&
-	    dma_get_attr(DMA_ATTR_ALLOC_SINGLE_PAGES, attrs)) {
-		align = 0;
-	} else  {
 		if (order > DMA_BUF_ALIGNMENT)
 			align = (1 << DMA_BUF_ALIGNMENT) - 1;
 		else
 			align = (1 << order) - 1;
 	}
 
-	while (count) {
-		pageno = bitmap_find_next_zero_area(mem->bitmap, mem->size,
-						    start, alloc_size, align);
+	/* the node this allocation brings to the carveout */
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (!spare) {
+		kvfree(pages);
+		return NULL;
+	}
 
-		if (pageno >= mem->size)
-			goto err;
+	spin_lock_irqsave(&mem->spinlock, flags);
+	start = sched_clock();
+
+	if (unlikely(size > (mem->size << PAGE_SHIFT)))
+		goto err;
 
-		count -= alloc_size;
-		if (pages)
-			pages[i++] = pfn_to_page(mem->pfn_base + pageno);
-		bitmap_set(mem->bitmap, pageno, alloc_size);
-		bitmap_nos[j++] = pageno;
+	if (single_pages) {
+		/*
+		 * Any free page will do, so this cannot fail part way. Use up
+		 * the smallest extents first to fill holes.
+		 */
+		if (mem->free_pages < count)
+			goto err;
+		nvmap_extent_put_spare(mem, spare);
+
+		while (i < count) {
+			ext = rb_entry(rb_first(&mem->free_by_size),
+				       struct nvmap_free_extent, size_node);
+			n = min(ext->len, count - i);
+			pageno = ext->start;
+			for (j = 0; j < n; j++)
+				pages[i++] = pfn_to_page(mem->pfn_base +
+							 pageno + j);
+			nvmap_extent_carve(mem, ext, pageno, n);
+		}
+		pageno = page_to_pfn(pages[count - 1]) - mem->pfn_base;
+	} else {
+		ext = nvmap_extent_find(mem, count, align, &pageno);
+		if (!ext)
+			goto err;
+		nvmap_extent_put_spare(mem, spare);
+		nvmap_extent_carve(mem, ext, pageno, count);
 	}
+	nvmap_extent_account(mem, start, true);
 
 	/*
 	 * Memory was found in the coherent area.
 	 */
-	*dma_handle = mem->device_base + (pageno << PAGE_SHIFT);
+	*dma_handle = mem->device_base + ((dma_addr_t)pageno << PAGE_SHIFT);
 	if (!(mem->flags & DMA_MEMORY_NOMAP)) {
-		addr = mem->virt_base + (pageno << PAGE_SHIFT);
+		addr = mem->virt_base + ((dma_addr_t)pageno << PAGE_SHIFT);
 		do_memset = 1;
-	} else if (dma_get_attr(DMA_ATTR_ALLOC_SINGLE_PAGES, attrs)) {
+	} else if (single_pages) {
 		addr = pages;
 	}
 
@@ -430,15 +692,12 @@ static void *__nvmap_dma_alloc_from_coherent(struct device *dev,
 	if (do_memset)
 		memset(addr, 0, size);
 
-	kvfree(bitmap_nos);
 	return addr;
 err:
-	while (j--)
-		bitmap_clear(mem->bitmap, bitmap_nos[j], alloc_size);
-
+	nvmap_extent_account(mem, start, false);
 	spin_unlock_irqrestore(&mem->spinlock, flags);
 	kvfree(pages);
-	kvfree(bitmap_nos);
+	kfree(spare);
 	return NULL;
 }
 
@@ -456,10 +715,18 @@ void *nvmap_dma_alloc_attrs(struct device *dev, size_t size,
 	mem = (struct dma_coherent_mem_replica *)(dev->dma_mem);
 
 	return __nvmap_dma_alloc_from_coherent(dev, mem, size, dma_handle,
-						   attrs, 0);
+						   attrs);
 }
 EXPORT_SYMBOL(nvmap_dma_alloc_attrs);
 
+static int nvmap_page_cmp(const void *a, const void *b)
+{
+	unsigned long pa = page_to_pfn(*(struct page * const *)a);
+	unsigned long pb = page_to_pfn(*(struct page * const *)b);
+
+	return pa < pb ? -1 : pa > pb;
+}
+
 void nvmap_dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 			  dma_addr_t dma_handle, unsigned long attrs)
 {
@@ -475,17 +742,25 @@ void nvmap_dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 	if ((mem->flags & DMA_MEMORY_NOMAP) &&
 	    dma_get_attr(DMA_ATTR_ALLOC_SINGLE_PAGES, attrs)) {
 		struct page **pages = cpu_addr;
-		int i;
+		unsigned int count = size >> PAGE_SHIFT;
+		unsigned int i, run;
+		LIST_HEAD(excess);
 
-		spin_lock_irqsave(&mem->spinlock, flags);
-		for (i = 0; i < (size >> PAGE_SHIFT); i++) {
+		/* give pages back as runs of contiguous pages */
+		sort(pages, count, sizeof(*pages), nvmap_page_cmp, NULL);
+		for (i = 0; i < count; i += run) {
 			pageno = page_to_pfn(pages[i]) - mem->pfn_base;
-			if (WARN_ONCE(pageno > mem->size,
-				      "invalid pageno:%d\n", pageno))
-				continue;
-			bitmap_clear(mem->bitmap, pageno, 1);
+			for (run = 1; i + run < count; run++)
+				if (page_to_pfn(pages[i + run]) !=
+				    page_to_pfn(pages[i]) + run)
+					break;
+
+			spin_lock_irqsave(&mem->spinlock, flags);
+			nvmap_extent_free(mem, pageno, run);
+			nvmap_extent_trim_spares(mem, &excess);
+			spin_unlock_irqrestore(&mem->spinlock, flags);
 		}
-		spin_unlock_irqrestore(&mem->spinlock, flags);
+		nvmap_extent_free_list(&excess);
 		kvfree(pages);
 		return;
 	}
@@ -500,6 +775,7 @@ void nvmap_dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 		int page = (cpu_addr - mem_addr) >> PAGE_SHIFT;
 		unsigned long flags;
 		unsigned int count;
+		LIST_HEAD(excess);
 
 		if (DMA_ATTR_ALLOC_EXACT_SIZE & attrs)
 			count = PAGE_ALIGN(size) >> PAGE_SHIFT;
@@ -507,8 +783,10 @@ void nvmap_dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 			count = 1 << get_order(size);
 
 		spin_lock_irqsave(&mem->spinlock, flags);
-		bitmap_clear(mem->bitmap, page, count);
+		nvmap_extent_free(mem, page, count);
+		nvmap_extent_trim_spares(mem, &excess);
 		spin_unlock_irqrestore(&mem->spinlock, flags);
+		nvmap_extent_free_list(&excess);
 	}
 }
 EXPORT_SYMBOL(nvmap_dma_free_attrs);
@@ -517,9 +795,11 @@ int nvmap_dma_alloc_from_dev_coherent(struct device *dev, ssize_t size,
 		dma_addr_t *dma_handle, void **ret)
 {
 	struct dma_coherent_mem_replica *mem;
-	int order;
+	struct nvmap_free_extent *ext, *spare;
+	unsigned int count;
 	unsigned long flags;
-	int pageno;
+	unsigned int pageno;
+	u64 start;
 
 	if (!dev || !dev->dma_mem)
 		return -EINVAL;
@@ -528,14 +808,24 @@ int nvmap_dma_alloc_from_dev_coherent(struct device *dev, ssize_t size,
 
 	if (size < 0)
 		return -EINVAL;
-	order = get_order(size);
+	count = 1 << get_order(size);
+
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (!spare)
+		return -ENOMEM;
+
 	spin_lock_irqsave(&mem->spinlock, flags);
+	start = sched_clock();
 	if (unlikely(size > (mem->size << PAGE_SHIFT)))
 		goto err;
 
-	pageno = bitmap_find_free_region(mem->bitmap, mem->size, order);
-	if (unlikely(pageno < 0))
+	/* regions are naturally aligned to their order */
+	ext = nvmap_extent_find(mem, count, count - 1, &pageno);
+	if (unlikely(!ext))
 		goto err;
+	nvmap_extent_put_spare(mem, spare);
+	nvmap_extent_carve(mem, ext, pageno, count);
+	nvmap_extent_account(mem, start, true);
 
 	/*
 	 * Memory was found in the coherent area.
@@ -547,7 +837,9 @@ int nvmap_dma_alloc_from_dev_coherent(struct device *dev, ssize_t size,
 	return 0;
 
 err:
+	nvmap_extent_account(mem, start, false);
 	spin_unlock_irqrestore(&mem->spinlock, flags);
+	kfree(spare);
 	*ret = NULL;
 	return -EINVAL;
 }
@@ -563,22 +855,57 @@ int nvmap_dma_release_from_dev_coherent(struct device *dev, int order, void *vad
 		(mem->virt_base + (mem->size << PAGE_SHIFT))) {
 		unsigned int page = (unsigned int)((vaddr - mem->virt_base) >> PAGE_SHIFT);
 		unsigned long flags;
+		LIST_HEAD(excess);
 
 		spin_lock_irqsave(&mem->spinlock, flags);
-		bitmap_release_region(mem->bitmap, page, order);
+		nvmap_extent_free(mem, page, 1 << order);
+		nvmap_extent_trim_spares(mem, &excess);
 		spin_unlock_irqrestore(&mem->spinlock, flags);
+		nvmap_extent_free_list(&excess);
 		return 0;
 	}
 	return -EINVAL;
 }
 
+int nvmap_dma_coherent_stats(struct device *dev,
+			     struct nvmap_coherent_stats *stats)
+{
+	struct dma_coherent_mem_replica *mem;
+	struct rb_node *n;
+	unsigned long flags;
+
+	if (!dev || !dev->dma_mem)
+		return -EINVAL;
+	mem = (struct dma_coherent_mem_replica *)(dev->dma_mem);
+
+	spin_lock_irqsave(&mem->spinlock, flags);
+	n = rb_last(&mem->free_by_size);
+	stats->total_pages = mem->size;
+	stats->free_pages = mem->free_pages;
+	stats->largest_free = n ?
+		rb_entry(n, struct nvmap_free_extent, size_node)->len : 0;
+	stats->nr_extents = mem->nr_extents;
+	stats->nr_allocs = mem->nr_allocs;
+	stats->nr_alloc_fails = mem->nr_alloc_fails;
+	stats->alloc_ns_total = mem->alloc_ns_total;
+	stats->alloc_ns_max = mem->alloc_ns_max;
+	spin_unlock_irqrestore(&mem->spinlock, flags);
+	return 0;
+}
+
 static void nvmap_dma_release_coherent_memory(struct dma_coherent_mem_replica *mem)
 {
+	struct nvmap_free_extent *ext, *tmp;
+
 	if (!mem)
 		return;
 	if (!(mem->flags & DMA_MEMORY_NOMAP))
 		memunmap(mem->virt_base);
-	kfree(mem->bitmap);
+	rbtree_postorder_for_each_entry_safe(ext, tmp, &mem->free_by_start,
+					     start_node)
+		kfree(ext);
+	list_for_each_entry_safe(ext, tmp, &mem->spares, list)
+		kfree(ext);
 	kfree(mem);
 }
 
@@ -600,9 +927,9 @@ static int nvmap_dma_init_coherent_memory(
 	struct dma_coherent_mem_replica **mem)
 {
 	struct dma_coherent_mem_replica *dma_mem = NULL;
+	struct nvmap_free_extent *ext;
 	void *mem_base = NULL;
 	int pages = size >> PAGE_SHIFT;
-	int bitmap_size = BITS_TO_LONGS(pages) * sizeof(long);
 	int ret;
 
 	if (!size)
@@ -620,8 +947,8 @@ static int nvmap_dma_init_coherent_memory(
 		goto err_memunmap;
 	}
 
-	dma_mem->bitmap = kzalloc(bitmap_size, GFP_KERNEL);
-	if (!dma_mem->bitmap) {
+	ext = kzalloc(sizeof(*ext), GFP_KERNEL);
+	if (!ext) {
 		ret = -ENOMEM;
 		goto err_free_dma_mem;
 	}
@@ -632,6 +959,11 @@ static int nvmap_dma_init_coherent_memory(
 	dma_mem->size = pages;
 	dma_mem->flags = flags;
 	spin_lock_init(&dma_mem->spinlock);
+	dma_mem->free_by_start = RB_ROOT;
+	dma_mem->free_by_size = RB_ROOT;
+	INIT_LIST_HEAD(&dma_mem->spares);
+	nvmap_extent_insert(dma_mem, ext, 0, pages);
+	dma_mem->free_pages = pages;
 
 	*mem = dma_mem;
 	return 0;
@@ -30,6 +30,7 @@
 #include <linux/highmem.h>
 #include <linux/mm.h>
 #include <linux/mman.h>
+#include <linux/sizes.h>
 
 #include <asm/io.h>
 #include <asm/memory.h>
@@ -54,6 +55,9 @@
 #endif /* !NVMAP_LOADABLE_MODULE */
 #endif
 
+/* Largest bounce buffer used to stage user data for VPR writes */
+#define NVMAP_RW_BOUNCE_SIZE	SZ_16K
+
 extern struct device tegra_vpr_dev;
 
 static ssize_t rw_handle(struct nvmap_client *client, struct nvmap_handle *h,
@@ -610,6 +614,53 @@ close_fd:
 	return SYS_CLOSE(arg);
 }
 
+/*
+ * Cache maintenance for @count rows of @elem_size bytes, @h_stride apart.
+ * Rows separated by less than a page (or less than a row) are covered by a
+ * single operation over the whole span; rows further apart are maintained
+ * one by one rather than also cleaning the gaps between them.
+ */
+static void rw_handle_cache_maint(struct nvmap_client *client,
+				  struct nvmap_handle *h, unsigned long h_offs,
+				  unsigned long h_stride, unsigned long elem_size,
+				  unsigned long count, unsigned int op)
+{
+	if (!count || (h->userflags & NVMAP_HANDLE_CACHE_SYNC_AT_RESERVE))
+		return;
+
+	if (count == 1 ||
+	    h_stride - elem_size <= max_t(unsigned long, elem_size, PAGE_SIZE)) {
+		__nvmap_do_cache_maint(client, h, h_offs,
+			h_offs + h_stride * (count - 1) + elem_size, op, false);
+		return;
+	}
+
+	while (count--) {
+		__nvmap_do_cache_maint(client, h, h_offs, h_offs + elem_size,
+				       op, false);
+		h_offs += h_stride;
+	}
+}
+
+/* Copy a row from user space to VPR through a bounded bounce buffer */
+static int rw_handle_vpr_write(void *addr, unsigned long sys_addr,
+			       unsigned long elem_size, void *tmp,
+			       size_t tmp_size)
+{
+	size_t chunk;
+
+	while (elem_size) {
+		chunk = min_t(size_t, elem_size, tmp_size);
+		if (copy_from_user(tmp, (void __user *)sys_addr, chunk))
+			return -EFAULT;
+		kasan_memcpy_toio((void __iomem *)addr, tmp, chunk);
+		addr += chunk;
+		sys_addr += chunk;
+		elem_size -= chunk;
+	}
+	return 0;
+}
+
 static ssize_t rw_handle(struct nvmap_client *client, struct nvmap_handle *h,
 			 int is_read, unsigned long h_offs,
 			 unsigned long sys_addr, unsigned long h_stride,
@@ -617,6 +668,8 @@ static ssize_t rw_handle(struct nvmap_client *client, struct nvmap_handle *h,
 			 unsigned long count)
 {
 	ssize_t copied = 0;
+	unsigned long start = h_offs, rows = 0;
+	size_t tmp_size = 0;
 	void *tmp = NULL;
 	void *addr;
 	int ret = 0;
@@ -655,52 +708,48 @@ static ssize_t rw_handle(struct nvmap_client *client, struct nvmap_handle *h,
 
 	/* Allocate buffer to cache data for VPR write */
 	if (!is_read && h->heap_type == NVMAP_HEAP_CARVEOUT_VPR) {
-		tmp = vmalloc(elem_size);
+		tmp_size = min_t(size_t, elem_size, NVMAP_RW_BOUNCE_SIZE);
+		tmp = kmalloc(tmp_size, GFP_KERNEL);
 		if (!tmp)
 			return -ENOMEM;
 	}
 
+	/* All rows were bounds checked above, invalidate them in one go */
+	if (is_read)
+		rw_handle_cache_maint(client, h, h_offs, h_stride, elem_size,
+				      count, NVMAP_CACHE_OP_INV);
+
 	while (count--) {
 		if (h_offs + elem_size > h->size) {
 			pr_warn("read/write outside of handle\n");
 			ret = -EFAULT;
 			break;
 		}
-		if (is_read &&
-		    !(h->userflags & NVMAP_HANDLE_CACHE_SYNC_AT_RESERVE))
-			__nvmap_do_cache_maint(client, h, h_offs,
-				h_offs + elem_size, NVMAP_CACHE_OP_INV, false);
 
 		if (is_read)
 			ret = copy_to_user((void __user *)sys_addr, addr, elem_size);
-		else {
-			if (h->heap_type == NVMAP_HEAP_CARVEOUT_VPR) {
-				ret = copy_from_user(tmp, (void __user *)sys_addr,
-						     elem_size);
-				if (!ret)
-					kasan_memcpy_toio((void __iomem *)addr, tmp, elem_size);
-			} else
-				ret = copy_from_user(addr, (void __user *)sys_addr, elem_size);
-		}
+		else if (tmp)
+			ret = rw_handle_vpr_write(addr, sys_addr, elem_size,
+						  tmp, tmp_size);
+		else
+			ret = copy_from_user(addr, (void __user *)sys_addr, elem_size);
 
 		if (ret)
 			break;
 
-		if (!is_read &&
-		    !(h->userflags & NVMAP_HANDLE_CACHE_SYNC_AT_RESERVE))
-			__nvmap_do_cache_maint(client, h, h_offs,
-				h_offs + elem_size, NVMAP_CACHE_OP_WB_INV,
-				false);
-
+		rows++;
 		copied += elem_size;
 		sys_addr += sys_stride;
 		h_offs += h_stride;
 		addr += h_stride;
 	}
 
-	/* Release the buffer used for VPR write */
-	if (!is_read && h->heap_type == NVMAP_HEAP_CARVEOUT_VPR && tmp)
-		vfree(tmp);
+	/* Write back the rows that made it to the handle */
+	if (!is_read)
+		rw_handle_cache_maint(client, h, start, h_stride, elem_size,
+				      rows, NVMAP_CACHE_OP_WB_INV);
+
+	kfree(tmp);
 
 	return ret ?: copied;
 }
@@ -23,6 +23,9 @@
 #include <linux/mutex.h>
 #include <linux/rtmutex.h>
 #include <linux/rbtree.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
+#include <linux/seqlock.h>
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/atomic.h>
@@ -228,7 +231,8 @@ struct nvmap_handle_dmabuf_priv {
 };
 
 struct nvmap_handle {
-	struct rb_node node;	/* entry on global handle tree */
+	struct hlist_node node;	/* entry on global handle table */
+	struct rcu_head rcu;	/* handle is freed after an RCU grace period */
 	atomic_t ref;		/* reference count (i.e., # of duplications) */
 	atomic_t pin;		/* pin count */
 	u32 flags;		/* caching flags */
@@ -287,6 +291,7 @@ struct nvmap_handle_ref {
 	struct rb_node	node;
 	atomic_t	dupes;	/* number of times to free on file close */
 	bool is_ro;
+	struct rcu_head	rcu;	/* ref is freed after an RCU grace period */
 };
 
 #if defined(NVMAP_CONFIG_PAGE_POOLS)
@@ -352,6 +357,7 @@ struct xarray {};
 struct nvmap_client {
 	const char			*name;
 	struct rb_root			handle_refs;
+	seqcount_t			ref_seq;	/* handle_refs updates */
 	struct mutex			ref_lock;
 	bool				kernel_client;
 	atomic_t			count;
@@ -371,8 +377,11 @@ struct nvmap_vma_priv {
 	atomic_t	count;	/* number of processes cloning the VMA */
 };
 
+#define NVMAP_HANDLE_HASH_BITS	12
+
 struct nvmap_device {
-	struct rb_root	handles;
+	/* lookups are lockless under RCU, handle_lock serializes updates */
+	DECLARE_HASHTABLE(handles, NVMAP_HANDLE_HASH_BITS);
 	spinlock_t	handle_lock;
 	struct miscdevice dev_user;
 	struct nvmap_carveout_node *heaps;
@@ -456,6 +465,15 @@ static inline pgprot_t nvmap_pgprot(struct nvmap_handle *h, pgprot_t prot)
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
+/* A run of free pages in a coherent carveout, in units of pages */
+struct nvmap_free_extent {
+	struct rb_node	start_node;	/* dma_coherent_mem_replica.free_by_start */
+	struct rb_node	size_node;	/* dma_coherent_mem_replica.free_by_size */
+	struct list_head list;		/* dma_coherent_mem_replica.spares */
+	unsigned int	start;
+	unsigned int	len;
+};
+
 struct dma_coherent_mem_replica {
 	void		*virt_base;
 	dma_addr_t	device_base;
@@ -466,11 +484,39 @@ struct dma_coherent_mem_replica {
 	int		size;
 #endif
 	int		flags;
-	unsigned long	*bitmap;
 	spinlock_t	spinlock;
 	bool		use_dev_dma_pfn_offset;
+
+	/* free extents, protected by spinlock */
+	struct rb_root	free_by_start;
+	struct rb_root	free_by_size;	/* ordered by (len, start) */
+	unsigned int	free_pages;
+	unsigned int	nr_extents;
+	unsigned int	nr_runs;	/* allocated runs, one per later free */
+	unsigned int	nr_spares;
+	struct list_head spares;	/* unused extent nodes */
+
+	/* allocator statistics, protected by spinlock */
+	u64		nr_allocs;
+	u64		nr_alloc_fails;
+	u64		alloc_ns_total;
+	u64		alloc_ns_max;
 };
 
+struct nvmap_coherent_stats {
+	unsigned int	total_pages;
+	unsigned int	free_pages;
+	unsigned int	largest_free;
+	unsigned int	nr_extents;
+	u64		nr_allocs;
+	u64		nr_alloc_fails;
+	u64		alloc_ns_total;
+	u64		alloc_ns_max;
+};
+
+int nvmap_dma_coherent_stats(struct device *dev,
+			     struct nvmap_coherent_stats *stats);
+
 int nvmap_dma_declare_coherent_memory(struct device *dev, phys_addr_t phys_addr,
 			dma_addr_t device_addr, size_t size, int flags);
 #endif
@@ -498,6 +544,9 @@ struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *priv,
 
 struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *h);
 
+void nvmap_remove_handle_ref(struct nvmap_client *client,
+			     struct nvmap_handle_ref *ref);
+
 struct nvmap_handle_ref *nvmap_create_handle(struct nvmap_client *client,
 					     size_t size, bool ro_buf);
 
@@ -141,6 +141,24 @@ struct nvhost_clock {
 	unsigned long devfreq_rate;
 };
 
+#define NVHOST_WORKLOAD_STAT_MAGIC	0x6e76776c	/* "nvwl" */
+
+/*
+ * Engine workload summary handed to devfreq governors through
+ * devfreq_dev_status.private_data. Unlike busy_time it describes work that
+ * is still pending, which lets a governor raise the clock before jobs are
+ * late instead of after.
+ */
+struct nvhost_workload_stat {
+	u32 magic;		/* NVHOST_WORKLOAD_STAT_MAGIC */
+	u32 queue_depth;	/* jobs submitted but not yet completed */
+	u64 submitted;		/* jobs submitted since scaling init */
+	u64 completed;		/* jobs completed since scaling init */
+	u64 deadline_misses;	/* jobs completed after their deadline */
+	u64 job_cycles_avg;	/* moving average of engine cycles per job */
+	ktime_t next_deadline;	/* earliest known pending deadline, 0 if none */
+};
+
 struct nvhost_vm_hwid {
 	u64 addr;
 	bool dynamic;
@@ -474,6 +474,22 @@ struct nvs_fn_if {
 	int (*suspend)(void *handle);
 	int (*resume)(void *handle);
 	int (*handler)(void *handle, void *buffer, s64 ts);
+/**
+ * handler_batch - push a block of evenly spaced samples
+ * @handle: handle from probe
+ * @buffer: n samples, each stride bytes apart
+ * @stride: bytes between samples, 0 for the pushed data size
+ * @ts: timestamp of the first sample
+ * @ts_step: timestamp increment between samples
+ * @n: number of samples
+ *
+ * Returns the number of bytes consumed or a negative error code.
+ *
+ * Optional. Sensor drivers draining a FIFO use this, when set, instead of
+ * calling handler once per sample.
+ */
+	int (*handler_batch)(void *handle, void *buffer, unsigned int stride,
+			     s64 ts, s64 ts_step, unsigned int n);
 };
 
 extern const char * const nvs_float_significances[];
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2020, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2019-2022, NVIDIA CORPORATION.  All rights reserved.
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms and conditions of the GNU General Public License,
@@ -14,6 +14,10 @@
 #ifndef TEGRA_DCE_CLIENT_IPC_H
 #define TEGRA_DCE_CLIENT_IPC_H
 
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/completion.h>
+
 #define DCE_CLIENT_IPC_TYPE_CPU_RM		0U
 #define DCE_CLIENT_IPC_TYPE_HDCP_KMD		1U
 #define DCE_CLIENT_IPC_TYPE_RM_EVENT		2U
@@ -38,6 +42,44 @@ struct dce_ipc_message {
 	} rx;
 };
 
+struct tegra_dce_client_ipc_req;
+
+/*
+ * tegra_dce_client_ipc_done_t - callback function to notify the client
+ * that the reply to an asynchronous rpc has been received.
+ *
+ * Called from the DCE interrupt thread, must not block.
+ *
+ * @handle: handle of the client that submitted the request.
+ * @req: completed request, req->status holds the result.
+ * @usr_ctx: context passed in the request.
+ */
+typedef void (*tegra_dce_client_ipc_done_t)(u32 handle,
+	      struct tegra_dce_client_ipc_req *req, void *usr_ctx);
+
+/**
+ * struct tegra_dce_client_ipc_req - An asynchronous rpc to DCE.
+ *
+ * @msg : request and reply buffers, valid until the request completes.
+ * @done_fn : completion callback, or NULL to use tegra_dce_client_ipc_wait().
+ * @usr_ctx : passed back to done_fn.
+ * @tag : sequence number assigned on submission. DCE serves the requests
+ *        of a channel in order, so requests complete in tag order.
+ * @status : 0 or error code, valid once the request completed.
+ *
+ * The remaining fields are private to the DCE driver.
+ */
+struct tegra_dce_client_ipc_req {
+	struct dce_ipc_message *msg;
+	tegra_dce_client_ipc_done_t done_fn;
+	void *usr_ctx;
+	u32 tag;
+	int status;
+	bool orphan;
+	struct list_head node;
+	struct completion done;
+};
+
 /*
  * tegra_dce_client_ipc_callback_t - callback function to notify the
  * client when the CPU Driver receives an IPC from DCE for the client.
@@ -83,4 +125,27 @@ int tegra_dce_unregister_ipc_client(u32 handle);
  */
 int tegra_dce_client_ipc_send_recv(u32 handle, struct dce_ipc_message *msg);
 
+/*
+ * tegra_dce_client_ipc_send_async() - used by clients to queue rpcs to dce
+ * without waiting for the reply
+ * @handle : client handle registered with dce driver
+ * @req : request to be sent, owned by dce driver until it completes
+ *
+ * Sleeps while the channel already has as many requests in flight as it
+ * has frames.
+ *
+ * Return: 0 if the request was queued else corresponding error value.
+ */
+int tegra_dce_client_ipc_send_async(u32 handle,
+		struct tegra_dce_client_ipc_req *req);
+
+/*
+ * tegra_dce_client_ipc_wait() - waits for an asynchronous rpc queued
+ * without a completion callback
+ * @req : request passed to tegra_dce_client_ipc_send_async()
+ *
+ * Return: req->status.
+ */
+int tegra_dce_client_ipc_wait(struct tegra_dce_client_ipc_req *req);
+
 #endif
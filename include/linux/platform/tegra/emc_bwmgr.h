@@ -222,6 +222,22 @@ unsigned long tegra_bwmgr_round_rate(unsigned long bw);
 int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle, unsigned long val,
 		enum tegra_bwmgr_request_type req);
 
+/**
+ * tegra_bwmgr_set_emc_async - same as tegra_bwmgr_set_emc(), but does not
+ *			 wait for the EMC clock update. Requests made within
+ *			 the coalescing window are applied together by a
+ *			 single clock update. Increases of the shared ISO
+ *			 bandwidth are still applied before returning.
+ *
+ * @handle      handle acquired during tegra_bwmgr_register
+ * @val         value to be set in Hz, 0 to clear old request of the same type
+ * @req         chosen type from tegra_bwmgr_request_type
+ *
+ * Returns success (0) or negative errno.
+ */
+int tegra_bwmgr_set_emc_async(struct tegra_bwmgr_client *handle,
+		unsigned long val, enum tegra_bwmgr_request_type req);
+
 /**
  * tegra_bwmgr_get_client_info - outputs the value previously set with
  *                       tegra_bwmgr_set_emc or 0 if no value has been set.
@@ -372,6 +388,12 @@ static inline int tegra_bwmgr_set_emc(struct tegra_bwmgr_client *handle,
 	return 0;
 }
 
+static inline int tegra_bwmgr_set_emc_async(struct tegra_bwmgr_client *handle,
+		unsigned long val, enum tegra_bwmgr_request_type req)
+{
+	return 0;
+}
+
 static inline int tegra_bwmgr_get_client_info(struct tegra_bwmgr_client *handle,
 		unsigned long *out_val,
 		enum tegra_bwmgr_request_type req)
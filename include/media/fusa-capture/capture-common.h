@@ -70,6 +70,18 @@ struct capture_mapping;
 /** @brief  max pin count per request. Used to preallocate unpin list */
 #define MAX_PIN_BUFFER_PER_REQUEST 	(U32_C(24))
 
+/** @brief max number of buffer operations in one vectored request */
+#define MAX_BUFFER_REQUESTS_PER_CALL	(U32_C(1024))
+
+/**
+ * @brief Capture surface buffer operation, element of a vectored buffer
+ * request (IOCTL payload).
+ */
+struct capture_buffer_req {
+	uint32_t mem; /**< NvRm handle to buffer */
+	uint32_t flag; /**< Buffer @ref CAPTURE_BUFFER_OPS bitmask */
+};
+
 
 
 /**
@@ -104,6 +116,26 @@ int capture_buffer_request(
 	uint32_t memfd,
 	uint32_t flag);
 
+/**
+ * @brief Perform a batch of buffer management operations with a single
+ * acquisition of the table's request lock.
+ *
+ * The operations are performed in order and processing stops at the first
+ * failing one; the operations completed before it are not rolled back.
+ *
+ * @param[in,out]	tab		Surface buffer management table
+ * @param[in]		reqs		User array of buffer operations
+ * @param[in]		num_reqs	Number of elements in @a reqs
+ * @param[out]		num_done	Number of operations completed
+ *
+ * @returns		0 (success), neg. errno (failure)
+ */
+int capture_buffer_request_vec(
+	struct capture_buffer_table *tab,
+	const struct capture_buffer_req __user *reqs,
+	uint32_t num_reqs,
+	uint32_t *num_done);
+
 /**
  * @brief Add a capture surface buffer to the buffer management table.
  *
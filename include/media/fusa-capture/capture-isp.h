@@ -163,6 +163,16 @@ struct isp_buffer_req {
 	uint32_t flag; /**< Buffer @ref CAPTURE_BUFFER_OPS bitmask */
 } __ISP_CAPTURE_ALIGN;
 
+/**
+ * @brief Batch of ISP capture buffer operations (IOCTL payload).
+ */
+struct isp_buffer_req_vec {
+	uint64_t reqs;
+		/**< User pointer to an array of struct capture_buffer_req */
+	uint32_t num_reqs; /**< Number of elements in @a reqs */
+	uint32_t num_done; /**< Number of operations completed (output) */
+} __ISP_CAPTURE_ALIGN;
+
 /**
  * @brief Initialize an ISP channel capture context (at channel open).
  *
@@ -366,4 +376,17 @@ int isp_capture_buffer_request(
 	struct tegra_isp_channel *chan,
 	struct isp_buffer_req *req);
 
+/**
+ * @brief Perform a batch of buffer management operations on ISP capture
+ * buffers.
+ *
+ * @param[in]		chan	ISP channel context
+ * @param[in,out]	req	ISP capture buffer batch request
+ *
+ * @returns		0 (success), neg. errno (failure)
+ */
+int isp_capture_buffer_request_vec(
+	struct tegra_isp_channel *chan,
+	struct isp_buffer_req_vec *req);
+
 #endif /* __FUSA_CAPTURE_ISP_H__ */
@@ -223,6 +223,16 @@ struct vi_buffer_req {
 	uint32_t flag; /**< Buffer @ref CAPTURE_BUFFER_OPS bitmask. */
 } __VI_CAPTURE_ALIGN;
 
+/**
+ * @brief Batch of VI capture surface buffer operations (IOCTL payload)
+ */
+struct vi_buffer_req_vec {
+	uint64_t reqs;
+		/**< User pointer to an array of struct capture_buffer_req. */
+	uint32_t num_reqs; /**< Number of elements in @a reqs. */
+	uint32_t num_done; /**< Number of operations completed (output). */
+} __VI_CAPTURE_ALIGN;
+
 /**
  * @brief The compand configuration describes a piece-wise linear tranformation
  * function used by the VI companding module.
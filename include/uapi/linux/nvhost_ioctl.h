@@ -150,6 +150,16 @@ struct nvhost_set_timeout_ex_args {
 	__u32 flags;
 };
 
+/*
+ * Relative completion deadline applied to every job subsequently submitted
+ * through this channel fd, e.g. the client's frame period. Zero disables
+ * deadlines for the client.
+ */
+struct nvhost_set_deadline_args {
+	__u32 deadline_us;
+	__u32 reserved;
+};
+
 struct nvhost_set_priority_args {
 	__u32 priority;
 } __packed;
@@ -327,6 +337,8 @@ struct nvhost_channel_attach_syncpt_args {
 	_IOW(NVHOST_IOCTL_MAGIC, 30, struct nvhost_set_syncpt_name_args)
 #define NVHOST_IOCTL_CHANNEL_ATTACH_SYNCPT \
 	_IOWR(NVHOST_IOCTL_MAGIC, 31, struct nvhost_channel_attach_syncpt_args)
+#define NVHOST_IOCTL_CHANNEL_SET_DEADLINE	\
+	_IOW(NVHOST_IOCTL_MAGIC, 32, struct nvhost_set_deadline_args)
 
 #define NVHOST_IOCTL_CHANNEL_SET_ERROR_NOTIFIER  \
 	_IOWR(NVHOST_IOCTL_MAGIC, 111, struct nvhost_set_error_notifier)
@@ -112,6 +112,7 @@ struct nvdla_submit_args {
 #define MAX_NVDLA_TASKS_PER_SUBMIT	16
 #define NVDLA_SUBMIT_FLAGS_ATOMIC	(1 << 0)
 #define NVDLA_SUBMIT_FLAGS_BYPASS_EXEC	(1 << 1)
+#define NVDLA_SUBMIT_FLAGS_EMULATE	(1 << 2)
 	__u16 flags;
 	__u32 version;
 };
@@ -259,6 +260,44 @@ struct nvdla_status_notify {
 	__u32 status;
 };
 
+/**
+ * struct nvdla_template_args structure for task template create/destroy
+ *
+ * @task		pointer to nvdla_ioctl_submit_task describing the task;
+ *			its fences must be empty, they are given on each launch
+ * @id			template identifier, returned on create
+ * @reserved		reserved for future use
+ *
+ */
+struct nvdla_template_args {
+	__u64 task;
+	__u32 id;
+	__u32 reserved;
+};
+
+/**
+ * struct nvdla_ioctl_template_task structure for launching a task template
+ *
+ * @id			identifier of the template to launch
+ * @num_prefences	number of pre-fences in task
+ * @num_postfences	number of post-fences in task
+ * @reserved		reserved for future use
+ * @prefences		pointer to pre-fence struct table
+ * @postfences		pointer to post-fence struct table
+ * @timeout		task timeout, 0 to use the template one
+ *
+ */
+struct nvdla_ioctl_template_task {
+	__u32 id;
+	__u8 num_prefences;
+	__u8 num_postfences;
+	__u16 reserved;
+
+	__u64 prefences;
+	__u64 postfences;
+	__u64 timeout;
+};
+
 #define NVHOST_NVDLA_IOCTL_MAGIC 'D'
 
 #define NVDLA_IOCTL_PING		\
@@ -281,8 +320,14 @@ struct nvdla_status_notify {
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 9)
 #define NVDLA_IOCTL_RELEASE_QUEUE \
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 10)
+#define NVDLA_IOCTL_CREATE_TEMPLATE \
+	_IOWR(NVHOST_NVDLA_IOCTL_MAGIC, 11, struct nvdla_template_args)
+#define NVDLA_IOCTL_DESTROY_TEMPLATE \
+	_IOW(NVHOST_NVDLA_IOCTL_MAGIC, 12, struct nvdla_template_args)
+#define NVDLA_IOCTL_TEMPLATE_SUBMIT \
+	_IOW(NVHOST_NVDLA_IOCTL_MAGIC, 13, struct nvdla_submit_args)
 #define NVDLA_IOCTL_LAST		\
-		_IOC_NR(NVDLA_IOCTL_RELEASE_QUEUE)
+		_IOC_NR(NVDLA_IOCTL_TEMPLATE_SUBMIT)
 
 #define NVDLA_IOCTL_MAX_ARG_SIZE  \
 		sizeof(struct nvdla_pin_unpin_args)